@@ -1,8 +1,10 @@
 #ifndef DEBUG_H
 #define DEBUG_H
 
-// TODO: comment this to disable debug prints
+// Debug prints are on unless the build defines NO_DEBUG_PRINTS (cmake -DDEBUG_PRINTS=OFF).
+#ifndef NO_DEBUG_PRINTS
 #define DEBUG_PRINTS
+#endif
 
 #ifdef DEBUG_PRINTS
 
@@ -1,15 +1,18 @@
 #ifndef MIM_ERR_H
 #define MIM_ERR_H
 
+#include <errno.h>
 #include <stdnoreturn.h>
 
 /* Assert that expr evaluates to zero (otherwise use result as error number, as in pthreads). */
 #define ASSERT_ZERO(expr)                                                                          \
     do {                                                                                           \
-        int errno = (expr);                                                                        \
-        if (errno != 0)                                                                            \
+        int const assert_zero_errnum = (expr);                                                     \
+        if (assert_zero_errnum != 0) {                                                             \
+            errno = assert_zero_errnum;                                                            \
             syserr("Failed: %s\n\tIn function %s() in %s line %d.\n\tErrno: ", #expr, __func__,    \
                 __FILE__, __LINE__);                                                               \
+        }                                                                                          \
     } while (0)
 
 /* Assert that expression doesn't evaluate to -1 (as almost every system function does on error).
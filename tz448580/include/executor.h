@@ -1,12 +1,13 @@
 #ifndef EXECUTOR_H
 #define EXECUTOR_H
 
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stddef.h>
 
+#include "future.h"
 #include "mio.h"
 
-typedef struct Future Future;
-
 /**
  * Represents an executor that drives futures to completion.
  *
@@ -16,15 +17,69 @@ typedef struct Future Future;
 
 typedef struct Executor Executor;
 
-/** Creates a new executor (with a specified queue size). */
+/**
+ * Number of futures an executor (or each of its workers) progresses in a row before it checks
+ * for ready I/O and expired timers without blocking, so that futures which keep waking
+ * themselves cannot starve the ones waiting for events. See also FUTURE_TASK_BUDGET.
+ */
+#define EXECUTOR_TICK_BUDGET 61
+
+/**
+ * A future woken by the running future goes to a LIFO slot and runs next (see
+ * `executor_set_lifo_slot()`), but at most this many times in a row before the slot's
+ * future has to wait at the back of the queue, so that two futures cannot ping-pong forever.
+ */
+#define EXECUTOR_MAX_LIFO_POLLS 3
+
+/**
+ * Creates a new executor.
+ *
+ * The queue itself is unbounded; `max_queue_size` is an optional admission limit on the number
+ * of spawned but not yet completed futures (0 means no limit).
+ */
 Executor* executor_create(size_t max_queue_size);
 
+/**
+ * Creates a new multi-threaded executor with `n_threads` workers.
+ *
+ * `executor_run()` runs the workers on the calling thread plus `n_threads - 1` new threads,
+ * each with its own queue; idle workers steal futures from busy ones and share one Mio.
+ * Futures may thus be progressed on any of these threads (but never on two at once).
+ * The meaning of `max_queue_size` is the same as for `executor_create()`.
+ */
+Executor* executor_create_multi(size_t n_threads, size_t max_queue_size);
+
 /**
  * Submits a future to be managed by the executor.
  *
  * The future will be progressed (in `executor_run()`) until complete.
+ * Returns false (and leaves the future untouched) if the admission limit has been reached,
+ * so that the caller can apply back-pressure and retry once some futures complete.
  */
-void executor_spawn(Executor* executor, Future* fut);
+bool executor_spawn(Executor* executor, Future* fut);
+
+/**
+ * Spawns a copy of a future (of `size` bytes, e.g., `sizeof(PipeReadFuture)`) that is owned
+ * by the executor.
+ *
+ * The copy lives in a slot of the executor's slab allocator, which saves a malloc() and free()
+ * per task (and the need to keep the future pinned); the slot is freed as soon as the future
+ * completes, so its result can only be obtained through `handle` (see
+ * `executor_spawn_joinable()`; pass NULL if it is not needed). Returns the copy, or NULL if the
+ * admission limit has been reached.
+ */
+Future* executor_spawn_owned(
+    Executor* executor, Future const* fut, size_t size, struct JoinHandle* handle);
+
+/**
+ * Cancels a spawned future that has not completed yet (e.g., whose result is no longer needed).
+ *
+ * Instead of being progressed again, the future is cancelled (see `CancelFn`) by the executor
+ * (on the thread that would have progressed it) and finishes with FUTURE_FAILURE and
+ * FUTURE_ERR_CANCELLED (which its JoinHandle, if any, reports). It may be called from any
+ * thread, but the future must still be active; cancelling it twice is harmless.
+ */
+void executor_cancel(Executor* executor, Future* fut);
 
 /**
  * Runs the executor, driving futures to completion.
@@ -34,7 +89,119 @@ void executor_spawn(Executor* executor, Future* fut);
  */
 void executor_run(Executor* executor);
 
-/** Destroys the executor and frees its resources. */
+/**
+ * Enables or disables (before `executor_run()`) the LIFO slot (enabled by default).
+ *
+ * When a running future wakes another one (e.g., a producer its consumer), the woken future
+ * runs right after the current one instead of after the whole queue, which keeps the data
+ * handed over hot in the cache and cuts the latency of message passing.
+ */
+void executor_set_lifo_slot(Executor* executor, bool enabled);
+
+/**
+ * Makes (before `executor_run()`) the executor busy-poll for up to `spin_us` microseconds
+ * when it runs out of futures, before it parks in `mio_poll()` (0, the default, parks at once).
+ *
+ * While spinning, it calls `mio_poll_nowait()` and checks for futures woken from other threads
+ * in a loop, so events and wakes arriving in the meantime are handled without a blocking
+ * system call, a context switch and (for wakes) a write to Mio's eventfd. This trades CPU time
+ * (up to a full core per spinning executor or driving worker) for latency.
+ */
+void executor_set_spin(Executor* executor, unsigned spin_us);
+
+/** Returns the MIO instance of the executor (e.g., to register fds with `mio_register_persistent()`). */
+Mio* executor_mio(Executor* executor);
+
+/**
+ * Switches (before any future is spawned and any fd registered) the executor to a new MIO
+ * instance with the given backend (epoll by default). Returns the backend actually in use,
+ * as io_uring falls back to epoll on kernels without it.
+ */
+MioBackend executor_set_mio_backend(Executor* executor, MioBackend backend);
+
+/**
+ * Destroys the executor and frees its resources.
+ *
+ * BEWARE: it joins the threads of the blocking pool, so it waits for every blocking function
+ * still running, also those of cancelled BlockingFutures (see `executor_spawn_blocking()`).
+ */
 void executor_destroy(Executor* executor);
 
+// =========================== JoinHandle ===========================
+
+/** States of a JoinHandle. */
+enum {
+    JOIN_PENDING, // The task is running, and the handle has no waker yet.
+    JOIN_WAITING, // The task is running, and the handle's waker is set.
+    JOIN_COMPLETING, // The task has completed, and the result is being handed over.
+    JOIN_DONE, // The result is in the handle.
+    JOIN_DETACHED, // The handle has been cancelled: the task's result will be dropped.
+};
+
+/**
+ * A future that completes with the result of a spawned task (see `executor_spawn_joinable()`).
+ *
+ * It completes (or fails) when the task does, with the task's `ok` and `errcode`. Awaiting it
+ * only re-polls the awaiting future when the task completes, so independent tasks can be
+ * spawned separately instead of being driven together from one root future.
+ * A handle must be awaited by a single task. Cancelling it detaches it from the task.
+ */
+typedef struct JoinHandle {
+    Future base;
+    atomic_int join_state; // One of the JOIN_* values above.
+    Waker waker; // Set once, on the first progress() (only meaningful from JOIN_WAITING on).
+    FutureState result; // The task's final state (only meaningful in JOIN_DONE).
+} JoinHandle;
+
+/**
+ * Spawns a future like `executor_spawn()`, and initializes `*handle` (if the spawn succeeds)
+ * so that it completes with the future's result. The handle must stay pinned until it completes
+ * or is cancelled.
+ */
+bool executor_spawn_joinable(Executor* executor, Future* fut, JoinHandle* handle);
+
+// ========================= BlockingFuture =========================
+
+/** Default bound on the number of threads of an executor's blocking pool. */
+#define EXECUTOR_MAX_BLOCKING_THREADS 8
+
+/** States of a BlockingFuture's job. */
+enum {
+    BLOCKING_JOB_NEW, // Not submitted yet.
+    BLOCKING_JOB_QUEUED, // Waiting for a thread of the blocking pool.
+    BLOCKING_JOB_RUNNING, // The function is running on the blocking pool.
+    BLOCKING_JOB_WAKING, // The function has returned, and the pool thread is waking the future.
+    BLOCKING_JOB_DONE, // The function has returned, and the future has been woken.
+};
+
+typedef struct BlockingFuture {
+    Future base;
+    void* (*func)(void*);
+    struct BlockingFuture* next_job; // Link in the blocking pool's queue.
+    Waker waker; // Woken when the function returns.
+    atomic_int job_state; // One of the BLOCKING_JOB_* values above.
+} BlockingFuture;
+
+/**
+ * Creates a future that runs a (blocking or CPU-heavy) function off the executor's threads.
+ *
+ * When the future is first progressed, `func(future.arg)` (`arg` by default) is submitted to
+ * the executor's pool of blocking threads, so that it does not hold up other futures.
+ * When it returns, the future is woken (through Mio's eventfd, if the executor is parked)
+ * and completes with the function's result.
+ * Cancelling the future (see `CancelFn`) dequeues the function or, if it is already running,
+ * lets it run to completion on its own (the result is dropped), without waiting for it.
+ * The function still holds its pool thread meanwhile, and executor_destroy() waits for it.
+ */
+BlockingFuture executor_spawn_blocking(void* (*func)(void*), void* arg);
+
+/**
+ * Sets the bound on the number of threads running blocking functions (see above).
+ *
+ * Threads are started on demand, up to this many; the default is EXECUTOR_MAX_BLOCKING_THREADS.
+ * Started threads live until the executor is destroyed, so the bound cannot shrink below the
+ * number of threads already started (it is raised to that number instead), nor below 1.
+ */
+void executor_set_max_blocking_threads(Executor* executor, size_t n_threads);
+
 #endif // EXECUTOR_H
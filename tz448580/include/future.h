@@ -1,6 +1,7 @@
 #ifndef FUTURE_H
 #define FUTURE_H
 
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -15,6 +16,21 @@ typedef enum FutureState {
     FUTURE_FAILURE, // Future has failed, and its result contains the error code.
 } FutureState;
 
+/**
+ * Scheduling states of a spawned future (see `Future.sched_state`).
+ *
+ * A wake moves IDLE to SCHEDULED (and queues the future) or RUNNING to NOTIFIED (and the
+ * executor requeues the future once its progress() returns), so that a future is never queued
+ * twice nor progressed by two threads at once. Wakes in any other state are no-ops.
+ */
+enum {
+    FUTURE_SCHED_INACTIVE, // Not spawned, or already completed.
+    FUTURE_SCHED_IDLE, // Spawned and waiting for a wake.
+    FUTURE_SCHED_SCHEDULED, // In one of the executor's queues.
+    FUTURE_SCHED_RUNNING, // progress() is being called.
+    FUTURE_SCHED_NOTIFIED, // Woken while progress() was being called.
+};
+
 /** The type of a pointer to a function that progresses a future.
  *
  * The function defines what it means to make progress on the future (execute a stage of it).
@@ -36,9 +52,30 @@ typedef enum FutureState {
  */
 typedef FutureState (*ProgressFn)(Future*, Mio*, Waker);
 
+/**
+ * The type of a pointer to a function that cancels a future.
+ *
+ * It is called (instead of `progress`) when a pending future is abandoned and will never be
+ * progressed again, e.g., because a timeout expired. It must release whatever the future holds
+ * on to between calls to `progress` (e.g., unregister its fds from Mio), so that no more wakes
+ * point at the future.
+ *
+ * A future that hands its waker to someone else (Mio, a timer, another thread) should implement
+ * it. A waker that survives anyway (or a wake already under way) is harmless to the enclosing
+ * combinators, whose ready bits are not freed with them (see `WakeCell`), but it still wakes the
+ * task that spawned the future.
+ *
+ * @param self Pointer to the future instance.
+ * @param mio  Pointer to the Mio instance.
+ */
+typedef void (*CancelFn)(Future*, Mio*);
+
 /** The no-error code. */
 #define FUTURE_SUCCESS 0
 
+/** The error code of a spawned future that has been cancelled, see `executor_cancel()`. */
+#define FUTURE_ERR_CANCELLED (-1)
+
 /** Represents an asynchronous computation that produces a value in the future.
  *
  * Stores an input argument, the result and error code, and the state of the future's progress
@@ -48,6 +85,9 @@ struct Future {
     /** Make progress towards the future's completion, see the `ProgressFn` typedef. */
     ProgressFn progress;
 
+    /** Release the resources of an abandoned future, see the `CancelFn` typedef (optional). */
+    CancelFn cancel;
+
     /**
      * Tells whether the future is being executed by some executor (spawned but not yet finished).
      *
@@ -66,6 +106,27 @@ struct Future {
      */
     bool is_active;
 
+    /** Whether the future lives in a slot of the executor, see `executor_spawn_owned()`. */
+    bool is_owned;
+
+    /**
+     * Scheduling state of the future (one of the FUTURE_SCHED_* values above).
+     *
+     * It lets a wake tell in constant time whether the future is already queued or running,
+     * also when wakes race with each other on different threads.
+     * Only the executor is allowed to modify it.
+     */
+    atomic_int sched_state;
+
+    /** Set by `executor_cancel()`: the executor cancels the future instead of progressing it. */
+    atomic_bool cancel_requested;
+
+    /** Next future in the executor's queue (intrusive link, only meaningful while queued). */
+    Future* queue_next;
+
+    /** Handle to notify of the result when the future completes (optional, see JoinHandle). */
+    struct JoinHandle* join_handle;
+
     void* arg; // An optional input argument of the future.
     void* ok; // An optional result; only meaningful if `progress` returned FUTURE_COMPLETED.
     int errcode; // Only meaningful if `progress` returned FUTURE_FAILURE or FUTURE_COMPLETED.
@@ -75,11 +136,53 @@ static inline Future future_create(ProgressFn progress_fn)
 {
     return (Future) {
         .progress = progress_fn,
+        .cancel = NULL,
         .is_active = false,
+        .is_owned = false,
+        .sched_state = FUTURE_SCHED_INACTIVE,
+        .cancel_requested = false,
+        .queue_next = NULL,
+        .join_handle = NULL,
         .errcode = FUTURE_SUCCESS,
         .arg = NULL,
         .ok = NULL,
     };
 }
 
+/**
+ * Cooperative budget of the task (top-level future) running on the current thread.
+ *
+ * The executor refills it to FUTURE_TASK_BUDGET before every call to a task's `progress`.
+ * Futures that may keep making progress for long (e.g., reading a pipe that is always ready)
+ * should consume a unit per step with future_budget_consume(), and once it fails, call their
+ * waker and return FUTURE_PENDING, so that the other tasks (and I/O) get their turn.
+ */
+#define FUTURE_TASK_BUDGET 128
+
+extern _Thread_local unsigned future_budget;
+
+/** Consumes a unit of the current task's budget; returns false if it is exhausted. */
+static inline bool future_budget_consume(void)
+{
+    if (future_budget == 0) {
+        return false;
+    }
+    future_budget--;
+    return true;
+}
+
+/** Returns how much of the current task's budget is left. */
+static inline unsigned future_budget_remaining(void)
+{
+    return future_budget;
+}
+
+/** Cancels an abandoned pending future (a no-op if it has no cancel function). */
+static inline void future_cancel(Future* fut, Mio* mio)
+{
+    if (fut->cancel) {
+        fut->cancel(fut, mio);
+    }
+}
+
 #endif // FUTURE_H
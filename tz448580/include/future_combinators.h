@@ -2,8 +2,10 @@
 #define FUTURE_COMBINATORS_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "future.h"
+#include "timer_wheel.h"
 
 #define THEN_FUTURE_ERR_FUT1_FAILED 1
 #define THEN_FUTURE_ERR_FUT2_FAILED 2
@@ -38,6 +40,10 @@ ThenFuture future_then(Future* fut1, Future* fut2);
  * futures returns FAILURE. JoinFuture shall save corresponding returns and
  * errcodes. Upon completion of both futures, JoinFuture returns FAILURE if
  * either of the futures returns FAILURE; else it returns COMPLETED.
+ *
+ * Each future gets its own waker (see `waker_for_child()`), so that only the futures that
+ * have been woken are re-polled, and a wake in a deep tree of combinators costs only as much
+ * as the path to the woken future.
  */
 typedef struct JoinFuture {
     Future base; // Base future structure
@@ -45,6 +51,7 @@ typedef struct JoinFuture {
     Future* fut2; // Another future to execute
     FutureState fut1_completed;
     FutureState fut2_completed;
+    WakeCell* ready; // Bit i set: future i+1 has been woken (see `waker_for_child()`).
     struct JoinResult {
         struct {
             int errcode;
@@ -60,12 +67,90 @@ typedef struct JoinFuture {
 /** Creates a JoinFuture that executes two futures concurrently. */
 JoinFuture future_join(Future* fut1, Future* fut2);
 
+#define JOIN_ALL_FUTURE_ERR_FAILED 1
+#define JOIN_ALL_FUTURE_ERR_NO_MEMORY 2
+
+/** Result of one of the futures of an n-ary combinator (JoinAllFuture, QuorumFuture). */
+typedef struct FutureResult {
+    FutureState state; // FUTURE_PENDING until the future completes or fails.
+    int errcode;
+    void* ok;
+} FutureResult;
+
+/**
+ * A combinator that executes an array of futures concurrently.
+ *
+ * The JoinAllFuture progresses every future until completion (even if some fail), saving
+ * each future's state, errcode and result in `results[i]`. Upon completion of all futures,
+ * it returns COMPLETED (with base.ok := results), or FAILURE with JOIN_ALL_FUTURE_ERR_FAILED
+ * if any of them failed.
+ *
+ * Unlike a tree of JoinFutures, it keeps per-future state in flat arrays, with a two-level
+ * bitset of woken futures (see `waker_for_child()`), so a wake costs O(woken futures) plus
+ * a scan of n / 4096 words. That state is allocated on the first progress() and freed on
+ * completion or cancellation (if allocation fails, it returns JOIN_ALL_FUTURE_ERR_NO_MEMORY);
+ * its bits live in wake cells (see `WakeCell`), so wakers that the futures still hold after
+ * that stay harmless.
+ */
+typedef struct JoinAllFuture {
+    Future base; // Base future structure
+    Future** futs; // Futures to execute
+    size_t n;
+    size_t n_pending; // Futures that have not completed yet.
+    FutureResult* results; // One per future.
+    struct ReadySet* ready; // Which futures have been woken (while running).
+} JoinAllFuture;
+
+/** Creates a JoinAllFuture that executes `n` futures concurrently (`results` has n entries). */
+JoinAllFuture future_join_all(Future** futs, size_t n, FutureResult* results);
+
+#define QUORUM_FUTURE_ERR_UNREACHABLE 1
+#define QUORUM_FUTURE_ERR_NO_MEMORY 2
+
+/**
+ * A combinator that executes an array of futures until `k` of them complete.
+ *
+ * The QuorumFuture is considered COMPLETED as soon as k futures are COMPLETED, with `winner`
+ * set to the index of the first one, and base.ok := results (results[i] tells which ones
+ * completed), or for k = 1, base.ok := the winner's result. It returns FAILURE with QUORUM_FUTURE_ERR_UNREACHABLE as soon as so
+ * many futures have failed that k successes are impossible.
+ * Once the outcome is decided, the futures still pending are cancelled (see `CancelFn`),
+ * e.g. releasing their Mio registrations, and their results stay FUTURE_PENDING.
+ *
+ * Like JoinAllFuture, it only re-polls the futures that have been woken, and its state is
+ * freed once the outcome is decided, while the losers' wakes may still be under way.
+ */
+typedef struct QuorumFuture {
+    Future base; // Base future structure
+    Future** futs; // Futures to execute
+    size_t n;
+    size_t k; // Number of futures that have to complete.
+    size_t n_completed;
+    size_t n_failed;
+    size_t winner; // Index of the first future that completed (if any).
+    FutureResult* results; // One per future.
+    struct ReadySet* ready; // Which futures have been woken (while running).
+} QuorumFuture;
+
+/** Creates a QuorumFuture that completes once `k` of `n` futures complete. */
+QuorumFuture future_quorum(Future** futs, size_t n, size_t k, FutureResult* results);
+
+/**
+ * Creates a QuorumFuture that completes with the first of `n` futures to complete (k = 1),
+ * e.g. the fastest of hedged requests to replicas.
+ */
+QuorumFuture future_select_any(Future** futs, size_t n, FutureResult* results);
+
 /**
  * A combinator that executes two futures until one of them completes.
  *
  * The SelectFuture is considered COMPLETED when fut1 or fut2 are COMPLETED.
  * SelectFuture shall progress the other future even if one of the futures returned FAILURE.
  * SelectFuture shall only propagate error (of whichever future) if both futures fail.
+ *
+ * Like JoinFuture, it only re-polls the futures that have been woken. Once one of the
+ * futures completes, the other one (if still pending) is cancelled (see `CancelFn`), e.g.
+ * releasing its Mio registration, so that it does not keep waking the SelectFuture.
  */
 typedef struct SelectFuture {
     Future base; // Base future structure
@@ -79,9 +164,32 @@ typedef struct SelectFuture {
         SELECT_FAILED_FUT2, // Future 2 has failed and future 1 has not yet completed.
         SELECT_FAILED_BOTH, // Both futures have failed.
     } which_completed;
+    WakeCell* ready; // Bit i set: future i+1 has been woken (see `waker_for_child()`).
 } SelectFuture;
 
 /** Creates a SelectFuture that executes two futures until one of them completes successfully. */
 SelectFuture future_select(Future* fut1, Future* fut2);
 
+#define TIMEOUT_FUTURE_ERR_FUT_FAILED 1
+#define TIMEOUT_FUTURE_ERR_TIMED_OUT 2
+
+/**
+ * A combinator that bounds the time a future may take.
+ *
+ * The TimeoutFuture is considered COMPLETED when fut is COMPLETED before the deadline
+ * (in milliseconds, see `timer_now_ms()`), with the same result (base.ok := fut->ok).
+ * If fut returns FAILURE, TimeoutFuture returns FAILURE with TIMEOUT_FUTURE_ERR_FUT_FAILED.
+ * If the deadline passes first, fut is cancelled (see `CancelFn`), e.g. releasing its Mio
+ * registration, and TimeoutFuture returns FAILURE with TIMEOUT_FUTURE_ERR_TIMED_OUT.
+ */
+typedef struct TimeoutFuture {
+    Future base; // Base future structure
+    Future* fut; // Future to execute
+    uint64_t deadline; // When to give up on fut
+    TimerEntry timer; // Timer armed in Mio while fut is pending
+} TimeoutFuture;
+
+/** Creates a TimeoutFuture that fails if fut does not complete before the deadline. */
+TimeoutFuture future_timeout(Future* fut, uint64_t deadline);
+
 #endif // FUTURE_COMBINATORS_H
@@ -4,9 +4,13 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
 
 #include "future.h"
 #include "future_combinators.h"
+#include "timer_wheel.h"
 #include "waker.h"
 
 // ========================= ApplyFuture =========================
@@ -29,16 +33,22 @@ typedef struct PipeReadFuture {
     uint8_t* buffer; // Buffer to store the result
     size_t n; // Size of the buffer = number of bytes to be read
     size_t read_so_far; // Number of bytes read so far
+    int op; // Read submitted to Mio's io_uring, if any (-1 otherwise).
 } PipeReadFuture;
 
 #define PIPE_FUTURE_ERR_EOF 1
+#define PIPE_FUTURE_ERR_IO 2
 
 /**
  * Creates a future that reads a fixed number of bytes from a pipe.
  *
  * The future will call read() from the specified file descriptor
  * until exactly n bytes are read or EOF is reached (write-end of pipe is closed).
- * In the latter case, resolves to FUTURE_FAILURE with errcode set to PIPE_FUTURE_ERR_EOF.
+ * In the latter case, resolves to FUTURE_FAILURE with errcode set to PIPE_FUTURE_ERR_EOF
+ * (or PIPE_FUTURE_ERR_IO if read() fails).
+ *
+ * With Mio's io_uring backend, the reads are submitted to the kernel, which completes them
+ * straight into the buffer, instead of waiting for readiness and calling read().
  */
 PipeReadFuture pipe_read_future_create(int fd, uint8_t* buffer, size_t n);
 
@@ -49,6 +59,7 @@ typedef struct PipeWriteFuture {
     size_t n; // Number of bytes to be write (input must be at least that size).
     bool stop_on_zero_byte; // Whether to stop writing after a zero byte is written.
     size_t written_so_far; // Number of bytes written so far.
+    int op; // Write submitted to Mio's io_uring, if any (-1 otherwise).
 } PipeWriteFuture;
 
 /**
@@ -57,7 +68,260 @@ typedef struct PipeWriteFuture {
  * The future will call write() to the specified file descriptor
  * until exactly n bytes are written or a zero byte is written (if stop_on_zero_byte is true).
  * Bytes to be written are taken from the argument of the future `(const char*)future->base.arg`.
+ * Like PipeReadFuture, it fails with PIPE_FUTURE_ERR_EOF or PIPE_FUTURE_ERR_IO, and submits
+ * its writes to the io_uring (if Mio has one).
  */
 PipeWriteFuture pipe_write_future_create(int fd, size_t n, bool stop_on_zero_byte);
 
+// ========================= PipeReadvFuture =========================
+typedef struct PipeReadvFuture {
+    Future base; // Base future structure.
+    int fd; // File descriptor to read from.
+    struct iovec* iov; // Segments to fill, in order.
+    int iovcnt; // Number of segments.
+    int iov_index; // Segment being filled.
+    size_t iov_offset; // Bytes of that segment filled so far.
+    size_t read_so_far; // Bytes read so far (in all segments).
+} PipeReadvFuture;
+
+/**
+ * Creates a future that fills all of `iovcnt` segments (e.g. a header, then a payload) from a
+ * pipe, with readv(): a single syscall for as many segments as there are bytes available.
+ *
+ * A readv() that stops within a segment is resumed where it stopped on the next progress().
+ * `iov` is not modified (between calls). Completes with `ok` pointing at `iov`; fails like
+ * PipeReadFuture. With Mio's io_uring backend too, it waits for readiness and calls readv().
+ */
+PipeReadvFuture pipe_readv_future_create(int fd, struct iovec* iov, int iovcnt);
+
+// ========================= PipeWritevFuture =========================
+typedef struct PipeWritevFuture {
+    Future base; // Base future structure.
+    int fd; // File descriptor to write to.
+    struct iovec* iov; // Segments to write, in order.
+    int iovcnt; // Number of segments.
+    int iov_index; // Segment being written.
+    size_t iov_offset; // Bytes of that segment written so far.
+    size_t written_so_far; // Bytes written so far (from all segments).
+} PipeWritevFuture;
+
+/**
+ * Creates a future that writes all of `iovcnt` segments to a pipe with writev(), so that e.g.
+ * a header and a payload go out together without being copied into one buffer first.
+ *
+ * Partial writes are resumed like PipeReadvFuture's reads. Completes with `ok` pointing at `iov`;
+ * fails like PipeWriteFuture.
+ */
+PipeWritevFuture pipe_writev_future_create(int fd, struct iovec* iov, int iovcnt);
+
+// ========================= SpliceFuture =========================
+typedef struct SpliceFuture {
+    Future base; // Base future structure.
+    int in_fd; // File descriptor to forward from.
+    int out_fd; // File descriptor to forward to.
+    int tee_fd; // Pipe that gets a copy of everything (-1 if none).
+    int pipe[2]; // Internal pipe the data moves through (-1 before the first progress).
+    size_t buffered; // Bytes in the internal pipe.
+    size_t teed; // Bytes at the front of the internal pipe already copied to tee_fd.
+    bool eof; // in_fd has reached EOF.
+    size_t n_forwarded; // Bytes forwarded to out_fd so far.
+    int error;
+} SpliceFuture;
+
+#define SPLICE_FUTURE_ERR_IO 1 // The failing call's errno is in the future's `error`.
+
+/**
+ * Creates a future that forwards everything from `in_fd` to `out_fd` until EOF, with splice()
+ * through an internal pipe, so that the bytes never get copied to user space. One end of each
+ * splice() has to be a pipe, so either fd can be a pipe or a socket (and `in_fd` a file).
+ *
+ * If `tee_fd` (a pipe) is not -1, the data is also copied to it with tee(), and forwarded at the
+ * pace of the slower of the two. The fds have to be non-blocking (set O_NONBLOCK).
+ *
+ * Completes once `in_fd` reaches EOF and everything has been forwarded, with `ok` pointing at
+ * `n_forwarded`; the fds are left open. Fails with SPLICE_FUTURE_ERR_IO.
+ */
+SpliceFuture splice_future_create(int in_fd, int out_fd, int tee_fd);
+
+// ========================= SendfileFuture =========================
+typedef struct SendfileFuture {
+    Future base; // Base future structure.
+    int file_fd; // File to send from (its file offset is left unchanged).
+    int out_fd; // Socket or pipe to send to.
+    off_t offset; // Offset in the file of the next byte to send.
+    size_t length; // Number of bytes to send.
+    size_t n_sent; // Number of bytes sent so far.
+    int error;
+} SendfileFuture;
+
+#define SENDFILE_FUTURE_ERR_EOF 1 // The file ends before the region does.
+#define SENDFILE_FUTURE_ERR_IO 2 // The failing call's errno is in the future's `error`.
+
+/**
+ * Creates a future that sends `length` bytes of a file, from `offset` on, to a socket or pipe
+ * (which has to be non-blocking), with sendfile(): the kernel copies them from the page cache
+ * itself, without the bytes going through user space.
+ *
+ * Waits for `out_fd` to be writable whenever it is full. Completes with `ok` pointing at
+ * `n_sent`; fails with SENDFILE_FUTURE_ERR_EOF (after sending up to the end of the file) or
+ * SENDFILE_FUTURE_ERR_IO.
+ */
+SendfileFuture sendfile_future_create(int file_fd, int out_fd, off_t offset, size_t length);
+
+// ========================= SleepFuture =========================
+typedef struct SleepFuture {
+    Future base; // Base future structure.
+    uint64_t deadline; // When to complete, in milliseconds (see timer_now_ms()).
+    TimerEntry timer; // Timer armed in Mio on the first progress.
+} SleepFuture;
+
+/** Creates a future that completes once `deadline` (see `timer_now_ms()`) has passed. */
+SleepFuture sleep_until_future_create(uint64_t deadline);
+
+/** Creates a future that completes `ms` milliseconds after its creation. */
+SleepFuture sleep_for_future_create(uint64_t ms);
+
+// ============================== TCP ===============================
+
+/** Options (a bitmask) of the sockets made by TcpAcceptFuture and TcpConnectFuture. */
+#define TCP_OPTION_NODELAY 1u // Disable Nagle's algorithm (TCP_NODELAY), for request-response.
+
+#define TCP_FUTURE_ERR_EOF 1
+#define TCP_FUTURE_ERR_IO 2 // The failing call's errno is in the future's `error`.
+
+/**
+ * Creates a non-blocking TCP socket (IPv4 or IPv6, by `addr`) listening on `addr`; with port 0,
+ * the kernel picks a free port (see getsockname()). Returns the socket, or -1 (with errno set).
+ */
+int tcp_listen(struct sockaddr const* addr, socklen_t addr_len, int backlog);
+
+// ========================= TcpAcceptFuture =========================
+typedef struct TcpAcceptFuture {
+    Future base;
+    int listen_fd;
+    int* fds; // Accepted (non-blocking) connections.
+    size_t max_fds; // Capacity of `fds`.
+    size_t n_accepted;
+    unsigned options; // TCP_OPTION_* of the accepted connections.
+    int error;
+} TcpAcceptFuture;
+
+/**
+ * Creates a future that accepts connections on a listening socket (see `tcp_listen()`).
+ *
+ * Once the socket is ready, the future calls accept4() until it fails with EAGAIN (or `max_fds`
+ * connections have been accepted), so a burst of connections costs a single wakeup; then it
+ * completes with `n_accepted` (at least 1) connections in `fds`, which `ok` points at.
+ * Fails with TCP_FUTURE_ERR_IO if accept4() fails otherwise before accepting any. A connection
+ * whose `options` cannot be set is closed, and counts as such a failure.
+ */
+TcpAcceptFuture tcp_accept_future_create(int listen_fd, int* fds, size_t max_fds, unsigned options);
+
+// ========================= TcpConnectFuture =========================
+typedef struct TcpConnectFuture {
+    Future base;
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    unsigned options; // TCP_OPTION_* of the socket.
+    int fd; // The connecting socket (-1 before the first progress, and after a failure).
+    int error;
+} TcpConnectFuture;
+
+/**
+ * Creates a future that opens a non-blocking TCP connection to `addr` (IPv4 or IPv6).
+ *
+ * It completes once the connection is established, with `ok` pointing at `fd`; the socket is
+ * then the caller's to close. Fails with TCP_FUTURE_ERR_IO (e.g., ECONNREFUSED) otherwise, also
+ * if `options` cannot be set, or with EINVAL if `addr_len` exceeds a `struct sockaddr_storage`.
+ */
+TcpConnectFuture tcp_connect_future_create(
+    struct sockaddr const* addr, socklen_t addr_len, unsigned options);
+
+// ========================= TcpReadFuture =========================
+typedef struct TcpReadFuture {
+    Future base;
+    int fd;
+    uint8_t* buffer;
+    size_t n; // Size of the buffer.
+    size_t min; // Number of bytes to read before completing.
+    size_t n_read; // Number of bytes read so far.
+    int error;
+} TcpReadFuture;
+
+/**
+ * Creates a future that reads from a socket until it has read at least `min` (1 to `n`) bytes,
+ * e.g. whatever is available with `min` = 1, or a whole message with `min` = `n`.
+ * With `n` = 0, it completes at once (without calling recv()).
+ *
+ * Completes with `ok` pointing at the buffer and `n_read` bytes in it. Fails with
+ * TCP_FUTURE_ERR_EOF if the peer closes the connection first (`n_read` bytes have arrived
+ * until then), or TCP_FUTURE_ERR_IO (e.g., ECONNRESET).
+ */
+TcpReadFuture tcp_read_future_create(int fd, uint8_t* buffer, size_t n, size_t min);
+
+// ========================= TcpWriteFuture =========================
+typedef struct TcpWriteFuture {
+    Future base;
+    int fd;
+    uint8_t const* buffer;
+    size_t n; // Number of bytes to write.
+    size_t n_written; // Number of bytes written so far.
+    int error;
+} TcpWriteFuture;
+
+/**
+ * Creates a future that writes `n` bytes from `buffer` to a socket. Fails with TCP_FUTURE_ERR_IO
+ * (e.g., EPIPE, without raising SIGPIPE) if the connection breaks first.
+ */
+TcpWriteFuture tcp_write_future_create(int fd, uint8_t const* buffer, size_t n);
+
+// ============================== UDP ===============================
+
+struct mmsghdr; // From <sys/socket.h> (with _GNU_SOURCE).
+
+#define UDP_FUTURE_ERR_IO 1 // The failing call's errno is in the future's `error`.
+
+/**
+ * Creates a non-blocking UDP socket (IPv4 or IPv6, by `addr`) bound to `addr`; with port 0,
+ * the kernel picks a free port (see getsockname()). Returns the socket, or -1 (with errno set).
+ */
+int udp_bind(struct sockaddr const* addr, socklen_t addr_len);
+
+// ========================= UdpRecvFuture =========================
+typedef struct UdpRecvFuture {
+    Future base;
+    int fd;
+    struct mmsghdr* msgs; // Set up by the caller (msg_iov, and msg_name if wanted).
+    size_t max_msgs; // Number of `msgs`.
+    size_t n_received;
+    int error;
+} UdpRecvFuture;
+
+/**
+ * Creates a future that receives datagrams on a UDP socket with recvmmsg(), up to `max_msgs` of
+ * them per call, each into the buffers of one of `msgs`.
+ *
+ * Completes once the socket had datagrams, with the first `n_received` (at least 1) of `msgs`
+ * filled in (`msg_len` is the size of each), and `ok` pointing at `msgs`.
+ * Fails with UDP_FUTURE_ERR_IO if recvmmsg() fails otherwise than with EAGAIN.
+ */
+UdpRecvFuture udp_recv_future_create(int fd, struct mmsghdr* msgs, size_t max_msgs);
+
+// ========================= UdpSendFuture =========================
+typedef struct UdpSendFuture {
+    Future base;
+    int fd;
+    struct mmsghdr* msgs; // Set up by the caller (msg_iov, and msg_name unless connected).
+    size_t n_msgs; // Number of `msgs` to send.
+    size_t n_sent; // Number of `msgs` sent so far.
+    int error;
+} UdpSendFuture;
+
+/**
+ * Creates a future that sends `n_msgs` datagrams, one per `msgs`, on a UDP socket with
+ * sendmmsg() (as many per call as the socket takes), waiting whenever the socket is full.
+ * Fails with UDP_FUTURE_ERR_IO if sendmmsg() fails otherwise than with EAGAIN.
+ */
+UdpSendFuture udp_send_future_create(int fd, struct mmsghdr* msgs, size_t n_msgs);
+
 #endif // FUTURE_EXAMPLES_H
@@ -1,8 +1,12 @@
 #ifndef MIO_H
 #define MIO_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h> // For uint32_t
 
+#include "timer_wheel.h"
+
 typedef struct Executor Executor;
 
 /** Represents the MIO event loop instance. */
@@ -11,8 +15,22 @@ typedef struct Mio Mio;
 /** Represents a mechanism to wake up a task when an event occurs. */
 typedef struct Waker Waker;
 
-/** Creates a new MIO event loop instance (NULL on failure). */
-Mio* mio_create(Executor* executor);
+/** Kernel interfaces Mio can wait with. */
+typedef enum MioBackend {
+    MIO_BACKEND_EPOLL, // Readiness only: futures do their reads and writes themselves.
+    MIO_BACKEND_IO_URING, // Also completions: see `mio_submit_read()`.
+} MioBackend;
+
+/**
+ * Creates a new MIO event loop instance (NULL on failure).
+ *
+ * With MIO_BACKEND_IO_URING, falls back to epoll if the kernel does not support io_uring
+ * (see `mio_backend()`); registrations and timers work the same with both backends.
+ */
+Mio* mio_create(Executor* executor, MioBackend backend);
+
+/** Returns the backend a MIO instance actually uses. */
+MioBackend mio_backend(Mio* mio);
 
 /** Destroys a MIO instance and releases its resources. */
 void mio_destroy(Mio* mio);
@@ -21,19 +39,154 @@ void mio_destroy(Mio* mio);
  * Registers a file descriptor with MIO to monitor specific events.
  *
  * When the specified events occur on the file descriptor, the associated Waker is invoked.
+ * Each fd has a read waker and a write waker, so that e.g. one future can read from a socket
+ * while another one writes to it; registering again for the same event replaces its waker.
+ * Hangups and errors wake both. A waker is woken once: a future that finds the fd still not
+ * ready after being woken has to register again.
  *
  * @param mio Pointer to the Mio instance.
  * @param fd File descriptor to register.
- * @param events Events to monitor (EPOLLIN or EPOLLOUT for read or write availability).
+ * @param events Events to monitor (EPOLLIN and/or EPOLLOUT for read or write availability).
  * @param waker Waker that will be notified on events.
  * @return 0 on success, -1 on failure.
  */
 int mio_register(Mio* mio, int fd, uint32_t events, Waker waker);
 
-/** Unregisters a file descriptor from MIO. Returns 0 on success, -1 on failure. */
+/**
+ * Stops monitoring some events (EPOLLIN and/or EPOLLOUT) of a file descriptor, leaving the
+ * waker of the other one (if any) in place. Returns 0 on success, -1 on failure.
+ */
+int mio_unregister_interest(Mio* mio, int fd, uint32_t events);
+
+/** Unregisters a file descriptor (both events) from MIO. Returns 0 on success, -1 on failure. */
 int mio_unregister(Mio* mio, int fd);
 
-/** Waits for any ready event and invokes their Wakers. */
+/**
+ * Registers a file descriptor once for its whole lifetime (until `mio_unregister()`), for both
+ * reading and writing, edge-triggered (EPOLLET).
+ *
+ * Mio then caches its readiness, so that futures only have to call into Mio when an operation
+ * fails with EAGAIN (see `mio_clear_readiness()`), instead of adding and removing the fd from
+ * epoll whenever they wait for it. The fd starts out as ready for both.
+ * `mio_register()` and `mio_unregister_interest()` only set and clear its wakers.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int mio_register_persistent(Mio* mio, int fd);
+
+/** Cached readiness of a persistently registered fd. */
+typedef struct MioReadiness {
+    uint32_t tick; // Number of events received for the fd so far (wrapping around).
+    uint32_t events; // EPOLLIN and/or EPOLLOUT, if the fd may be ready for them.
+} MioReadiness;
+
+/**
+ * Reads the cached readiness of a file descriptor into `*readiness`, or returns false if it is
+ * not registered persistently (then the futures using it should call `mio_register()`).
+ *
+ * Futures should read it before an operation, and skip the operation if the fd is not ready.
+ */
+bool mio_readiness(Mio* mio, int fd, MioReadiness* readiness);
+
+/**
+ * Tells Mio that an operation on a persistently registered fd has failed with EAGAIN (or has
+ * been skipped as the fd was not ready): clears `events` from the cached readiness and sets the
+ * waker that the next event will wake (like `mio_register()`).
+ *
+ * `readiness` is what `mio_readiness()` returned before the operation. If an event has arrived
+ * since then, nothing is cleared (that event may have made the operation possible) and false
+ * is returned: the caller should read the readiness and try again instead of waiting.
+ */
+bool mio_clear_readiness(Mio* mio, int fd, MioReadiness readiness, uint32_t events, Waker waker);
+
+/**
+ * Submits a read of up to `n` bytes from `fd` straight into `buffer` (io_uring backend only).
+ *
+ * All the operations submitted during an executor tick go to the kernel in one system call,
+ * at the next poll; once the operation completes, `waker` is invoked (see `mio_op_poll()`).
+ * The buffer must stay valid until then, or until `mio_op_cancel()` returns.
+ * Returns the id of the operation, or -1 on failure (e.g., with the epoll backend).
+ */
+int mio_submit_read(Mio* mio, int fd, void* buffer, size_t n, Waker waker);
+
+/** Like `mio_submit_read()`, but writes up to `n` bytes from `buffer` to `fd`. */
+int mio_submit_write(Mio* mio, int fd, void const* buffer, size_t n, Waker waker);
+
+/**
+ * Checks a submitted operation: if it has completed, stores its result (bytes transferred,
+ * or -errno) in `*result`, releases the id and returns true. Otherwise sets the waker to
+ * invoke on completion and returns false.
+ */
+bool mio_op_poll(Mio* mio, int op, Waker waker, int* result);
+
+/**
+ * Cancels a submitted operation that has not been released by `mio_op_poll()` yet, and waits
+ * until the kernel is done with its buffer (it may still complete instead). Releases the id.
+ */
+void mio_op_cancel(Mio* mio, int op);
+
+/** Initial (and minimal) number of events a single epoll_wait() call can return. */
+#define MIO_MIN_EVENTS 64
+
+/** Default bound to which the events buffer grows (see `mio_set_max_events()`). */
+#define MIO_DEFAULT_MAX_EVENTS 4096
+
+/**
+ * Sets the ceiling on the number of events a single epoll_wait() call can return (at least
+ * MIO_MIN_EVENTS). May be called from any thread.
+ *
+ * Mio sizes its events buffer by the readiness it observes: it doubles the buffer whenever a
+ * poll fills it, and halves it after a run of polls that leave it mostly empty. After a full
+ * batch, it keeps polling (without blocking) before returning, so that with many ready fds one
+ * executor tick sees them all instead of one buffer's worth.
+ */
+void mio_set_max_events(Mio* mio, size_t max_events);
+
+/** Buckets of `MioStats.batch_sizes`. */
+#define MIO_BATCH_BUCKETS 16
+
+/** Counters of the system calls made by Mio, see `mio_stats()`. */
+typedef struct MioStats {
+    uint64_t n_polls; // Calls to epoll_wait() and io_uring_enter().
+    uint64_t n_events; // Events returned by epoll_wait().
+    uint64_t n_ctls; // Calls to epoll_ctl().
+    uint64_t n_submitted; // Reads and writes submitted to the io_uring (not system calls).
+    // Calls to epoll_wait() by the number of events n they returned: bucket 0 counts those
+    // that returned none, bucket i those with 2^(i-1) <= n < 2^i (the last one also larger n).
+    uint64_t batch_sizes[MIO_BATCH_BUCKETS];
+} MioStats;
+
+/** Reads the counters of a MIO instance (may be called from any thread). */
+void mio_stats(Mio* mio, MioStats* stats);
+
+/**
+ * Waits for any ready event or timer and invokes their Wakers.
+ *
+ * The wait is bounded by the earliest deadline among the armed timers.
+ */
 void mio_poll(Mio* mio);
 
+/**
+ * Like mio_poll(), but never blocks: only invokes the Wakers of already ready events and
+ * expired timers (the executor calls it when its queue is busy for long, see EXECUTOR_TICK_BUDGET).
+ */
+void mio_poll_nowait(Mio* mio);
+
+/**
+ * Arms a timer: `waker` will be invoked once `deadline` (see `timer_now_ms()`) has passed.
+ *
+ * Re-arming an armed timer moves its deadline. May be called from any thread.
+ */
+void mio_timer_arm(Mio* mio, TimerEntry* timer, uint64_t deadline, Waker waker);
+
+/** Cancels a timer. Returns false if it was not armed (e.g., it has already fired). */
+bool mio_timer_cancel(Mio* mio, TimerEntry* timer);
+
+/**
+ * Makes a pending or the next mio_poll() call return early (without waking any future).
+ *
+ * Unlike the other functions, this one may be called from any thread.
+ */
+void mio_wakeup(Mio* mio);
+
 #endif // MIO_H
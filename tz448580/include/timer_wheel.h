@@ -0,0 +1,92 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "waker.h"
+
+// The wheel has TIMER_WHEEL_LEVELS levels of TIMER_WHEEL_SLOTS slots each. A slot on level L
+// spans TIMER_WHEEL_SLOTS^L milliseconds, so the wheel covers 2^36 ms (over two years);
+// later deadlines are clamped to that.
+#define TIMER_WHEEL_LEVELS 6
+#define TIMER_WHEEL_SLOT_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_MAX_DELAY ((UINT64_C(1) << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOT_BITS)) - 1)
+
+/** States of a TimerEntry. */
+enum {
+    TIMER_IDLE, // Never armed, or cancelled.
+    TIMER_ARMED, // Waiting in a wheel.
+    TIMER_FIRED, // The deadline passed and the waker was called.
+};
+
+/**
+ * A timer that calls a waker once its deadline (in milliseconds, see `timer_now_ms()`) passes.
+ *
+ * Timers are intrusive: the wheel links them in place, so arming and cancelling never allocate.
+ * BEWARE: an armed timer must not be moved or deallocated until it fires or is cancelled.
+ */
+typedef struct TimerEntry {
+    struct TimerEntry* prev; // Neighbours in the wheel slot (only meaningful while armed).
+    struct TimerEntry* next;
+    uint64_t deadline;
+    uint8_t level; // Position in the wheel (only meaningful while armed).
+    uint8_t slot;
+    atomic_int state; // One of the TIMER_* values above.
+    Waker waker;
+} TimerEntry;
+
+static inline TimerEntry timer_entry_create(void)
+{
+    return (TimerEntry) {
+        .prev = NULL,
+        .next = NULL,
+        .deadline = 0,
+        .level = 0,
+        .slot = 0,
+        .state = TIMER_IDLE,
+        .waker = { .executor = NULL, .future = NULL },
+    };
+}
+
+/**
+ * A hierarchical timing wheel: timers are bucketed by deadline into slots of increasing
+ * granularity, and moved to finer levels as time approaches their deadline.
+ *
+ * Inserting and removing a timer is O(1); finding the next deadline costs O(levels).
+ * The wheel itself is not thread-safe (Mio guards it with a lock).
+ */
+typedef struct TimerWheel {
+    uint64_t elapsed; // Time up to which the wheel has been advanced.
+    uint64_t occupied[TIMER_WHEEL_LEVELS]; // Bitmask of non-empty slots per level.
+    TimerEntry* slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS]; // Heads of doubly-linked timer lists.
+    size_t n_timers;
+} TimerWheel;
+
+/** Returns the current time in milliseconds (of CLOCK_MONOTONIC). */
+uint64_t timer_now_ms(void);
+
+/** Initializes an empty wheel, starting at time `now`. */
+void timer_wheel_init(TimerWheel* wheel, uint64_t now);
+
+/** Inserts a timer (in state TIMER_ARMED) with `timer->deadline` already set. */
+void timer_wheel_insert(TimerWheel* wheel, TimerEntry* timer);
+
+/** Removes an armed timer from the wheel. */
+void timer_wheel_remove(TimerWheel* wheel, TimerEntry* timer);
+
+/** Returns the earliest time at which some timer may fire, or UINT64_MAX if there are none. */
+uint64_t timer_wheel_next_deadline(TimerWheel* wheel);
+
+/**
+ * Advances the wheel towards time `now`, firing timers whose deadline is at most `now`: their
+ * state is set to TIMER_FIRED and their wakers are copied into `fired`, for the caller to call
+ * (e.g. once it has released its lock). Returns the number of fired timers, at most `max_fired`;
+ * if the buffer fills up, the wheel stops short of `now` and has to be advanced again.
+ */
+size_t timer_wheel_advance(TimerWheel* wheel, uint64_t now, Waker* fired, size_t max_fired);
+
+#endif // TIMER_WHEEL_H
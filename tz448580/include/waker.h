@@ -1,11 +1,60 @@
 #ifndef WAKER_H
 #define WAKER_H
 
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 #include "debug.h"
 
 typedef struct Executor Executor;
 typedef struct Future Future;
 
+/**
+ * A word of ready bits of a combinator, one per child (see `waker_for_child()`).
+ *
+ * A wake through a child's waker sets the child's bit (and, up the chain, the bits of the
+ * enclosing combinators in their parents) before waking the task, so that each combinator can
+ * re-poll only the children that were woken instead of all of them.
+ *
+ * Wakers may outlive the combinator (e.g. a wake already taken out of Mio when the child is
+ * cancelled), so wakers refer to cells by index and generation instead of by pointer. Cells come
+ * from a process-wide pool and are never returned to the system: releasing a cell bumps its
+ * generation, and a wake that finds another generation stops there.
+ */
+typedef struct WakeCell {
+    _Atomic uint64_t bits;
+    _Atomic uint64_t parent; // Link to the combinator's own bit (see `wake_cell_link()`), or 0.
+    _Atomic uint32_t generation; // Bumped on release (never 0).
+    uint32_t index; // Position in the pool (fixed).
+    struct WakeCell* next_free; // While released: next cell on the pool's free list.
+} WakeCell;
+
+/**
+ * Allocates `n` cells (with no bits set) into `cells`. Returns false if the pool cannot grow.
+ *
+ * A stale wake may still set bits of a freshly allocated cell, so users must tolerate spurious
+ * bits (including ones past their last child).
+ */
+bool wake_cells_alloc(WakeCell** cells, size_t n);
+
+/** Returns cells obtained from wake_cells_alloc() to the pool; wakers linking to them go stale. */
+void wake_cells_release(WakeCell* const* cells, size_t n);
+
+/** Returns the link to bit `bit` (< 64) of `cell` in its current generation. */
+static inline uint64_t wake_cell_link(WakeCell* cell, unsigned bit)
+{
+    uint64_t const generation = atomic_load_explicit(&cell->generation, memory_order_relaxed);
+    return generation << 32 | (uint64_t) cell->index << 6 | bit;
+}
+
+/**
+ * Sets the bit a link points to and the bits of its parents, stopping at the first cell that has
+ * been released since the link was made. Links of 0 are ignored.
+ */
+void wake_link_set(uint64_t link);
+
 /**
  * A Waker is used to notify the executor that a future is ready to make progress.
  *
@@ -15,9 +64,34 @@ typedef struct Future Future;
 typedef struct Waker {
     void* executor; // Executor to be notified about the future.
     Future* future; // Future to be requeued up by executor.
+    uint64_t flag; // Ready bit to set first (0 unless made by waker_for_child()).
 } Waker;
 
-/** Invoked when the associated future becomes ready. */
+/**
+ * Returns the waker a combinator should pass to one of its children: it sets the child's bit
+ * (`bit` of `cell`), and then does whatever the combinator's own `waker` does.
+ *
+ * `cell` must be owned by the combinator, and all of the children in it must share the same
+ * parent `waker`.
+ */
+static inline Waker waker_for_child(Waker waker, WakeCell* cell, unsigned bit)
+{
+    // Only written when changed, as other threads may be reading the link (to wake the child).
+    if (atomic_load_explicit(&cell->parent, memory_order_relaxed) != waker.flag) {
+        atomic_store_explicit(&cell->parent, waker.flag, memory_order_release);
+    }
+    waker.flag = wake_cell_link(cell, bit);
+    return waker;
+}
+
+/**
+ * Invoked when the associated future becomes ready.
+ *
+ * May be called from any thread. Wakes from outside of the executor's threads go through a
+ * lock-free queue and unpark the executor if it is blocked in mio_poll(). This also works from
+ * a signal handler (with debug prints disabled), as long as the signal is not delivered to a
+ * thread that runs the executor.
+ */
 void waker_wake(struct Waker* waker);
 
 static inline void debug_print_waker(Waker const* waker)
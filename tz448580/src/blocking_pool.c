@@ -0,0 +1,219 @@
+#include "blocking_pool.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "debug.h"
+#include "err.h"
+#include "waker.h"
+
+/** A job being run by a pool thread (on the thread's stack). */
+typedef struct BlockingRun {
+    BlockingFuture* job; // NULL once the job is cancelled: its future is not to be touched.
+    struct BlockingRun* next;
+} BlockingRun;
+
+struct BlockingPool {
+    pthread_mutex_t lock; // Protects all the fields below.
+    pthread_cond_t work_cond; // Signalled when a job is queued (or the pool shuts down).
+    pthread_cond_t done_cond; // Broadcast when a thread has woken the future of its job.
+    BlockingFuture* head; // Queue of jobs waiting for a thread (linked through `next_job`).
+    BlockingFuture* tail;
+    BlockingRun* running; // Jobs being run.
+    size_t n_waiters; // Threads waiting on `done_cond`.
+    pthread_t* threads;
+    size_t n_threads;
+    size_t n_idle;
+    size_t max_threads;
+    bool shutdown;
+};
+
+static void* blocking_thread_main(void* arg)
+{
+    BlockingPool* pool = arg;
+
+    ASSERT_ZERO(pthread_mutex_lock(&pool->lock));
+    for (;;) {
+        while (!pool->head && !pool->shutdown) {
+            pool->n_idle++;
+            ASSERT_ZERO(pthread_cond_wait(&pool->work_cond, &pool->lock));
+            pool->n_idle--;
+        }
+        if (!pool->head) {
+            break; // Shut down, and nothing left to do.
+        }
+
+        BlockingFuture* job = pool->head;
+        pool->head = job->next_job;
+        if (!pool->head) {
+            pool->tail = NULL;
+        }
+        atomic_store(&job->job_state, BLOCKING_JOB_RUNNING);
+        BlockingRun run = { .job = job, .next = pool->running };
+        pool->running = &run;
+        void* (*func)(void*) = job->func;
+        void* arg = job->base.arg;
+        ASSERT_ZERO(pthread_mutex_unlock(&pool->lock));
+
+        debug("[BlockingPool] Running job of future %p\n", job);
+        void* result = func(arg);
+
+        ASSERT_ZERO(pthread_mutex_lock(&pool->lock));
+        BlockingRun** link = &pool->running;
+        while (*link != &run) {
+            link = &(*link)->next;
+        }
+        *link = run.next;
+        if (!run.job) {
+            debug("[BlockingPool] Dropping the result of cancelled job %p\n", job);
+            continue;
+        }
+        job->base.ok = result;
+        Waker waker = job->waker;
+
+        // Wake without holding the lock (waker_wake() may take the executor's), but mark the
+        // wake as under way, see blocking_pool_wait_woken().
+        atomic_store(&job->job_state, BLOCKING_JOB_WAKING);
+        ASSERT_ZERO(pthread_mutex_unlock(&pool->lock));
+        waker_wake(&waker);
+        ASSERT_ZERO(pthread_mutex_lock(&pool->lock));
+        atomic_store(&job->job_state, BLOCKING_JOB_DONE);
+        if (pool->n_waiters > 0) {
+            ASSERT_ZERO(pthread_cond_broadcast(&pool->done_cond));
+        }
+    }
+    ASSERT_ZERO(pthread_mutex_unlock(&pool->lock));
+    return NULL;
+}
+
+BlockingPool* blocking_pool_create(size_t max_threads)
+{
+    BlockingPool* pool = (BlockingPool*) malloc(sizeof(BlockingPool));
+    if (!pool) {
+        return NULL;
+    }
+    ASSERT_ZERO(pthread_mutex_init(&pool->lock, NULL));
+    ASSERT_ZERO(pthread_cond_init(&pool->work_cond, NULL));
+    ASSERT_ZERO(pthread_cond_init(&pool->done_cond, NULL));
+    pool->head = NULL;
+    pool->tail = NULL;
+    pool->running = NULL;
+    pool->n_waiters = 0;
+    pool->threads = NULL;
+    pool->n_threads = 0;
+    pool->n_idle = 0;
+    pool->max_threads = 0;
+    pool->shutdown = false;
+    blocking_pool_set_max_threads(pool, max_threads);
+    return pool;
+}
+
+void blocking_pool_set_max_threads(BlockingPool* pool, size_t max_threads)
+{
+    // The lock also keeps blocking_pool_submit() from starting a thread into the array meanwhile.
+    ASSERT_ZERO(pthread_mutex_lock(&pool->lock));
+    if (max_threads < pool->n_threads) {
+        max_threads = pool->n_threads;
+    }
+    if (max_threads == 0) {
+        max_threads = 1;
+    }
+    pthread_t* threads = (pthread_t*) realloc(pool->threads, max_threads * sizeof(pthread_t));
+    if (!threads) {
+        fatal("blocking_pool_set_max_threads (realloc)");
+    }
+    pool->threads = threads;
+    pool->max_threads = max_threads;
+    ASSERT_ZERO(pthread_mutex_unlock(&pool->lock));
+}
+
+void blocking_pool_submit(BlockingPool* pool, BlockingFuture* job)
+{
+    ASSERT_ZERO(pthread_mutex_lock(&pool->lock));
+    job->next_job = NULL;
+    if (pool->tail) {
+        pool->tail->next_job = job;
+    } else {
+        pool->head = job;
+    }
+    pool->tail = job;
+    atomic_store(&job->job_state, BLOCKING_JOB_QUEUED);
+
+    if (pool->n_idle > 0) {
+        ASSERT_ZERO(pthread_cond_signal(&pool->work_cond));
+    } else if (pool->n_threads < pool->max_threads) {
+        debug("[BlockingPool] Starting thread %zu\n", pool->n_threads);
+        ASSERT_ZERO(pthread_create(
+            &pool->threads[pool->n_threads], NULL, blocking_thread_main, pool));
+        pool->n_threads++;
+    }
+    ASSERT_ZERO(pthread_mutex_unlock(&pool->lock));
+}
+
+/** Waits (with the lock held) until the thread that ran `job` is done waking its future. */
+static void wait_woken(BlockingPool* pool, BlockingFuture* job)
+{
+    while (atomic_load(&job->job_state) == BLOCKING_JOB_WAKING) {
+        pool->n_waiters++;
+        ASSERT_ZERO(pthread_cond_wait(&pool->done_cond, &pool->lock));
+        pool->n_waiters--;
+    }
+}
+
+void blocking_pool_cancel(BlockingPool* pool, BlockingFuture* job)
+{
+    ASSERT_ZERO(pthread_mutex_lock(&pool->lock));
+    if (atomic_load(&job->job_state) == BLOCKING_JOB_QUEUED) {
+        BlockingFuture* prev = NULL;
+        for (BlockingFuture* it = pool->head; it; prev = it, it = it->next_job) {
+            if (it == job) {
+                if (prev) {
+                    prev->next_job = job->next_job;
+                } else {
+                    pool->head = job->next_job;
+                }
+                if (pool->tail == job) {
+                    pool->tail = prev;
+                }
+                break;
+            }
+        }
+        atomic_store(&job->job_state, BLOCKING_JOB_NEW);
+    } else if (atomic_load(&job->job_state) == BLOCKING_JOB_RUNNING) {
+        // Detach it: the function runs to completion, but its thread leaves the future alone.
+        for (BlockingRun* run = pool->running; run; run = run->next) {
+            if (run->job == job) {
+                run->job = NULL;
+                break;
+            }
+        }
+        atomic_store(&job->job_state, BLOCKING_JOB_NEW);
+    }
+    // A job that has just finished may still be waking the task.
+    wait_woken(pool, job);
+    ASSERT_ZERO(pthread_mutex_unlock(&pool->lock));
+}
+
+void blocking_pool_wait_woken(BlockingPool* pool, BlockingFuture* job)
+{
+    ASSERT_ZERO(pthread_mutex_lock(&pool->lock));
+    wait_woken(pool, job);
+    ASSERT_ZERO(pthread_mutex_unlock(&pool->lock));
+}
+
+void blocking_pool_destroy(BlockingPool* pool)
+{
+    ASSERT_ZERO(pthread_mutex_lock(&pool->lock));
+    pool->shutdown = true;
+    ASSERT_ZERO(pthread_cond_broadcast(&pool->work_cond));
+    ASSERT_ZERO(pthread_mutex_unlock(&pool->lock));
+    for (size_t i = 0; i < pool->n_threads; i++) {
+        ASSERT_ZERO(pthread_join(pool->threads[i], NULL));
+    }
+    ASSERT_ZERO(pthread_cond_destroy(&pool->done_cond));
+    ASSERT_ZERO(pthread_cond_destroy(&pool->work_cond));
+    ASSERT_ZERO(pthread_mutex_destroy(&pool->lock));
+    free(pool->threads);
+    free(pool);
+}
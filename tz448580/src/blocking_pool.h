@@ -0,0 +1,48 @@
+#ifndef BLOCKING_POOL_H
+#define BLOCKING_POOL_H
+
+#include <stddef.h>
+
+#include "executor.h"
+
+/**
+ * A bounded pool of threads that run the functions of BlockingFutures.
+ *
+ * Threads are started on demand (when a job is submitted and no thread is idle) up to
+ * `max_threads`, and live until the pool is destroyed.
+ */
+typedef struct BlockingPool BlockingPool;
+
+/** Creates a pool (with no threads yet). Returns NULL on failure. */
+BlockingPool* blocking_pool_create(size_t max_threads);
+
+/**
+ * Changes the bound on the number of threads. Started threads are never retired, so a bound
+ * below the number of started threads is raised to that number (and a bound of 0 to 1).
+ */
+void blocking_pool_set_max_threads(BlockingPool* pool, size_t max_threads);
+
+/** Queues the job of a future (in state BLOCKING_JOB_NEW, with its waker set). */
+void blocking_pool_submit(BlockingPool* pool, BlockingFuture* job);
+
+/**
+ * Dequeues a job that has not started yet, or detaches it if it is running: its function runs
+ * to completion, but the result is dropped and the future is neither touched nor woken.
+ */
+void blocking_pool_cancel(BlockingPool* pool, BlockingFuture* job);
+
+/**
+ * Waits while a job is BLOCKING_JOB_WAKING, i.e. until the pool thread that ran it has returned
+ * from calling its waker (which it does without holding the lock).
+ *
+ * Only then may the future complete and be freed. The wait is as short as a waker_wake().
+ */
+void blocking_pool_wait_woken(BlockingPool* pool, BlockingFuture* job);
+
+/**
+ * Stops the threads (once the queued jobs are done) and frees the pool. Waits for the running
+ * functions, including those of detached (cancelled) jobs.
+ */
+void blocking_pool_destroy(BlockingPool* pool);
+
+#endif // BLOCKING_POOL_H
@@ -1,23 +1,33 @@
 #include "executor.h"
 
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
+#include "blocking_pool.h"
 #include "debug.h"
 #include "future.h"
 #include "mio.h"
+#include "task_slab.h"
 #include "waker.h"
 #include "err.h"
 
 // ============================== FutureQueue =============================
 
+/**
+ * An intrusive FIFO queue of futures, linked through `Future.queue_next`.
+ *
+ * Pushing and popping never allocate, so the queue cannot overflow and an empty queue
+ * takes no memory besides this header.
+ */
 typedef struct FutureQueue {
-    Future** futures;
+    Future* head;
+    Future* tail;
     size_t size;
-    size_t max_queue_size;
-    size_t head;
-    size_t tail;
 } FutureQueue;
 
 void queue_debug_print(FutureQueue* queue, bool pop)
@@ -33,8 +43,8 @@ void queue_debug_print(FutureQueue* queue, bool pop)
         debug("[DEBUG] Pushed to queue.\n");
     }
     debug("[DEBUG] Queue State:\n");
-    debug("  - Size: %zu / %zu\n", queue->size, queue->max_queue_size);
-    debug("  - Head: %zu, Tail: %zu\n", queue->head, queue->tail);
+    debug("  - Size: %zu\n", queue->size);
+    debug("  - Head: %p, Tail: %p\n", queue->head, queue->tail);
 
     debug("  - Elements: ");
     if (queue->size == 0) {
@@ -42,139 +52,429 @@ void queue_debug_print(FutureQueue* queue, bool pop)
         return;
     }
 
-    size_t index = queue->head;
-    for (size_t i = 0; i < queue->size; i++) {
-        debug("[%p] ", (Future*) queue->futures[index]);
-        index = (index + 1) % queue->max_queue_size;
+    // Only dump the front of the queue, so that debug builds stay usable with many tasks.
+    size_t printed = 0;
+    for (Future* fut = queue->head; fut && printed < 8; fut = fut->queue_next, printed++) {
+        debug("[%p] ", fut);
     }
-    debug("\n");
+    debug(printed < queue->size ? "...\n" : "\n");
 }
 
-FutureQueue* queue_create(size_t max_queue_size)
+void queue_init(FutureQueue* queue)
 {
-    FutureQueue* queue = (FutureQueue*) malloc(sizeof(FutureQueue));
-    if (!queue) {
-        return NULL;
+    queue->head = NULL;
+    queue->tail = NULL;
+    queue->size = 0;
+}
+
+void queue_push(FutureQueue* queue, Future* future)
+{
+    future->queue_next = NULL;
+    if (queue->tail) {
+        queue->tail->queue_next = future;
+    } else {
+        queue->head = future;
     }
+    queue->tail = future;
+    queue->size++;
 
-    Future** buffer = (Future**) malloc(max_queue_size * sizeof(Future*));
-    if (!buffer) {
-        free(queue);
+#ifdef DEBUG_PRINTS
+    queue_debug_print(queue, false);
+#endif
+}
+
+Future* queue_pop(FutureQueue* queue)
+{
+    Future* fut = queue->head;
+    if (!fut) {
         return NULL;
     }
 
-    for (size_t i = 0; i < max_queue_size; i++) {
-        buffer[i] = (Future*) NULL;
+    queue->head = fut->queue_next;
+    if (!queue->head) {
+        queue->tail = NULL;
     }
+    queue->size--;
+    fut->queue_next = NULL;
 
-    queue->futures = buffer;
-    queue->head = 0;
-    queue->tail = 0;
-    queue->size = 0;
-    queue->max_queue_size = max_queue_size;
+#ifdef DEBUG_PRINTS
+    queue_debug_print(queue, true);
+#endif
 
-    return queue;
+    return fut;
 }
 
-bool queue_push(FutureQueue* queue, Future* future)
-{
-    if (!queue || !future) {
-        return false;
-    }
+// ============================== LocalQueue ==============================
 
-    if (queue->size == queue->max_queue_size) {
-        return false;
-    }
+// Capacity of a worker's local queue (futures beyond it overflow to the injection queue).
+#define LOCAL_QUEUE_CAPACITY 256
 
-    queue->futures[queue->tail] = future;
-    queue->tail = (queue->tail + 1) % queue->max_queue_size;
-    queue->size++;
+/**
+ * A bounded ring buffer of futures owned by one worker of a multi-threaded executor.
+ *
+ * Only the owner pushes (at the tail), but any worker may pop (from the head): the owner to run
+ * its own futures, the others to steal them. Popping claims a slot by advancing the head with a
+ * CAS, so a slot can only be overwritten by the owner after its future has been claimed.
+ */
+typedef struct LocalQueue {
+    _Atomic(Future*) buffer[LOCAL_QUEUE_CAPACITY];
+    atomic_size_t head; // Index of the next future to pop.
+    atomic_size_t tail; // Index of the next free slot.
+} LocalQueue;
 
-    // DEBUG
-    queue_debug_print(queue, false);
+void local_queue_init(LocalQueue* queue)
+{
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+}
 
+size_t local_queue_size(LocalQueue* queue)
+{
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    size_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    return tail > head ? tail - head : 0;
+}
+
+/** Pushes a future (only called by the owner). Returns false if the queue is full. */
+bool local_queue_push(LocalQueue* queue, Future* fut)
+{
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (tail - head >= LOCAL_QUEUE_CAPACITY) {
+        return false;
+    }
+    atomic_store_explicit(&queue->buffer[tail % LOCAL_QUEUE_CAPACITY], fut, memory_order_relaxed);
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
     return true;
 }
 
-Future* queue_pop(FutureQueue* queue)
+/** Pops the oldest future (called by any worker). Returns NULL if the queue is empty. */
+Future* local_queue_pop(LocalQueue* queue)
 {
-    if (!queue || queue->size == 0) {
-        return NULL;
+    size_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    for (;;) {
+        size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+        if (head >= tail) {
+            return NULL;
+        }
+        Future* fut = atomic_load_explicit(
+            &queue->buffer[head % LOCAL_QUEUE_CAPACITY], memory_order_relaxed);
+        if (atomic_compare_exchange_weak_explicit(&queue->head, &head, head + 1,
+                memory_order_acq_rel, memory_order_acquire)) {
+            return fut;
+        }
     }
+}
 
-    Future* fut = queue->futures[queue->head];
-    queue->head = (queue->head + 1) % queue->max_queue_size;
-    queue->size--;
+// ============================== RemoteQueue =============================
 
-    // DEBUG
-    queue_debug_print(queue, true);
+/**
+ * A lock-free multi-producer single-consumer queue of futures woken from other threads.
+ *
+ * Producers push onto a stack (linked through `Future.queue_next`) with a CAS loop; this takes
+ * no locks, so it also works from signal handlers. The consumer takes the whole stack at once
+ * with an exchange and reverses it, which restores the order of the wakes.
+ */
+typedef struct RemoteQueue {
+    _Atomic(Future*) head; // Most recently pushed future.
+} RemoteQueue;
 
-    return fut;
+void remote_queue_init(RemoteQueue* queue)
+{
+    atomic_init(&queue->head, NULL);
 }
 
-void queue_destroy(FutureQueue* queue)
+bool remote_queue_is_empty(RemoteQueue* queue)
 {
-    if (queue) {
-        free(queue->futures);
-        free(queue);
+    return atomic_load(&queue->head) == NULL;
+}
+
+void remote_queue_push(RemoteQueue* queue, Future* fut)
+{
+    Future* head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    do {
+        fut->queue_next = head;
+    } while (!atomic_compare_exchange_weak_explicit(
+        &queue->head, &head, fut, memory_order_seq_cst, memory_order_relaxed));
+}
+
+/** Takes all pushed futures, returns them as a list (linked through `queue_next`) in FIFO order. */
+Future* remote_queue_take_all(RemoteQueue* queue)
+{
+    if (remote_queue_is_empty(queue)) {
+        return NULL;
+    }
+    Future* stack = atomic_exchange_explicit(&queue->head, NULL, memory_order_acquire);
+    Future* list = NULL;
+    while (stack) {
+        Future* next = stack->queue_next;
+        stack->queue_next = list;
+        list = stack;
+        stack = next;
     }
+    return list;
 }
 
 // =============================== Executor ===============================
 
+typedef struct Worker Worker;
+
 /**
- * @brief Structure to represent the current-thread executor.
+ * @brief Structure to represent the executor.
+ *
+ * A single-threaded executor (created with `executor_create()`) keeps all queued futures in
+ * `queue` and is only ever touched by the thread calling `executor_run()`.
+ *
+ * A multi-threaded executor (created with `executor_create_multi()`) gives each worker its own
+ * LocalQueue, and uses the mutex-protected `inject` queue for local queue overflow. Idle workers
+ * steal from each other; when there is nothing to steal, one of them (the "driver") blocks in
+ * mio_poll() and the others wait on `idle_cond`.
+ *
+ * Futures spawned or woken from any other thread go to the lock-free `remote` queue, and if the
+ * executor is parked in mio_poll(), Mio's wakeup eventfd is signalled to unpark it.
  */
 struct Executor {
-    FutureQueue* queue;
+    FutureQueue queue; // Run queue of the single-threaded executor.
+    RemoteQueue remote; // Futures woken from outside of the executor's threads.
     Mio* mio;
-    int active; // Counter of futures with is_active set to true.
+    atomic_int active; // Counter of futures with is_active set to true.
+    size_t max_active; // Admission limit for `active` (0 means unlimited).
+    atomic_size_t n_parked; // Workers that are idle or blocked in mio_poll() (readable without lock).
+
+    size_t n_workers; // 1 for the single-threaded executor.
+    Worker* workers; // NULL for the single-threaded executor.
+    pthread_mutex_t lock; // Protects the fields below.
+    FutureQueue inject; // Futures not (yet) owned by any worker.
+    pthread_cond_t idle_cond; // Signalled when idle workers should look for futures again.
+    size_t n_idle; // Number of workers waiting on `idle_cond`.
+    bool driver_busy; // Whether some worker is (about to be) blocked in mio_poll().
+
+    BlockingPool* blocking; // Threads running the functions of BlockingFutures.
+    TaskSlab* slab; // Slots of the futures spawned with executor_spawn_owned().
+
+    bool lifo_enabled; // Whether futures woken by a running future go to a LIFO slot.
+    Future* lifo; // LIFO slot of the single-threaded executor (see lifo_next()).
+    unsigned lifo_polls; // Futures run in a row from the LIFO slot.
+
+    uint64_t spin_ns; // How long to busy-poll before blocking in mio_poll() (see executor_set_spin()).
 };
 
-Executor* executor_create(size_t max_queue_size)
+struct Worker {
+    Executor* executor;
+    pthread_t thread;
+    LocalQueue local;
+    unsigned steal_seed; // State of the generator picking the first victim to steal from.
+    unsigned ticks; // Number of futures progressed (see worker_tick()).
+    Future* lifo; // LIFO slot of the worker (see lifo_next()); never stolen.
+    unsigned lifo_polls;
+};
+
+// The executor run by the current thread (NULL outside of executor_run()).
+static _Thread_local Executor* current_executor = NULL;
+
+// The worker run by the current thread (NULL outside of a multi-threaded executor_run()).
+static _Thread_local Worker* current_worker = NULL;
+
+// The future whose progress() is being called by the current thread (NULL if none).
+static _Thread_local Future* current_future = NULL;
+
+/**
+ * Takes the future from a LIFO slot, unless it has already been used EXECUTOR_MAX_LIFO_POLLS
+ * times in a row: then the future is returned through `*requeue` to go to the back of the
+ * queue, so that two futures waking each other cannot starve the rest of it.
+ */
+static Future* lifo_next(Future** slot, unsigned* polls, Future** requeue)
+{
+    Future* fut = *slot;
+    *slot = NULL;
+    *requeue = NULL;
+    if (fut && *polls < EXECUTOR_MAX_LIFO_POLLS) {
+        (*polls)++;
+        return fut;
+    }
+    *requeue = fut;
+    *polls = 0;
+    return NULL;
+}
+
+static Executor* executor_alloc(size_t n_workers, size_t max_queue_size)
 {
     Executor* executor = (Executor*) malloc(sizeof(Executor));
     if (!executor) {
         fatal("executor create (malloc)");
     }
 
-    executor->queue = queue_create(max_queue_size);
-    if (!executor->queue) {
-        free(executor);
-        fatal("queue_create (malloc)");
-    }
+    queue_init(&executor->queue);
+    remote_queue_init(&executor->remote);
+    executor->max_active = max_queue_size;
+    atomic_init(&executor->active, 0);
 
-    executor->mio = mio_create(executor);
+    executor->n_workers = n_workers;
+    executor->workers = NULL;
+    ASSERT_ZERO(pthread_mutex_init(&executor->lock, NULL));
+    ASSERT_ZERO(pthread_cond_init(&executor->idle_cond, NULL));
+    queue_init(&executor->inject);
+    executor->n_idle = 0;
+    executor->driver_busy = false;
+    atomic_init(&executor->n_parked, 0);
+
+    executor->mio = mio_create(executor, MIO_BACKEND_EPOLL);
     if (!executor->mio) {
-        queue_destroy(executor->queue);
         free(executor);
         fatal("mio_create (malloc)");
     }
 
-    executor->active = 0;
+    executor->lifo_enabled = true;
+    executor->lifo = NULL;
+    executor->lifo_polls = 0;
+
+    executor->spin_ns = 0;
+
+    executor->slab = task_slab_create();
+    if (!executor->slab) {
+        fatal("task_slab_create (malloc)");
+    }
+
+    executor->blocking = blocking_pool_create(EXECUTOR_MAX_BLOCKING_THREADS);
+    if (!executor->blocking) {
+        fatal("blocking_pool_create (malloc)");
+    }
+
+    return executor;
+}
+
+Executor* executor_create(size_t max_queue_size)
+{
+    return executor_alloc(1, max_queue_size);
+}
+
+Executor* executor_create_multi(size_t n_threads, size_t max_queue_size)
+{
+    if (n_threads == 0) {
+        fatal("executor_create_multi: no threads");
+    }
+
+    Executor* executor = executor_alloc(n_threads, max_queue_size);
+    if (n_threads == 1) {
+        return executor;
+    }
+
+    executor->workers = (Worker*) malloc(n_threads * sizeof(Worker));
+    if (!executor->workers) {
+        executor_destroy(executor);
+        fatal("executor create (malloc)");
+    }
+    for (size_t i = 0; i < n_threads; i++) {
+        executor->workers[i].executor = executor;
+        executor->workers[i].steal_seed = (unsigned) i * 2654435761u + 1;
+        executor->workers[i].ticks = 0;
+        executor->workers[i].lifo = NULL;
+        executor->workers[i].lifo_polls = 0;
+        local_queue_init(&executor->workers[i].local);
+    }
     return executor;
 }
 
+/** Wakes up one parked worker of a multi-threaded executor, if there is any. */
+static void executor_notify_one(Executor* executor)
+{
+    ASSERT_ZERO(pthread_mutex_lock(&executor->lock));
+    if (executor->n_idle > 0) {
+        ASSERT_ZERO(pthread_cond_signal(&executor->idle_cond));
+    } else if (executor->driver_busy) {
+        mio_wakeup(executor->mio);
+    }
+    ASSERT_ZERO(pthread_mutex_unlock(&executor->lock));
+}
+
+/** Queues a future whose state has just been set to FUTURE_SCHED_SCHEDULED. */
+static void executor_schedule(Executor* executor, Future* fut)
+{
+    if (!executor->workers) {
+        if (current_executor == executor) {
+            if (current_future && executor->lifo_enabled) {
+                // Woken by the running future (e.g., a consumer by its producer): run it next,
+                // while what it is about to read is still hot in the cache.
+                Future* displaced = executor->lifo;
+                executor->lifo = fut;
+                if (!displaced) {
+                    return;
+                }
+                fut = displaced;
+            }
+            queue_push(&executor->queue, fut);
+            return;
+        }
+    } else if (current_worker && current_worker->executor == executor) {
+        if (current_future && executor->lifo_enabled) {
+            Future* displaced = current_worker->lifo;
+            current_worker->lifo = fut;
+            if (!displaced) {
+                return;
+            }
+            fut = displaced;
+        }
+        if (local_queue_push(&current_worker->local, fut)) {
+            // The current worker will get to the future itself, but an idle one could steal it.
+            if (atomic_load_explicit(&executor->n_parked, memory_order_relaxed) > 0) {
+                executor_notify_one(executor);
+            }
+            return;
+        }
+        ASSERT_ZERO(pthread_mutex_lock(&executor->lock));
+        queue_push(&executor->inject, fut);
+        if (executor->n_idle > 0) {
+            ASSERT_ZERO(pthread_cond_signal(&executor->idle_cond));
+        } else if (executor->driver_busy) {
+            mio_wakeup(executor->mio);
+        }
+        ASSERT_ZERO(pthread_mutex_unlock(&executor->lock));
+        return;
+    }
+
+    // Woken from another thread (or before executor_run()). The parking thread sets n_parked
+    // before its last look at the remote queue, so either it sees the future or we see n_parked.
+    remote_queue_push(&executor->remote, fut);
+    if (atomic_load(&executor->n_parked) > 0) {
+        mio_wakeup(executor->mio);
+    }
+}
+
 void waker_wake(Waker* waker)
 {
     Executor* executor = (Executor*) waker->executor;
     Future* fut = waker->future;
-    // Put the future back into the executor's queue (if it's not already there).
-    FutureQueue* queue = executor->queue;
-    size_t k = queue->head;
-    for (size_t i = 0; i < queue->size; i++) {
-        debug("[WAKER] In the queue: %p\n", queue->futures[k]);
-        if (queue->futures[k] == fut) {
-            debug("[WAKER] Not requeuing the future, it's already in the queue\n");
-            return;
+    wake_link_set(waker->flag);
+    int state = atomic_load_explicit(&fut->sched_state, memory_order_acquire);
+    for (;;) {
+        switch (state) {
+            case FUTURE_SCHED_INACTIVE:
+                // A completed future must not be progressed again, even if an event still points at it.
+                debug("[WAKER] Not requeuing the future, it has already completed\n");
+                return;
+            case FUTURE_SCHED_SCHEDULED:
+            case FUTURE_SCHED_NOTIFIED:
+                debug("[WAKER] Not requeuing the future, it's already in the queue\n");
+                return;
+            case FUTURE_SCHED_IDLE:
+                if (atomic_compare_exchange_weak(&fut->sched_state, &state, FUTURE_SCHED_SCHEDULED)) {
+                    debug("[WAKER] Requeuing the future\n");
+                    executor_schedule(executor, fut);
+                    return;
+                }
+                break;
+            case FUTURE_SCHED_RUNNING:
+                // Whoever is progressing the future will requeue it afterwards.
+                if (atomic_compare_exchange_weak(&fut->sched_state, &state, FUTURE_SCHED_NOTIFIED)) {
+                    debug("[WAKER] Future is running, it will be requeued\n");
+                    return;
+                }
+                break;
         }
-        k = (k + 1) % queue->max_queue_size;
     }
-    debug("[WAKER] Requeuing the future\n");
-    executor_spawn(executor, fut);
 }
 
-void executor_spawn(Executor* executor, Future* fut)
+bool executor_spawn(Executor* executor, Future* fut)
 {
     if (!executor) {
         fatal("executor_spawn");
@@ -182,19 +482,421 @@ void executor_spawn(Executor* executor, Future* fut)
 
     if (!fut) {
         debug("fut is NULL\n");
-        return;
+        return false;
     }
-    
+
     debug("[Executor] Spawned future\n");
-    if (!(fut->is_active)) {
-        fut->is_active = true;
-        executor->active++;
+    if (fut->is_active) {
+        // Already spawned: spawning it again is just a wake.
+        Waker waker = { .executor = executor, .future = fut };
+        waker_wake(&waker);
+        return true;
+    }
+
+    // Admit it by taking a place below the limit, so that concurrent spawns cannot overshoot.
+    int active = atomic_load(&executor->active);
+    do {
+        if (executor->max_active > 0 && (size_t) active >= executor->max_active) {
+            debug("[Executor] Spawn rejected, %d tasks are already active\n", active);
+            return false;
+        }
+    } while (!atomic_compare_exchange_weak(&executor->active, &active, active + 1));
+    fut->is_active = true;
+    atomic_store(&fut->cancel_requested, false);
+    atomic_store(&fut->sched_state, FUTURE_SCHED_SCHEDULED);
+    executor_schedule(executor, fut);
+    return true;
+}
+
+static FutureState join_handle_progress(Future* base, Mio* mio, Waker waker);
+static void join_handle_cancel(Future* base, Mio* mio);
+
+/** Prepares a handle for the result of a future about to be spawned. */
+static void join_handle_init(JoinHandle* handle, Future* fut)
+{
+    handle->base = future_create(join_handle_progress);
+    handle->base.cancel = join_handle_cancel;
+    atomic_init(&handle->join_state, JOIN_PENDING);
+    handle->waker = (Waker) { .executor = NULL, .future = NULL };
+    handle->result = FUTURE_PENDING;
+    fut->join_handle = handle;
+}
+
+bool executor_spawn_joinable(Executor* executor, Future* fut, JoinHandle* handle)
+{
+    if (!fut || !handle || fut->is_active) {
+        fatal("executor_spawn_joinable");
+    }
+    join_handle_init(handle, fut);
+    if (!executor_spawn(executor, fut)) {
+        fut->join_handle = NULL;
+        return false;
+    }
+    return true;
+}
+
+Future* executor_spawn_owned(
+    Executor* executor, Future const* fut, size_t size, JoinHandle* handle)
+{
+    if (!executor || !fut || size < sizeof(Future)) {
+        fatal("executor_spawn_owned");
+    }
+    if (fut->is_active) {
+        fatal("executor_spawn_owned: the future is already spawned");
     }
 
-    bool ret = queue_push(executor->queue, fut);
-    if (!ret) {
-        debug("Spawn failed\n");
+    Future* owned = (Future*) task_slab_alloc(executor->slab, size);
+    if (!owned) {
+        fatal("executor_spawn_owned (malloc)");
+    }
+    memcpy(owned, fut, size);
+    owned->is_owned = true;
+    owned->join_handle = NULL;
+    if (handle) {
+        join_handle_init(handle, owned);
+    }
+    if (!executor_spawn(executor, owned)) {
+        task_slab_free(executor->slab, owned);
+        return NULL;
+    }
+    return owned;
+}
+
+/** Hands the result of a completed future over to its JoinHandle (and wakes whoever awaits it). */
+static void join_handle_complete(JoinHandle* handle, Future* fut, FutureState state)
+{
+    int old = atomic_load(&handle->join_state);
+    do {
+        if (old == JOIN_DETACHED) {
+            return;
+        }
+    } while (!atomic_compare_exchange_weak(&handle->join_state, &old, JOIN_COMPLETING));
+
+    handle->base.ok = fut->ok;
+    handle->base.errcode = fut->errcode;
+    handle->result = state;
+    if (old == JOIN_WAITING) {
+        // The handle cannot complete (nor be freed) before it sees JOIN_DONE.
+        Waker waker = handle->waker;
+        waker_wake(&waker);
+    }
+    atomic_store(&handle->join_state, JOIN_DONE);
+}
+
+void executor_cancel(Executor* executor, Future* fut)
+{
+    if (!executor || !fut) {
+        fatal("executor_cancel");
     }
+    // The wake makes whichever thread progresses the future next see the request.
+    atomic_store_explicit(&fut->cancel_requested, true, memory_order_release);
+    Waker waker = { .executor = executor, .future = fut };
+    waker_wake(&waker);
+}
+
+/** Calls progress() on a dequeued future (or cancels it) and handles its outcome. */
+static void executor_progress(Executor* executor, Future* fut)
+{
+    atomic_store_explicit(&fut->sched_state, FUTURE_SCHED_RUNNING, memory_order_relaxed);
+
+    FutureState state;
+    if (atomic_load_explicit(&fut->cancel_requested, memory_order_acquire)) {
+        debug("[Executor] Cancelling future %p\n", fut);
+        future_cancel(fut, executor->mio);
+        fut->errcode = FUTURE_ERR_CANCELLED;
+        state = FUTURE_FAILURE;
+    } else {
+        Waker waker = { .executor = executor, .future = fut };
+        future_budget = FUTURE_TASK_BUDGET;
+        current_future = fut;
+        state = fut->progress(fut, executor->mio, waker);
+        current_future = NULL;
+    }
+    switch (state) {
+        case FUTURE_COMPLETED:
+        case FUTURE_FAILURE:
+            fut->is_active = false;
+            atomic_store(&fut->sched_state, FUTURE_SCHED_INACTIVE);
+            if (fut->join_handle) {
+                join_handle_complete(fut->join_handle, fut, state);
+                fut->join_handle = NULL;
+            }
+            if (fut->is_owned) {
+                // Freed before `active` drops, so that the slab outlives it (see executor_run()).
+                task_slab_free(executor->slab, fut);
+            }
+            if (atomic_fetch_sub(&executor->active, 1) == 1 && executor->workers) {
+                // That was the last future: let all the other workers return.
+                ASSERT_ZERO(pthread_mutex_lock(&executor->lock));
+                ASSERT_ZERO(pthread_cond_broadcast(&executor->idle_cond));
+                if (executor->driver_busy) {
+                    mio_wakeup(executor->mio);
+                }
+                ASSERT_ZERO(pthread_mutex_unlock(&executor->lock));
+            }
+            break;
+        case FUTURE_PENDING: {
+            int expected = FUTURE_SCHED_RUNNING;
+            if (!atomic_compare_exchange_strong(&fut->sched_state, &expected, FUTURE_SCHED_IDLE)) {
+                // Woken while running (state is NOTIFIED): requeue.
+                atomic_store(&fut->sched_state, FUTURE_SCHED_SCHEDULED);
+                executor_schedule(executor, fut);
+            }
+            break;
+        }
+    }
+}
+
+/** Moves up to half of the futures queued by another worker to `worker`, returns one of them. */
+static Future* worker_steal(Worker* worker)
+{
+    Executor* executor = worker->executor;
+    size_t start = rand_r(&worker->steal_seed) % executor->n_workers;
+    for (size_t i = 0; i < executor->n_workers; i++) {
+        Worker* victim = &executor->workers[(start + i) % executor->n_workers];
+        if (victim == worker) {
+            continue;
+        }
+        size_t to_steal = (local_queue_size(&victim->local) + 1) / 2;
+        Future* first = NULL;
+        for (size_t k = 0; k < to_steal; k++) {
+            Future* fut = local_queue_pop(&victim->local);
+            if (!fut) {
+                break;
+            }
+            if (!first) {
+                first = fut;
+            } else if (!local_queue_push(&worker->local, fut)) {
+                executor_schedule(executor, fut);
+            }
+        }
+        if (first) {
+            debug("[Executor] Worker %p stole from worker %p\n", worker, victim);
+            return first;
+        }
+    }
+    return NULL;
+}
+
+/** Moves the futures woken from other threads to the worker's queue; returns whether there were any. */
+static bool worker_take_remote(Worker* worker)
+{
+    Executor* executor = worker->executor;
+    Future* fut = remote_queue_take_all(&executor->remote);
+    if (!fut) {
+        return false;
+    }
+    bool const many = fut->queue_next != NULL;
+    bool overflow = false;
+    while (fut) {
+        Future* next = fut->queue_next;
+        if (!local_queue_push(&worker->local, fut)) {
+            if (!overflow) {
+                ASSERT_ZERO(pthread_mutex_lock(&executor->lock));
+                overflow = true;
+            }
+            queue_push(&executor->inject, fut);
+        }
+        fut = next;
+    }
+    if (many) {
+        if (!overflow) {
+            ASSERT_ZERO(pthread_mutex_lock(&executor->lock));
+        }
+        if (executor->n_idle > 0) {
+            ASSERT_ZERO(pthread_cond_signal(&executor->idle_cond));
+        }
+        ASSERT_ZERO(pthread_mutex_unlock(&executor->lock));
+    } else if (overflow) {
+        ASSERT_ZERO(pthread_mutex_unlock(&executor->lock));
+    }
+    return true;
+}
+
+/** Finds the next future for a worker: from its own queue, the injection queue, or a steal. */
+static Future* worker_next(Worker* worker)
+{
+    Executor* executor = worker->executor;
+    Future* requeue;
+    Future* fut = lifo_next(&worker->lifo, &worker->lifo_polls, &requeue);
+    if (requeue) {
+        executor_schedule(executor, requeue);
+    }
+    if (fut) {
+        return fut;
+    }
+    fut = local_queue_pop(&worker->local);
+    if (fut) {
+        return fut;
+    }
+
+    if (worker_take_remote(worker)) {
+        fut = local_queue_pop(&worker->local);
+        if (fut) {
+            return fut;
+        }
+    }
+
+    ASSERT_ZERO(pthread_mutex_lock(&executor->lock));
+    fut = queue_pop(&executor->inject);
+    // Take a fair share of the rest, so that the lock is not taken for every future.
+    size_t batch = executor->inject.size / executor->n_workers;
+    for (size_t i = 0; fut && i < batch && i < LOCAL_QUEUE_CAPACITY / 2; i++) {
+        local_queue_push(&worker->local, queue_pop(&executor->inject));
+    }
+    ASSERT_ZERO(pthread_mutex_unlock(&executor->lock));
+    if (fut) {
+        return fut;
+    }
+
+    return worker_steal(worker);
+}
+
+static uint64_t executor_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * Busy-polls Mio (without blocking) for up to `spin_ns`, until `has_work(arg)` says that there
+ * are futures to run. Returns whether there are, i.e. whether parking can be skipped.
+ */
+static bool executor_spin(Executor* executor, bool (*has_work)(void*), void* arg)
+{
+    uint64_t const deadline = executor_now_ns() + executor->spin_ns;
+    do {
+        mio_poll_nowait(executor->mio);
+        if (has_work(arg) || atomic_load(&executor->active) == 0) {
+            return true;
+        }
+    } while (executor_now_ns() < deadline);
+    return false;
+}
+
+/** Whether a spinning worker has found futures to run (see executor_spin()). */
+static bool worker_has_work(void* arg)
+{
+    Worker* worker = arg;
+    Executor* executor = worker->executor;
+    if (worker->lifo || local_queue_size(&worker->local) > 0
+        || !remote_queue_is_empty(&executor->remote)) {
+        return true;
+    }
+    ASSERT_ZERO(pthread_mutex_lock(&executor->lock));
+    bool const injected = executor->inject.size > 0;
+    ASSERT_ZERO(pthread_mutex_unlock(&executor->lock));
+    return injected;
+}
+
+/** Blocks an idle worker until there may be new futures to run (or all futures completed). */
+static void worker_park(Worker* worker)
+{
+    Executor* executor = worker->executor;
+
+    ASSERT_ZERO(pthread_mutex_lock(&executor->lock));
+    if (executor->inject.size > 0 || atomic_load(&executor->active) == 0) {
+        ASSERT_ZERO(pthread_mutex_unlock(&executor->lock));
+        return;
+    }
+    atomic_fetch_add(&executor->n_parked, 1);
+    if (!remote_queue_is_empty(&executor->remote)) {
+        // Woken from another thread before we managed to park.
+        atomic_fetch_sub(&executor->n_parked, 1);
+        ASSERT_ZERO(pthread_mutex_unlock(&executor->lock));
+        return;
+    }
+    if (!executor->driver_busy) {
+        // Nobody waits for I/O events: do it ourselves (wakes will land in our local queue).
+        executor->driver_busy = true;
+        ASSERT_ZERO(pthread_mutex_unlock(&executor->lock));
+        if (executor->spin_ns == 0 || !executor_spin(executor, worker_has_work, worker)) {
+            mio_poll(executor->mio);
+        }
+        ASSERT_ZERO(pthread_mutex_lock(&executor->lock));
+        executor->driver_busy = false;
+        if (executor->n_idle > 0) {
+            // Let someone else take over waiting for events while we run what we got.
+            ASSERT_ZERO(pthread_cond_signal(&executor->idle_cond));
+        }
+    } else {
+        executor->n_idle++;
+        ASSERT_ZERO(pthread_cond_wait(&executor->idle_cond, &executor->lock));
+        executor->n_idle--;
+    }
+    atomic_fetch_sub(&executor->n_parked, 1);
+    ASSERT_ZERO(pthread_mutex_unlock(&executor->lock));
+}
+
+/**
+ * Called every EXECUTOR_TICK_BUDGET progressed futures, so that a worker kept busy by its own
+ * queue still picks up remote wakes and (unless another worker waits for events) ready I/O.
+ */
+static void worker_tick(Worker* worker)
+{
+    Executor* executor = worker->executor;
+
+    worker_take_remote(worker);
+
+    ASSERT_ZERO(pthread_mutex_lock(&executor->lock));
+    bool const poll = !executor->driver_busy;
+    executor->driver_busy = true;
+    ASSERT_ZERO(pthread_mutex_unlock(&executor->lock));
+    if (!poll) {
+        return;
+    }
+    mio_poll_nowait(executor->mio);
+    ASSERT_ZERO(pthread_mutex_lock(&executor->lock));
+    executor->driver_busy = false;
+    if (executor->n_idle > 0) {
+        // Someone may have given up on driving while we were polling.
+        ASSERT_ZERO(pthread_cond_signal(&executor->idle_cond));
+    }
+    ASSERT_ZERO(pthread_mutex_unlock(&executor->lock));
+}
+
+static void* worker_main(void* arg)
+{
+    Worker* worker = arg;
+    Executor* executor = worker->executor;
+    Executor* previous_executor = current_executor;
+    current_executor = executor;
+    current_worker = worker;
+
+    while (atomic_load(&executor->active) > 0) {
+        Future* fut = worker_next(worker);
+        if (fut) {
+            executor_progress(executor, fut);
+            if (++worker->ticks % EXECUTOR_TICK_BUDGET == 0) {
+                worker_tick(worker);
+            }
+        } else {
+            worker_park(worker);
+        }
+    }
+
+    current_worker = NULL;
+    current_executor = previous_executor;
+    return NULL;
+}
+
+/** Whether the spinning single-threaded executor has found futures to run (see executor_spin()). */
+static bool executor_has_work(void* arg)
+{
+    Executor* executor = arg;
+    return executor->queue.size > 0 || executor->lifo || !remote_queue_is_empty(&executor->remote);
+}
+
+/** Finds the next future for the single-threaded executor: from the LIFO slot or the queue. */
+static Future* executor_next(Executor* executor)
+{
+    Future* requeue;
+    Future* fut = lifo_next(&executor->lifo, &executor->lifo_polls, &requeue);
+    if (requeue) {
+        queue_push(&executor->queue, requeue);
+    }
+    return fut ? fut : queue_pop(&executor->queue);
 }
 
 void executor_run(Executor* executor)
@@ -203,43 +905,189 @@ void executor_run(Executor* executor)
         fatal("executor_run: executor is NULL\n");
     }
 
-    debug("[Executor] Starting with %d tasks\n", executor->active);
+    debug("[Executor] Starting with %d tasks\n", atomic_load(&executor->active));
+
+    if (executor->workers) {
+        // The calling thread is worker 0.
+        for (size_t i = 1; i < executor->n_workers; i++) {
+            ASSERT_ZERO(pthread_create(
+                &executor->workers[i].thread, NULL, worker_main, &executor->workers[i]));
+        }
+        worker_main(&executor->workers[0]);
+        for (size_t i = 1; i < executor->n_workers; i++) {
+            ASSERT_ZERO(pthread_join(executor->workers[i].thread, NULL));
+        }
+        return;
+    }
+
+    Executor* previous_executor = current_executor;
+    current_executor = executor;
 
     // Main loop, stopping if there are no tasks in general.
-    while (executor->active > 0) {
-        debug("[Executor] Main loop: found %d tasks, processing...\n", executor->active);
-        // Inner loop, stopping if there are no tasks in the queue.
-        while (executor->queue->size > 0) {
-            debug("[Executor] Inner loop: found %zu tasks in the queue\n", executor->queue->size);
-            debug("[Executor] All active tasks: %d\n", executor->active);
-            Future* fut = queue_pop(executor->queue);
-            // fut is not null here.
-            Waker waker = { .executor = executor, .future = fut };
-            FutureState state = fut->progress(fut, executor->mio, waker);
-            switch (state) {
-                case FUTURE_COMPLETED:
-                    fut->is_active = false;
-                    executor->active--;
-                    break;
-                case FUTURE_FAILURE:
-                    fut->is_active = false;
-                    executor->active--;
-                    break;
-                case FUTURE_PENDING:
-                    break;
+    while (atomic_load(&executor->active) > 0) {
+        debug("[Executor] Main loop: found %d tasks, processing...\n", atomic_load(&executor->active));
+        // Move futures woken from other threads to the queue.
+        for (Future* fut = remote_queue_take_all(&executor->remote); fut;) {
+            Future* next = fut->queue_next;
+            queue_push(&executor->queue, fut);
+            fut = next;
+        }
+        // Inner loop, stopping if there are no tasks in the queue (or the tick budget ran out).
+        Future* fut;
+        size_t polls = 0;
+        while (polls < EXECUTOR_TICK_BUDGET && (fut = executor_next(executor)) != NULL) {
+            debug("[Executor] Inner loop: found %zu tasks in the queue\n", executor->queue.size + 1);
+            debug("[Executor] All active tasks: %d\n", atomic_load(&executor->active));
+            executor_progress(executor, fut);
+            polls++;
+        }
+        if (executor->queue.size > 0 || executor->lifo) {
+            // Futures keep waking each other: check for I/O and timers without blocking,
+            // so that they do not starve the futures waiting for them.
+            mio_poll_nowait(executor->mio);
+        } else if (executor->spin_ns > 0 && executor_spin(executor, executor_has_work, executor)) {
+            // Found something to run while spinning, without the cost of parking and unparking
+            // (futures woken from other threads meanwhile did not even signal the eventfd).
+        } else if (atomic_load(&executor->active) > 0) {
+            // After processing everything from the queue, call mio_poll().
+            // (Unless a future was woken from another thread meanwhile, see executor_schedule().)
+            atomic_store(&executor->n_parked, 1);
+            if (remote_queue_is_empty(&executor->remote)) {
+                mio_poll(executor->mio);
             }
+            atomic_store(&executor->n_parked, 0);
         }
-        // After processing everything from the queue, call mio_poll().
-        if (executor->active > 0) {
-            mio_poll(executor->mio);
+    }
+
+    current_executor = previous_executor;
+}
+
+Mio* executor_mio(Executor* executor)
+{
+    return executor->mio;
+}
+
+MioBackend executor_set_mio_backend(Executor* executor, MioBackend backend)
+{
+    if (mio_backend(executor->mio) != backend) {
+        Mio* mio = mio_create(executor, backend);
+        if (!mio) {
+            fatal("mio_create (malloc)");
         }
+        mio_destroy(executor->mio);
+        executor->mio = mio;
     }
-    
+    return mio_backend(executor->mio);
 }
 
 void executor_destroy(Executor* executor)
 {
-    queue_destroy(executor->queue);
+    blocking_pool_destroy(executor->blocking);
+    task_slab_destroy(executor->slab);
     mio_destroy(executor->mio);
+    free(executor->workers);
+    ASSERT_ZERO(pthread_cond_destroy(&executor->idle_cond));
+    ASSERT_ZERO(pthread_mutex_destroy(&executor->lock));
     free(executor);
 }
+
+// ============================== JoinHandle ==============================
+
+static FutureState join_handle_progress(Future* base, Mio* mio, Waker waker)
+{
+    JoinHandle* self = (JoinHandle*) base;
+
+    int state = atomic_load(&self->join_state);
+    if (state == JOIN_PENDING) {
+        self->waker = waker;
+        if (atomic_compare_exchange_strong(&self->join_state, &state, JOIN_WAITING)) {
+            return FUTURE_PENDING;
+        }
+    }
+    switch (state) {
+    case JOIN_DONE:
+        return self->result;
+    case JOIN_COMPLETING:
+        // The result is being handed over right now: look again in a moment.
+        waker_wake(&waker);
+        return FUTURE_PENDING;
+    default:
+        return FUTURE_PENDING; // Woken again once the task completes.
+    }
+}
+
+static void join_handle_cancel(Future* base, Mio* mio)
+{
+    JoinHandle* self = (JoinHandle*) base;
+
+    int state = atomic_load(&self->join_state);
+    while (state != JOIN_DONE) {
+        if (state == JOIN_COMPLETING) {
+            state = atomic_load(&self->join_state); // Only a few instructions to wait for.
+        } else if (atomic_compare_exchange_weak(&self->join_state, &state, JOIN_DETACHED)) {
+            return;
+        }
+    }
+}
+
+// ============================ BlockingFuture ============================
+
+static FutureState blocking_future_progress(Future* base, Mio* mio, Waker waker)
+{
+    BlockingFuture* self = (BlockingFuture*) base;
+
+    switch (atomic_load(&self->job_state)) {
+    case BLOCKING_JOB_NEW:
+        debug("[BlockingFuture] Submitting job of future %p\n", self);
+        self->waker = waker;
+        blocking_pool_submit(((Executor*) waker.executor)->blocking, self);
+        return FUTURE_PENDING;
+    case BLOCKING_JOB_WAKING:
+        // The pool thread is still calling our waker: let it finish before we complete
+        // (and the task, e.g., gets freed).
+        blocking_pool_wait_woken(((Executor*) waker.executor)->blocking, self);
+        return FUTURE_COMPLETED;
+    case BLOCKING_JOB_DONE:
+        return FUTURE_COMPLETED;
+    default:
+        return FUTURE_PENDING; // Woken again once the function returns.
+    }
+}
+
+static void blocking_future_cancel(Future* base, Mio* mio)
+{
+    BlockingFuture* self = (BlockingFuture*) base;
+
+    if (atomic_load(&self->job_state) != BLOCKING_JOB_NEW) {
+        blocking_pool_cancel(((Executor*) self->waker.executor)->blocking, self);
+    }
+}
+
+BlockingFuture executor_spawn_blocking(void* (*func)(void*), void* arg)
+{
+    BlockingFuture self = {
+        .base = future_create(blocking_future_progress),
+        .func = func,
+        .next_job = NULL,
+        .waker = { .executor = NULL, .future = NULL },
+        .job_state = BLOCKING_JOB_NEW,
+    };
+    self.base.cancel = blocking_future_cancel;
+    self.base.arg = arg;
+    return self;
+}
+
+void executor_set_max_blocking_threads(Executor* executor, size_t n_threads)
+{
+    blocking_pool_set_max_threads(executor->blocking, n_threads);
+}
+
+void executor_set_lifo_slot(Executor* executor, bool enabled)
+{
+    executor->lifo_enabled = enabled;
+}
+
+void executor_set_spin(Executor* executor, unsigned spin_us)
+{
+    executor->spin_ns = (uint64_t)spin_us * 1000;
+}
@@ -0,0 +1,3 @@
+#include "future.h"
+
+_Thread_local unsigned future_budget = FUTURE_TASK_BUDGET;
@@ -1,7 +1,10 @@
 #include "future_combinators.h"
 #include <stdlib.h>
 
+#include "err.h"
 #include "future.h"
+#include "mio.h"
+#include "timer_wheel.h"
 #include "waker.h"
 
 /** Progress function for ThenFuture */
@@ -42,25 +45,60 @@ static FutureState then_future_progress(Future* base, Mio* mio, Waker waker) {
     }
 }
 
+/** Cancel function for ThenFuture */
+static void then_future_cancel(Future* base, Mio* mio) {
+    ThenFuture* self = (ThenFuture*)base;
+    future_cancel(self->fut1_completed ? self->fut2 : self->fut1, mio);
+}
+
 ThenFuture future_then(Future* fut1, Future* fut2)
 {
+    Future base = future_create(then_future_progress);
+    base.cancel = then_future_cancel;
     return (ThenFuture) {
-        .base = future_create(then_future_progress),
+        .base = base,
         .fut1 = fut1,
         .fut2 = fut2,
         .fut1_completed = false,
     };
 }
 
+/** Allocates the cell of a JoinFuture or SelectFuture, with both futures marked as woken. */
+static WakeCell* pair_cell_create(void)
+{
+    WakeCell* cell;
+    if (!wake_cells_alloc(&cell, 1)) {
+        fatal("Out of memory for wake cells");
+    }
+    atomic_store_explicit(&cell->bits, 3, memory_order_relaxed);
+    return cell;
+}
+
+/** Releases the cell of a JoinFuture or SelectFuture (if any). */
+static void pair_cell_release(WakeCell** cell)
+{
+    if (*cell) {
+        wake_cells_release(cell, 1);
+        *cell = NULL;
+    }
+}
+
 /** Progress function for JoinFuture */
 static FutureState join_future_progress(Future* base, Mio* mio, Waker waker) {
     JoinFuture* self = (JoinFuture*)base;
     debug("JoinFuture %p progress. fut1_completed=%d, fut2_completed=%d\n",
           self, self->fut1_completed, self->fut2_completed);
-    
-    if (self->fut1_completed == FUTURE_PENDING) {
+
+    if (!self->ready) {
+        self->ready = pair_cell_create();
+    }
+    // Only progress the futures that have been woken since the last time.
+    uint64_t const ready = atomic_exchange_explicit(&self->ready->bits, 0, memory_order_acquire);
+
+    if (self->fut1_completed == FUTURE_PENDING && (ready & 1)) {
         // Progress the first future.
-        self->fut1_completed = self->fut1->progress(self->fut1, mio, waker);
+        Waker fut1_waker = waker_for_child(waker, self->ready, 0);
+        self->fut1_completed = self->fut1->progress(self->fut1, mio, fut1_waker);
         if (self->fut1_completed == FUTURE_FAILURE) {
             if (self->base.errcode == 0) {
                 self->base.errcode = JOIN_FUTURE_ERR_FUT1_FAILED;
@@ -72,9 +110,10 @@ static FutureState join_future_progress(Future* base, Mio* mio, Waker waker) {
         }
     }
 
-    if (self->fut2_completed == FUTURE_PENDING) {
+    if (self->fut2_completed == FUTURE_PENDING && (ready & 2)) {
         // Progress the second future.
-        self->fut2_completed = self->fut2->progress(self->fut2, mio, waker);
+        Waker fut2_waker = waker_for_child(waker, self->ready, 1);
+        self->fut2_completed = self->fut2->progress(self->fut2, mio, fut2_waker);
         if (self->fut2_completed == FUTURE_FAILURE) {
             if (self->base.errcode == 0) {
                 self->base.errcode = JOIN_FUTURE_ERR_FUT2_FAILED;
@@ -87,6 +126,7 @@ static FutureState join_future_progress(Future* base, Mio* mio, Waker waker) {
     }
 
     if (self->fut1_completed != FUTURE_PENDING && self->fut2_completed != FUTURE_PENDING) {
+        pair_cell_release(&self->ready);
         if (self->base.errcode != 0) {
             return FUTURE_FAILURE;
         }
@@ -95,14 +135,29 @@ static FutureState join_future_progress(Future* base, Mio* mio, Waker waker) {
     return FUTURE_PENDING;
 }
 
+/** Cancel function for JoinFuture */
+static void join_future_cancel(Future* base, Mio* mio) {
+    JoinFuture* self = (JoinFuture*)base;
+    if (self->fut1_completed == FUTURE_PENDING) {
+        future_cancel(self->fut1, mio);
+    }
+    if (self->fut2_completed == FUTURE_PENDING) {
+        future_cancel(self->fut2, mio);
+    }
+    pair_cell_release(&self->ready);
+}
+
 JoinFuture future_join(Future* fut1, Future* fut2)
 {
+    Future base = future_create(join_future_progress);
+    base.cancel = join_future_cancel;
     return (JoinFuture) {
-        .base = future_create(join_future_progress),
+        .base = base,
         .fut1 = fut1,
         .fut2 = fut2,
         .fut1_completed = FUTURE_PENDING,
         .fut2_completed = FUTURE_PENDING,
+        .ready = NULL,
         .result = {
             .fut1 = {
                 .errcode = 0,
@@ -116,80 +171,395 @@ JoinFuture future_join(Future* fut1, Future* fut2)
     };
 }
 
-/** Progress function for SelectFuture */
-static FutureState select_future_progress(Future* base, Mio* mio, Waker waker) {
-    SelectFuture* self = (SelectFuture*)base;
-    debug("SelectFuture %p progress. which_completed=%d\n", self, self->which_completed);
+/**
+ * A two-level bitset of the woken children of an n-ary combinator, in cells that their wakers
+ * set (see `waker_for_child()`). Polling it only visits the flagged words and children.
+ */
+typedef struct ReadySet {
+    size_t n; // Children.
+    size_t n_words; // Cells of `woken`, 64 children each.
+    size_t n_groups; // Cells of `summary`, 64 cells of `woken` each.
+    WakeCell** summary; // Bit j of summary[g]: woken[64 * g + j] may be non-zero.
+    WakeCell** woken; // Bit b of woken[w]: child 64 * w + b has been woken.
+} ReadySet;
 
-    if (self->which_completed == SELECT_COMPLETED_NONE) {
-        // Progress the first future.
-        FutureState state = self->fut1->progress(self->fut1, mio, waker);
-        if (state == FUTURE_COMPLETED) {
-            self->which_completed = SELECT_COMPLETED_FUT1;
-            self->base.ok = self->fut1->ok;
-            return FUTURE_COMPLETED;
-        } else if (state == FUTURE_FAILURE) {
-            self->which_completed = SELECT_FAILED_FUT1;
-            self->base.errcode = FUTURE_FAILURE;
-        } else {
-            return FUTURE_PENDING;
+/** Polls child `i` of `self` with the given waker; returns true once the outcome is decided. */
+typedef bool (*ReadySetPollFn)(void* self, size_t i, Mio* mio, Waker waker);
+
+/** Returns a word with the lowest `bits` bits set. */
+static uint64_t low_bits(size_t bits)
+{
+    return bits >= 64 ? UINT64_MAX : (UINT64_C(1) << bits) - 1;
+}
+
+/** Allocates a ReadySet of `n` children, all marked as woken (so that all are polled first). */
+static ReadySet* ready_set_create(size_t n)
+{
+    size_t const n_words = (n + 63) / 64;
+    size_t const n_groups = (n_words + 63) / 64;
+    ReadySet* set = (ReadySet*) malloc(sizeof(ReadySet) + (n_groups + n_words) * sizeof(WakeCell*));
+    if (!set) {
+        return NULL;
+    }
+    set->n = n;
+    set->n_words = n_words;
+    set->n_groups = n_groups;
+    set->summary = (WakeCell**) (set + 1);
+    set->woken = set->summary + n_groups;
+    if (!wake_cells_alloc(set->summary, n_groups + n_words)) {
+        free(set);
+        return NULL;
+    }
+
+    for (size_t w = 0; w < n_words; w++) {
+        atomic_store_explicit(&set->woken[w]->bits, low_bits(n - 64 * w), memory_order_relaxed);
+    }
+    for (size_t g = 0; g < n_groups; g++) {
+        atomic_store_explicit(&set->summary[g]->bits, low_bits(n_words - 64 * g), memory_order_relaxed);
+    }
+    return set;
+}
+
+/**
+ * Frees a ReadySet (if any). Its cells go back to the pool, so the wakers that the children may
+ * still hold only wake the task, without setting any bits.
+ */
+static void ready_set_destroy(ReadySet** set)
+{
+    if (*set) {
+        wake_cells_release((*set)->summary, (*set)->n_groups + (*set)->n_words);
+        free(*set);
+        *set = NULL;
+    }
+}
+
+/**
+ * Calls `poll` for every child woken since the last call, each with its own waker derived
+ * from `waker`, until `poll` returns true (then returns true as well).
+ */
+static bool ready_set_poll(ReadySet* set, ReadySetPollFn poll, void* self, Mio* mio, Waker waker)
+{
+    for (size_t g = 0; g < set->n_groups; g++) {
+        // A stale wake may have set bits past the end.
+        uint64_t words = atomic_exchange_explicit(&set->summary[g]->bits, 0, memory_order_acquire)
+            & low_bits(set->n_words - 64 * g);
+        while (words) {
+            size_t const j = __builtin_ctzll(words);
+            words &= words - 1;
+            size_t const w = 64 * g + j;
+            Waker word_waker = waker_for_child(waker, set->summary[g], j);
+            uint64_t children = atomic_exchange_explicit(&set->woken[w]->bits, 0, memory_order_acquire)
+                & low_bits(set->n - 64 * w);
+            while (children) {
+                size_t const b = __builtin_ctzll(children);
+                children &= children - 1;
+                size_t const i = 64 * w + b;
+                Waker child_waker = waker_for_child(word_waker, set->woken[w], b);
+                if (poll(self, i, mio, child_waker)) {
+                    // Leave the rest flagged (though the caller is done with them anyway).
+                    atomic_fetch_or(&set->woken[w]->bits, children);
+                    atomic_fetch_or(&set->summary[g]->bits, words | (UINT64_C(1) << j));
+                    return true;
+                }
+            }
         }
     }
+    return false;
+}
 
-    if (self->which_completed == SELECT_COMPLETED_NONE) {
-        // Progress the second future.
-        FutureState state = self->fut2->progress(self->fut2, mio, waker);
-        if (state == FUTURE_COMPLETED) {
-            self->which_completed = SELECT_COMPLETED_FUT2;
-            self->base.ok = self->fut2->ok;
-            return FUTURE_COMPLETED;
-        } else if (state == FUTURE_FAILURE) {
-            self->which_completed = SELECT_FAILED_FUT2;
-            self->base.errcode = FUTURE_FAILURE;
-        } else {
+/** Progresses the i-th future of a JoinAllFuture, saving its result if it is done. */
+static bool join_all_future_progress_one(void* arg, size_t i, Mio* mio, Waker waker)
+{
+    JoinAllFuture* self = arg;
+    FutureResult* result = &self->results[i];
+    if (result->state != FUTURE_PENDING) {
+        return false;
+    }
+    Future* fut = self->futs[i];
+    result->state = fut->progress(fut, mio, waker);
+    if (result->state == FUTURE_COMPLETED) {
+        result->ok = fut->ok;
+        self->n_pending--;
+    } else if (result->state == FUTURE_FAILURE) {
+        result->errcode = fut->errcode;
+        self->base.errcode = JOIN_ALL_FUTURE_ERR_FAILED;
+        self->n_pending--;
+    }
+    return self->n_pending == 0;
+}
+
+/** Progress function for JoinAllFuture */
+static FutureState join_all_future_progress(Future* base, Mio* mio, Waker waker) {
+    JoinAllFuture* self = (JoinAllFuture*)base;
+    debug("JoinAllFuture %p progress. n_pending=%zu\n", self, self->n_pending);
+
+    if (self->n_pending > 0) {
+        if (!self->ready) {
+            self->ready = ready_set_create(self->n);
+            if (!self->ready) {
+                self->base.errcode = JOIN_ALL_FUTURE_ERR_NO_MEMORY;
+                return FUTURE_FAILURE;
+            }
+        }
+        // Only progress the futures that have been woken since the last time.
+        if (!ready_set_poll(self->ready, join_all_future_progress_one, self, mio, waker)) {
             return FUTURE_PENDING;
         }
     }
 
-    if (self->which_completed == SELECT_FAILED_FUT1) {
-        // Progress the second future.
-        FutureState state = self->fut2->progress(self->fut2, mio, waker);
-        if (state == FUTURE_COMPLETED) {
-            self->which_completed = SELECT_COMPLETED_FUT2;
-            self->base.ok = self->fut2->ok;
-            return FUTURE_COMPLETED;
-        } else if (state == FUTURE_FAILURE) {
-            self->which_completed = SELECT_FAILED_BOTH;
-            self->base.errcode = FUTURE_FAILURE;
-        } else {
-            return FUTURE_PENDING;
+    ready_set_destroy(&self->ready);
+    if (self->base.errcode != 0) {
+        return FUTURE_FAILURE;
+    }
+    self->base.ok = self->results;
+    return FUTURE_COMPLETED;
+}
+
+/** Cancel function for JoinAllFuture */
+static void join_all_future_cancel(Future* base, Mio* mio) {
+    JoinAllFuture* self = (JoinAllFuture*)base;
+    for (size_t i = 0; i < self->n; i++) {
+        if (self->results[i].state == FUTURE_PENDING) {
+            future_cancel(self->futs[i], mio);
         }
     }
+    ready_set_destroy(&self->ready);
+}
 
-    if (self->which_completed == SELECT_FAILED_FUT2) {
-        // Progress the first future.
-        FutureState state = self->fut1->progress(self->fut1, mio, waker);
-        if (state == FUTURE_COMPLETED) {
-            self->which_completed = SELECT_COMPLETED_FUT1;
-            self->base.ok = self->fut1->ok;
-            return FUTURE_COMPLETED;
-        } else if (state == FUTURE_FAILURE) {
-            self->which_completed = SELECT_FAILED_BOTH;
-            self->base.errcode = FUTURE_FAILURE;
-        } else {
+JoinAllFuture future_join_all(Future** futs, size_t n, FutureResult* results)
+{
+    for (size_t i = 0; i < n; i++) {
+        results[i] = (FutureResult) { .state = FUTURE_PENDING, .errcode = 0, .ok = NULL };
+    }
+    Future base = future_create(join_all_future_progress);
+    base.cancel = join_all_future_cancel;
+    return (JoinAllFuture) {
+        .base = base,
+        .futs = futs,
+        .n = n,
+        .n_pending = n,
+        .results = results,
+        .ready = NULL,
+    };
+}
+
+/** Progresses the i-th future of a QuorumFuture; returns true once the outcome is decided. */
+static bool quorum_future_progress_one(void* arg, size_t i, Mio* mio, Waker waker)
+{
+    QuorumFuture* self = arg;
+    FutureResult* result = &self->results[i];
+    if (result->state != FUTURE_PENDING) {
+        return false;
+    }
+    Future* fut = self->futs[i];
+    result->state = fut->progress(fut, mio, waker);
+    if (result->state == FUTURE_COMPLETED) {
+        result->ok = fut->ok;
+        if (self->n_completed++ == 0) {
+            self->winner = i;
+        }
+    } else if (result->state == FUTURE_FAILURE) {
+        result->errcode = fut->errcode;
+        self->n_failed++;
+    }
+    return self->n_completed == self->k || self->n_failed > self->n - self->k;
+}
+
+/** Cancels the futures of a QuorumFuture that are still pending, and frees its ReadySet. */
+static void quorum_future_cancel(Future* base, Mio* mio) {
+    QuorumFuture* self = (QuorumFuture*)base;
+    for (size_t i = 0; i < self->n; i++) {
+        if (self->results[i].state == FUTURE_PENDING) {
+            future_cancel(self->futs[i], mio);
+        }
+    }
+    ready_set_destroy(&self->ready);
+}
+
+/** Progress function for QuorumFuture */
+static FutureState quorum_future_progress(Future* base, Mio* mio, Waker waker) {
+    QuorumFuture* self = (QuorumFuture*)base;
+    debug("QuorumFuture %p progress. n_completed=%zu, n_failed=%zu\n", self, self->n_completed,
+        self->n_failed);
+
+    if (self->n_completed < self->k && self->n_failed <= self->n - self->k) {
+        if (!self->ready) {
+            self->ready = ready_set_create(self->n);
+            if (!self->ready) {
+                self->base.errcode = QUORUM_FUTURE_ERR_NO_MEMORY;
+                return FUTURE_FAILURE;
+            }
+        }
+        // Only progress the futures that have been woken since the last time.
+        if (!ready_set_poll(self->ready, quorum_future_progress_one, self, mio, waker)) {
             return FUTURE_PENDING;
         }
     }
 
+    // Decided: the losers will not be needed anymore.
+    quorum_future_cancel(base, mio);
+    if (self->n_completed < self->k) {
+        self->base.errcode = QUORUM_FUTURE_ERR_UNREACHABLE;
+        return FUTURE_FAILURE;
+    }
+    self->base.ok = self->k == 1 ? self->results[self->winner].ok : (void*)self->results;
+    return FUTURE_COMPLETED;
+}
+
+QuorumFuture future_quorum(Future** futs, size_t n, size_t k, FutureResult* results)
+{
+    if (k > n) {
+        fatal("future_quorum: k > n");
+    }
+    for (size_t i = 0; i < n; i++) {
+        results[i] = (FutureResult) { .state = FUTURE_PENDING, .errcode = 0, .ok = NULL };
+    }
+    Future base = future_create(quorum_future_progress);
+    base.cancel = quorum_future_cancel;
+    return (QuorumFuture) {
+        .base = base,
+        .futs = futs,
+        .n = n,
+        .k = k,
+        .n_completed = 0,
+        .n_failed = 0,
+        .winner = 0,
+        .results = results,
+        .ready = NULL,
+    };
+}
+
+QuorumFuture future_select_any(Future** futs, size_t n, FutureResult* results)
+{
+    return future_quorum(futs, n, 1, results);
+}
+
+/**
+ * Progresses one of the futures of a SelectFuture (if it has been woken and is still running).
+ * Returns true if it has completed, so that the SelectFuture completes with its result.
+ */
+static bool select_future_progress_one(SelectFuture* self, int i, uint64_t ready, Mio* mio,
+    Waker waker)
+{
+    Future* fut = i == 0 ? self->fut1 : self->fut2;
+    int const failed = i == 0 ? SELECT_FAILED_FUT1 : SELECT_FAILED_FUT2;
+    int const other_failed = i == 0 ? SELECT_FAILED_FUT2 : SELECT_FAILED_FUT1;
+    if (!(ready & (UINT64_C(1) << i))
+        || (self->which_completed != SELECT_COMPLETED_NONE && self->which_completed != other_failed)) {
+        return false;
+    }
+
+    Waker fut_waker = waker_for_child(waker, self->ready, i);
+    FutureState state = fut->progress(fut, mio, fut_waker);
+    if (state == FUTURE_COMPLETED) {
+        if (self->which_completed != other_failed) {
+            // The other future lost: release what it holds, e.g. its Mio registration.
+            future_cancel(i == 0 ? self->fut2 : self->fut1, mio);
+        }
+        self->which_completed = i == 0 ? SELECT_COMPLETED_FUT1 : SELECT_COMPLETED_FUT2;
+        self->base.ok = fut->ok;
+        return true;
+    } else if (state == FUTURE_FAILURE) {
+        self->which_completed
+            = self->which_completed == other_failed ? SELECT_FAILED_BOTH : failed;
+        self->base.errcode = FUTURE_FAILURE;
+    }
+    return false;
+}
+
+/** Progress function for SelectFuture */
+static FutureState select_future_progress(Future* base, Mio* mio, Waker waker) {
+    SelectFuture* self = (SelectFuture*)base;
+    debug("SelectFuture %p progress. which_completed=%d\n", self, self->which_completed);
+
+    if (!self->ready) {
+        self->ready = pair_cell_create();
+    }
+    // Only progress the futures that have been woken since the last time.
+    uint64_t const ready = atomic_exchange_explicit(&self->ready->bits, 0, memory_order_acquire);
+    if (select_future_progress_one(self, 0, ready, mio, waker)
+        || select_future_progress_one(self, 1, ready, mio, waker)) {
+        pair_cell_release(&self->ready);
+        return FUTURE_COMPLETED;
+    }
+    if (self->which_completed == SELECT_FAILED_BOTH) {
+        pair_cell_release(&self->ready);
+        return FUTURE_FAILURE;
+    }
     return FUTURE_PENDING;
 }
 
+/** Cancel function for SelectFuture */
+static void select_future_cancel(Future* base, Mio* mio) {
+    SelectFuture* self = (SelectFuture*)base;
+    if (self->which_completed != SELECT_FAILED_FUT1) {
+        future_cancel(self->fut1, mio);
+    }
+    if (self->which_completed != SELECT_FAILED_FUT2) {
+        future_cancel(self->fut2, mio);
+    }
+    pair_cell_release(&self->ready);
+}
+
 SelectFuture future_select(Future* fut1, Future* fut2)
 {
+    Future base = future_create(select_future_progress);
+    base.cancel = select_future_cancel;
     return (SelectFuture) {
-        .base = future_create(select_future_progress),
+        .base = base,
         .fut1 = fut1,
         .fut2 = fut2,
         .which_completed = SELECT_COMPLETED_NONE,
+        .ready = NULL,
+    };
+}
+
+/** Progress function for TimeoutFuture */
+static FutureState timeout_future_progress(Future* base, Mio* mio, Waker waker) {
+    TimeoutFuture* self = (TimeoutFuture*)base;
+    debug("TimeoutFuture %p progress. deadline=%lu\n", self, (unsigned long)self->deadline);
+
+    // Give the future a chance first, even if the deadline has just passed.
+    FutureState state = self->fut->progress(self->fut, mio, waker);
+    if (state == FUTURE_COMPLETED) {
+        mio_timer_cancel(mio, &self->timer);
+        self->base.ok = self->fut->ok;
+        return FUTURE_COMPLETED;
+    } else if (state == FUTURE_FAILURE) {
+        mio_timer_cancel(mio, &self->timer);
+        self->base.errcode = TIMEOUT_FUTURE_ERR_FUT_FAILED;
+        return FUTURE_FAILURE;
+    }
+
+    if (atomic_load(&self->timer.state) == TIMER_FIRED || timer_now_ms() >= self->deadline) {
+        debug("TimeoutFuture %p progress. timed out\n", self);
+        mio_timer_cancel(mio, &self->timer);
+        future_cancel(self->fut, mio);
+        self->base.errcode = TIMEOUT_FUTURE_ERR_TIMED_OUT;
+        return FUTURE_FAILURE;
+    }
+
+    if (atomic_load(&self->timer.state) == TIMER_IDLE) {
+        mio_timer_arm(mio, &self->timer, self->deadline, waker);
+    }
+    return FUTURE_PENDING;
+}
+
+/** Cancel function for TimeoutFuture */
+static void timeout_future_cancel(Future* base, Mio* mio) {
+    TimeoutFuture* self = (TimeoutFuture*)base;
+    mio_timer_cancel(mio, &self->timer);
+    future_cancel(self->fut, mio);
+}
+
+TimeoutFuture future_timeout(Future* fut, uint64_t deadline)
+{
+    Future base = future_create(timeout_future_progress);
+    base.cancel = timeout_future_cancel;
+    return (TimeoutFuture) {
+        .base = base,
+        .fut = fut,
+        .deadline = deadline,
+        .timer = timer_entry_create(),
     };
 }
@@ -1,9 +1,20 @@
+// Required for `sys/socket.h` include to contain `accept4`, `recvmmsg` and `sendmmsg`,
+// and for `fcntl.h` include to contain `splice` and `tee`.
+#define _GNU_SOURCE
+
 #include "future_examples.h"
 
 #include <errno.h>
+#include <fcntl.h> // For splice, tee
+#include <limits.h> // For IOV_MAX
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <stdint.h>
 #include <string.h>
 #include <sys/epoll.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "debug.h"
@@ -31,13 +42,104 @@ ApplyFuture apply_future_create(void* (*func)(void*))
     return apply_future;
 }
 
+/**
+ * Makes a pipe future wait until fd is ready for `events` (after an operation failed with
+ * EAGAIN, or was skipped as `*readiness` says the fd is not ready).
+ *
+ * Returns false if the future should rather try again right away (an event has arrived for
+ * a persistently registered fd, see `mio_clear_readiness()`), after refreshing `*readiness`.
+ */
+static bool pipe_wait(Mio* mio, int fd, uint32_t events, bool persistent, MioReadiness* readiness,
+    Waker waker)
+{
+    if (!persistent) {
+        mio_register(mio, fd, events, waker);
+        return true;
+    }
+    if (mio_clear_readiness(mio, fd, *readiness, events, waker)) {
+        return true;
+    }
+    mio_readiness(mio, fd, readiness);
+    return false;
+}
+
+/**
+ * Transfers bytes for a pipe future with Mio's io_uring backend: submits a read (or a write)
+ * of `n` bytes straight into (or from) `buffer` if `*op` is -1, and checks it otherwise.
+ *
+ * Returns true once it completes, storing its result (bytes transferred, or -errno) in
+ * `*result`; until then, the future is woken on completion.
+ */
+static bool pipe_transfer(Mio* mio, int* op, bool write, int fd, uint8_t* buffer, size_t n,
+    Waker waker, int* result)
+{
+    if (*op == -1) {
+        *op = write ? mio_submit_write(mio, fd, buffer, n, waker)
+                    : mio_submit_read(mio, fd, buffer, n, waker);
+        if (*op == -1) {
+            *result = -ENOMEM;
+            return true;
+        }
+        return false;
+    }
+    if (!mio_op_poll(mio, *op, waker, result)) {
+        return false;
+    }
+    *op = -1;
+    return true;
+}
+
+/** Progress function for PipeReadFuture with the io_uring backend. */
+static FutureState pipe_read_progress_uring(PipeReadFuture* self, Mio* mio, Waker waker)
+{
+    while (self->read_so_far < self->n) {
+        int result;
+        if (!pipe_transfer(mio, &self->op, false, self->fd, self->buffer + self->read_so_far,
+                self->n - self->read_so_far, waker, &result)) {
+            return FUTURE_PENDING;
+        }
+        debug("PipeReadFuture %p: read %d\n", self, result);
+
+        if (result == 0) {
+            self->base.errcode = PIPE_FUTURE_ERR_EOF;
+            return FUTURE_FAILURE;
+        } else if (result > 0) {
+            self->read_so_far += result;
+            if (!future_budget_consume()) {
+                waker_wake(&waker);
+                return FUTURE_PENDING;
+            }
+        } else if (result != -EAGAIN && result != -EINTR) {
+            self->base.errcode = PIPE_FUTURE_ERR_IO;
+            return FUTURE_FAILURE;
+        }
+    }
+
+    self->base.ok = self->buffer;
+    return FUTURE_COMPLETED;
+}
+
 /** Progress function for PipeReadFuture */
 static FutureState pipe_read_progress(Future* base, Mio* mio, Waker waker)
 {
     PipeReadFuture* self = (PipeReadFuture*)base;
     debug("PipeReadFuture %p progress. read_so_far=%zu, n=%zu\n", self, self->read_so_far, self->n);
 
+    if (mio_backend(mio) == MIO_BACKEND_IO_URING) {
+        return pipe_read_progress_uring(self, mio, waker);
+    }
+
+    // Persistently registered fds do not need to be registered, unless they are not ready.
+    MioReadiness readiness;
+    bool const persistent = mio_readiness(mio, self->fd, &readiness);
+
     while (self->read_so_far < self->n) {
+        if (persistent && !(readiness.events & EPOLLIN)) {
+            if (pipe_wait(mio, self->fd, EPOLLIN, persistent, &readiness, waker)) {
+                return FUTURE_PENDING;
+            }
+            continue;
+        }
         // There are some bytes yet to be read. Try reading from the pipe.
         ssize_t const bytes_read
             = read(self->fd, self->buffer + self->read_so_far, self->n - self->read_so_far);
@@ -45,36 +147,92 @@ static FutureState pipe_read_progress(Future* base, Mio* mio, Waker waker)
             strerror(bytes_read == -1 ? errno : 0));
 
         if (bytes_read == 0) {
-            mio_unregister(mio, self->fd);
+            mio_unregister_interest(mio, self->fd, EPOLLIN);
             self->base.errcode = PIPE_FUTURE_ERR_EOF;
             return FUTURE_FAILURE;
         } else if (bytes_read > 0) {
             self->read_so_far += bytes_read;
+            if (!future_budget_consume()) {
+                // Used up the task's budget: let the others run, and continue later.
+                waker_wake(&waker);
+                return FUTURE_PENDING;
+            }
         } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
             // Could not read from pipe.
             // Register the FD with MIO to watch for readability.
-            mio_register(mio, self->fd, EPOLLIN, waker);
-            return FUTURE_PENDING;
+            if (pipe_wait(mio, self->fd, EPOLLIN, persistent, &readiness, waker)) {
+                return FUTURE_PENDING;
+            }
+        } else if (errno != EINTR) {
+            mio_unregister_interest(mio, self->fd, EPOLLIN);
+            self->base.errcode = PIPE_FUTURE_ERR_IO;
+            return FUTURE_FAILURE;
         }
     }
 
     // Read enough bytes.
-    mio_unregister(mio, self->fd);
+    mio_unregister_interest(mio, self->fd, EPOLLIN);
     self->base.ok = self->buffer;
     return FUTURE_COMPLETED;
 }
 
+/** Cancel function for PipeReadFuture */
+static void pipe_read_cancel(Future* base, Mio* mio)
+{
+    PipeReadFuture* self = (PipeReadFuture*)base;
+    debug("PipeReadFuture %p cancelled\n", self);
+    if (self->op != -1) {
+        mio_op_cancel(mio, self->op);
+        self->op = -1;
+    }
+    mio_unregister_interest(mio, self->fd, EPOLLIN);
+}
+
 PipeReadFuture pipe_read_future_create(int fd, uint8_t* buffer, size_t n)
 {
+    Future base = future_create(pipe_read_progress);
+    base.cancel = pipe_read_cancel;
     return (PipeReadFuture) {
-        .base = future_create(pipe_read_progress),
+        .base = base,
         .fd = fd,
         .buffer = buffer,
         .n = n,
         .read_so_far = 0,
+        .op = -1,
     };
 }
 
+/** Progress function for PipeWriteFuture with the io_uring backend. */
+static FutureState pipe_write_progress_uring(PipeWriteFuture* self, Mio* mio, Waker waker)
+{
+    uint8_t* buffer = self->base.arg;
+    while (self->written_so_far < self->n) {
+        int result;
+        if (!pipe_transfer(mio, &self->op, true, self->fd, buffer + self->written_so_far,
+                self->n - self->written_so_far, waker, &result)) {
+            return FUTURE_PENDING;
+        }
+        debug("PipeWriteFuture %p: write %d\n", self, result);
+
+        if (result == 0) {
+            self->base.errcode = PIPE_FUTURE_ERR_EOF;
+            return FUTURE_FAILURE;
+        } else if (result > 0) {
+            self->written_so_far += result;
+            if (!future_budget_consume()) {
+                waker_wake(&waker);
+                return FUTURE_PENDING;
+            }
+        } else if (result != -EAGAIN && result != -EINTR) {
+            self->base.errcode = PIPE_FUTURE_ERR_IO;
+            return FUTURE_FAILURE;
+        }
+    }
+
+    self->base.ok = buffer;
+    return FUTURE_COMPLETED;
+}
+
 /** Progress function for PipeWriteFuture */
 static FutureState pipe_write_progress(Future* base, Mio* mio, Waker waker)
 {
@@ -93,7 +251,21 @@ static FutureState pipe_write_progress(Future* base, Mio* mio, Waker waker)
         self->stop_on_zero_byte = false;
     }
 
+    if (mio_backend(mio) == MIO_BACKEND_IO_URING) {
+        return pipe_write_progress_uring(self, mio, waker);
+    }
+
+    // Persistently registered fds do not need to be registered, unless they are not ready.
+    MioReadiness readiness;
+    bool const persistent = mio_readiness(mio, self->fd, &readiness);
+
     while (self->written_so_far < self->n) {
+        if (persistent && !(readiness.events & EPOLLOUT)) {
+            if (pipe_wait(mio, self->fd, EPOLLOUT, persistent, &readiness, waker)) {
+                return FUTURE_PENDING;
+            }
+            continue;
+        }
         // There are some bytes yet to be written. Try writing to the pipe.
         ssize_t const bytes_written
             = write(self->fd, buffer + self->written_so_far, self->n - self->written_so_far);
@@ -101,32 +273,965 @@ static FutureState pipe_write_progress(Future* base, Mio* mio, Waker waker)
             strerror(bytes_written == -1 ? errno : 0));
 
         if (bytes_written == 0) {
-            mio_unregister(mio, self->fd);
+            mio_unregister_interest(mio, self->fd, EPOLLOUT);
             self->base.errcode = PIPE_FUTURE_ERR_EOF;
             return FUTURE_FAILURE;
         } else if (bytes_written > 0) {
             self->written_so_far += bytes_written;
+            if (!future_budget_consume()) {
+                // Used up the task's budget: let the others run, and continue later.
+                waker_wake(&waker);
+                return FUTURE_PENDING;
+            }
         } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
             // Could not write from pipe.
             // Register the FD with MIO to watch for writeability.
-            mio_register(mio, self->fd, EPOLLIN, waker);
-            return FUTURE_PENDING;
+            if (pipe_wait(mio, self->fd, EPOLLOUT, persistent, &readiness, waker)) {
+                return FUTURE_PENDING;
+            }
+        } else if (errno != EINTR) {
+            mio_unregister_interest(mio, self->fd, EPOLLOUT);
+            self->base.errcode = PIPE_FUTURE_ERR_IO;
+            return FUTURE_FAILURE;
         }
     }
 
     // Read enough bytes.
-    mio_unregister(mio, self->fd);
+    mio_unregister_interest(mio, self->fd, EPOLLOUT);
     self->base.ok = (void*)buffer;
     return FUTURE_COMPLETED;
 }
 
+/** Cancel function for PipeWriteFuture */
+static void pipe_write_cancel(Future* base, Mio* mio)
+{
+    PipeWriteFuture* self = (PipeWriteFuture*)base;
+    debug("PipeWriteFuture %p cancelled\n", self);
+    if (self->op != -1) {
+        mio_op_cancel(mio, self->op);
+        self->op = -1;
+    }
+    mio_unregister_interest(mio, self->fd, EPOLLOUT);
+}
+
 PipeWriteFuture pipe_write_future_create(int fd, size_t n, bool stop_on_zero_byte)
 {
+    Future base = future_create(pipe_write_progress);
+    base.cancel = pipe_write_cancel;
     return (PipeWriteFuture) {
-        .base = future_create(pipe_write_progress),
+        .base = base,
         .fd = fd,
         .n = n,
         .written_so_far = 0,
         .stop_on_zero_byte = stop_on_zero_byte,
+        .op = -1,
+    };
+}
+
+/**
+ * Moves `*index` and `*offset` (a position in `iov`) `n` bytes forward, and past empty segments.
+ */
+static void iov_advance(struct iovec const* iov, int iovcnt, int* index, size_t* offset, size_t n)
+{
+    while (*index < iovcnt && *offset + n >= iov[*index].iov_len) {
+        n -= iov[*index].iov_len - *offset;
+        (*index)++;
+        *offset = 0;
+    }
+    *offset += n;
+}
+
+/**
+ * Reads (or writes) the segments of `iov` from `*index` on, skipping the first `*offset` bytes,
+ * with a single readv() (or writev()), and advances the position past the bytes transferred.
+ * Returns what readv() (or writev()) returns.
+ */
+static ssize_t pipe_transfer_vectored(
+    bool write, int fd, struct iovec* iov, int iovcnt, int* index, size_t* offset)
+{
+    // Start the first segment at the offset for the syscall only, leaving `iov` unchanged.
+    struct iovec* const first = &iov[*index];
+    struct iovec const saved = *first;
+    first->iov_base = (uint8_t*)first->iov_base + *offset;
+    first->iov_len -= *offset;
+    int const count = iovcnt - *index < IOV_MAX ? iovcnt - *index : IOV_MAX;
+    ssize_t const result = write ? writev(fd, first, count) : readv(fd, first, count);
+    *first = saved;
+    if (result > 0) {
+        iov_advance(iov, iovcnt, index, offset, result);
+    }
+    return result;
+}
+
+/** Progress function for PipeReadvFuture */
+static FutureState pipe_readv_progress(Future* base, Mio* mio, Waker waker)
+{
+    PipeReadvFuture* self = (PipeReadvFuture*)base;
+    debug("PipeReadvFuture %p progress. iov_index=%d, iovcnt=%d\n", self, self->iov_index,
+        self->iovcnt);
+
+    MioReadiness readiness;
+    bool const persistent = mio_readiness(mio, self->fd, &readiness);
+
+    iov_advance(self->iov, self->iovcnt, &self->iov_index, &self->iov_offset, 0);
+    while (self->iov_index < self->iovcnt) {
+        if (persistent && !(readiness.events & EPOLLIN)) {
+            if (pipe_wait(mio, self->fd, EPOLLIN, persistent, &readiness, waker)) {
+                return FUTURE_PENDING;
+            }
+            continue;
+        }
+        ssize_t const bytes_read = pipe_transfer_vectored(
+            false, self->fd, self->iov, self->iovcnt, &self->iov_index, &self->iov_offset);
+        debug("PipeReadvFuture %p: readv %zd, errno %s\n", self, bytes_read,
+            strerror(bytes_read == -1 ? errno : 0));
+
+        if (bytes_read == 0) {
+            mio_unregister_interest(mio, self->fd, EPOLLIN);
+            self->base.errcode = PIPE_FUTURE_ERR_EOF;
+            return FUTURE_FAILURE;
+        } else if (bytes_read > 0) {
+            self->read_so_far += bytes_read;
+            if (self->iov_index < self->iovcnt && !future_budget_consume()) {
+                waker_wake(&waker);
+                return FUTURE_PENDING;
+            }
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (pipe_wait(mio, self->fd, EPOLLIN, persistent, &readiness, waker)) {
+                return FUTURE_PENDING;
+            }
+        } else if (errno != EINTR) {
+            mio_unregister_interest(mio, self->fd, EPOLLIN);
+            self->base.errcode = PIPE_FUTURE_ERR_IO;
+            return FUTURE_FAILURE;
+        }
+    }
+
+    mio_unregister_interest(mio, self->fd, EPOLLIN);
+    self->base.ok = self->iov;
+    return FUTURE_COMPLETED;
+}
+
+/** Cancel function for PipeReadvFuture */
+static void pipe_readv_cancel(Future* base, Mio* mio)
+{
+    PipeReadvFuture* self = (PipeReadvFuture*)base;
+    mio_unregister_interest(mio, self->fd, EPOLLIN);
+}
+
+PipeReadvFuture pipe_readv_future_create(int fd, struct iovec* iov, int iovcnt)
+{
+    Future base = future_create(pipe_readv_progress);
+    base.cancel = pipe_readv_cancel;
+    return (PipeReadvFuture) {
+        .base = base,
+        .fd = fd,
+        .iov = iov,
+        .iovcnt = iovcnt,
+        .iov_index = 0,
+        .iov_offset = 0,
+        .read_so_far = 0,
+    };
+}
+
+/** Progress function for PipeWritevFuture */
+static FutureState pipe_writev_progress(Future* base, Mio* mio, Waker waker)
+{
+    PipeWritevFuture* self = (PipeWritevFuture*)base;
+    debug("PipeWritevFuture %p progress. iov_index=%d, iovcnt=%d\n", self, self->iov_index,
+        self->iovcnt);
+
+    MioReadiness readiness;
+    bool const persistent = mio_readiness(mio, self->fd, &readiness);
+
+    iov_advance(self->iov, self->iovcnt, &self->iov_index, &self->iov_offset, 0);
+    while (self->iov_index < self->iovcnt) {
+        if (persistent && !(readiness.events & EPOLLOUT)) {
+            if (pipe_wait(mio, self->fd, EPOLLOUT, persistent, &readiness, waker)) {
+                return FUTURE_PENDING;
+            }
+            continue;
+        }
+        ssize_t const bytes_written = pipe_transfer_vectored(
+            true, self->fd, self->iov, self->iovcnt, &self->iov_index, &self->iov_offset);
+        debug("PipeWritevFuture %p: writev %zd, errno %s\n", self, bytes_written,
+            strerror(bytes_written == -1 ? errno : 0));
+
+        if (bytes_written == 0) {
+            mio_unregister_interest(mio, self->fd, EPOLLOUT);
+            self->base.errcode = PIPE_FUTURE_ERR_EOF;
+            return FUTURE_FAILURE;
+        } else if (bytes_written > 0) {
+            self->written_so_far += bytes_written;
+            if (self->iov_index < self->iovcnt && !future_budget_consume()) {
+                waker_wake(&waker);
+                return FUTURE_PENDING;
+            }
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (pipe_wait(mio, self->fd, EPOLLOUT, persistent, &readiness, waker)) {
+                return FUTURE_PENDING;
+            }
+        } else if (errno != EINTR) {
+            mio_unregister_interest(mio, self->fd, EPOLLOUT);
+            self->base.errcode = PIPE_FUTURE_ERR_IO;
+            return FUTURE_FAILURE;
+        }
+    }
+
+    mio_unregister_interest(mio, self->fd, EPOLLOUT);
+    self->base.ok = self->iov;
+    return FUTURE_COMPLETED;
+}
+
+/** Cancel function for PipeWritevFuture */
+static void pipe_writev_cancel(Future* base, Mio* mio)
+{
+    PipeWritevFuture* self = (PipeWritevFuture*)base;
+    mio_unregister_interest(mio, self->fd, EPOLLOUT);
+}
+
+PipeWritevFuture pipe_writev_future_create(int fd, struct iovec* iov, int iovcnt)
+{
+    Future base = future_create(pipe_writev_progress);
+    base.cancel = pipe_writev_cancel;
+    return (PipeWritevFuture) {
+        .base = base,
+        .fd = fd,
+        .iov = iov,
+        .iovcnt = iovcnt,
+        .iov_index = 0,
+        .iov_offset = 0,
+        .written_so_far = 0,
+    };
+}
+
+#define SPLICE_PIPE_SIZE (1 << 20) // Capacity asked for the internal pipe (the default max).
+
+/** Closes the internal pipe of a SpliceFuture and stops waiting for its fds. */
+static void splice_cleanup(SpliceFuture* self, Mio* mio)
+{
+    mio_unregister_interest(mio, self->in_fd, EPOLLIN);
+    mio_unregister_interest(mio, self->out_fd, EPOLLOUT);
+    if (self->tee_fd != -1) {
+        mio_unregister_interest(mio, self->tee_fd, EPOLLOUT);
+    }
+    for (int i = 0; i < 2; i++) {
+        if (self->pipe[i] != -1) {
+            close(self->pipe[i]);
+            self->pipe[i] = -1;
+        }
+    }
+}
+
+/** Fails a SpliceFuture with `error`. */
+static FutureState splice_fail(SpliceFuture* self, Mio* mio, int error)
+{
+    splice_cleanup(self, mio);
+    self->error = error;
+    self->base.errcode = SPLICE_FUTURE_ERR_IO;
+    return FUTURE_FAILURE;
+}
+
+/** Progress function for SpliceFuture */
+static FutureState splice_progress(Future* base, Mio* mio, Waker waker)
+{
+    SpliceFuture* self = (SpliceFuture*)base;
+    debug("SpliceFuture %p progress. buffered=%zu, n_forwarded=%zu\n", self, self->buffered,
+        self->n_forwarded);
+
+    if (self->pipe[0] == -1) {
+        if (pipe2(self->pipe, O_NONBLOCK | O_CLOEXEC) == -1) {
+            self->pipe[0] = self->pipe[1] = -1;
+            return splice_fail(self, mio, errno);
+        }
+        // A larger pipe moves more per splice() (if allowed, see /proc/sys/fs/pipe-max-size).
+        fcntl(self->pipe[1], F_SETPIPE_SZ, SPLICE_PIPE_SIZE);
+    }
+
+    MioReadiness in_readiness, out_readiness, tee_readiness;
+    bool const in_persistent = mio_readiness(mio, self->in_fd, &in_readiness);
+    bool const out_persistent = mio_readiness(mio, self->out_fd, &out_readiness);
+    bool const tee_persistent
+        = self->tee_fd != -1 && mio_readiness(mio, self->tee_fd, &tee_readiness);
+
+    for (;;) {
+        // The internal pipe is emptied before it is refilled, so that the tee() of its front
+        // never copies bytes that have been copied already.
+        if (self->tee_fd != -1 && self->teed == 0 && self->buffered > 0) {
+            if (tee_persistent && !(tee_readiness.events & EPOLLOUT)) {
+                if (pipe_wait(mio, self->tee_fd, EPOLLOUT, true, &tee_readiness, waker)) {
+                    return FUTURE_PENDING;
+                }
+                continue;
+            }
+            ssize_t const n = tee(self->pipe[0], self->tee_fd, self->buffered, SPLICE_F_NONBLOCK);
+            if (n > 0) {
+                self->teed = n;
+            } else if (n == -1 && errno == EAGAIN) {
+                if (pipe_wait(mio, self->tee_fd, EPOLLOUT, tee_persistent, &tee_readiness, waker)) {
+                    return FUTURE_PENDING;
+                }
+            } else if (n == -1 && errno != EINTR) {
+                return splice_fail(self, mio, errno);
+            }
+            continue;
+        }
+        size_t const to_out = self->tee_fd != -1 ? self->teed : self->buffered;
+        if (to_out > 0) {
+            if (out_persistent && !(out_readiness.events & EPOLLOUT)) {
+                if (pipe_wait(mio, self->out_fd, EPOLLOUT, true, &out_readiness, waker)) {
+                    return FUTURE_PENDING;
+                }
+                continue;
+            }
+            ssize_t const n = splice(self->pipe[0], NULL, self->out_fd, NULL, to_out,
+                SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n > 0) {
+                self->buffered -= n;
+                self->teed -= self->tee_fd != -1 ? (size_t)n : 0;
+                self->n_forwarded += n;
+                if (!future_budget_consume()) {
+                    waker_wake(&waker);
+                    return FUTURE_PENDING;
+                }
+            } else if (n == -1 && errno == EAGAIN) {
+                if (pipe_wait(mio, self->out_fd, EPOLLOUT, out_persistent, &out_readiness, waker)) {
+                    return FUTURE_PENDING;
+                }
+            } else if (n == -1 && errno != EINTR) {
+                return splice_fail(self, mio, errno);
+            }
+            continue;
+        }
+        if (self->eof) {
+            break;
+        }
+        // The internal pipe is empty: refill it.
+        if (in_persistent && !(in_readiness.events & EPOLLIN)) {
+            if (pipe_wait(mio, self->in_fd, EPOLLIN, true, &in_readiness, waker)) {
+                return FUTURE_PENDING;
+            }
+            continue;
+        }
+        ssize_t const n = splice(self->in_fd, NULL, self->pipe[1], NULL, SPLICE_PIPE_SIZE,
+            SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n > 0) {
+            self->buffered = n;
+        } else if (n == 0) {
+            self->eof = true;
+        } else if (errno == EAGAIN) {
+            if (pipe_wait(mio, self->in_fd, EPOLLIN, in_persistent, &in_readiness, waker)) {
+                return FUTURE_PENDING;
+            }
+        } else if (errno != EINTR) {
+            return splice_fail(self, mio, errno);
+        }
+    }
+
+    splice_cleanup(self, mio);
+    self->base.ok = &self->n_forwarded;
+    return FUTURE_COMPLETED;
+}
+
+/** Cancel function for SpliceFuture */
+static void splice_cancel(Future* base, Mio* mio)
+{
+    splice_cleanup((SpliceFuture*)base, mio);
+}
+
+SpliceFuture splice_future_create(int in_fd, int out_fd, int tee_fd)
+{
+    Future base = future_create(splice_progress);
+    base.cancel = splice_cancel;
+    return (SpliceFuture) {
+        .base = base,
+        .in_fd = in_fd,
+        .out_fd = out_fd,
+        .tee_fd = tee_fd,
+        .pipe = { -1, -1 },
+        .buffered = 0,
+        .teed = 0,
+        .eof = false,
+        .n_forwarded = 0,
+        .error = 0,
+    };
+}
+
+#define SENDFILE_MAX_CHUNK 0x7ffff000 // The most sendfile() sends per call (on Linux).
+
+/** Progress function for SendfileFuture */
+static FutureState sendfile_progress(Future* base, Mio* mio, Waker waker)
+{
+    SendfileFuture* self = (SendfileFuture*)base;
+    debug("SendfileFuture %p progress. n_sent=%zu, length=%zu\n", self, self->n_sent, self->length);
+
+    MioReadiness readiness;
+    bool const persistent = mio_readiness(mio, self->out_fd, &readiness);
+
+    while (self->n_sent < self->length) {
+        if (persistent && !(readiness.events & EPOLLOUT)) {
+            if (pipe_wait(mio, self->out_fd, EPOLLOUT, persistent, &readiness, waker)) {
+                return FUTURE_PENDING;
+            }
+            continue;
+        }
+        size_t const left = self->length - self->n_sent;
+        // Advances self->offset by what it sends.
+        ssize_t const n = sendfile(self->out_fd, self->file_fd, &self->offset,
+            left < SENDFILE_MAX_CHUNK ? left : SENDFILE_MAX_CHUNK);
+        if (n > 0) {
+            self->n_sent += n;
+            if (self->n_sent < self->length && !future_budget_consume()) {
+                waker_wake(&waker);
+                return FUTURE_PENDING;
+            }
+        } else if (n == 0) {
+            mio_unregister_interest(mio, self->out_fd, EPOLLOUT);
+            self->base.errcode = SENDFILE_FUTURE_ERR_EOF;
+            return FUTURE_FAILURE;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (pipe_wait(mio, self->out_fd, EPOLLOUT, persistent, &readiness, waker)) {
+                return FUTURE_PENDING;
+            }
+        } else if (errno != EINTR) {
+            mio_unregister_interest(mio, self->out_fd, EPOLLOUT);
+            self->error = errno;
+            self->base.errcode = SENDFILE_FUTURE_ERR_IO;
+            return FUTURE_FAILURE;
+        }
+    }
+
+    mio_unregister_interest(mio, self->out_fd, EPOLLOUT);
+    self->base.ok = &self->n_sent;
+    return FUTURE_COMPLETED;
+}
+
+/** Cancel function for SendfileFuture */
+static void sendfile_cancel(Future* base, Mio* mio)
+{
+    SendfileFuture* self = (SendfileFuture*)base;
+    mio_unregister_interest(mio, self->out_fd, EPOLLOUT);
+}
+
+SendfileFuture sendfile_future_create(int file_fd, int out_fd, off_t offset, size_t length)
+{
+    Future base = future_create(sendfile_progress);
+    base.cancel = sendfile_cancel;
+    return (SendfileFuture) {
+        .base = base,
+        .file_fd = file_fd,
+        .out_fd = out_fd,
+        .offset = offset,
+        .length = length,
+        .n_sent = 0,
+        .error = 0,
+    };
+}
+
+/** Progress function for SleepFuture */
+static FutureState sleep_progress(Future* base, Mio* mio, Waker waker)
+{
+    SleepFuture* self = (SleepFuture*)base;
+    debug("SleepFuture %p progress. deadline=%lu\n", self, (unsigned long)self->deadline);
+
+    switch (atomic_load(&self->timer.state)) {
+        case TIMER_FIRED:
+            return FUTURE_COMPLETED;
+        case TIMER_IDLE:
+            if (timer_now_ms() >= self->deadline) {
+                return FUTURE_COMPLETED;
+            }
+            mio_timer_arm(mio, &self->timer, self->deadline, waker);
+            return FUTURE_PENDING;
+        default:
+            // Progressed before the timer fired: keep waiting.
+            return FUTURE_PENDING;
+    }
+}
+
+/** Cancel function for SleepFuture */
+static void sleep_cancel(Future* base, Mio* mio)
+{
+    mio_timer_cancel(mio, &((SleepFuture*)base)->timer);
+}
+
+SleepFuture sleep_until_future_create(uint64_t deadline)
+{
+    Future base = future_create(sleep_progress);
+    base.cancel = sleep_cancel;
+    return (SleepFuture) {
+        .base = base,
+        .deadline = deadline,
+        .timer = timer_entry_create(),
+    };
+}
+
+SleepFuture sleep_for_future_create(uint64_t ms)
+{
+    return sleep_until_future_create(timer_now_ms() + ms);
+}
+
+// ============================== TCP ===============================
+
+/** Applies TCP_OPTION_* to a socket. Returns 0 on success, -1 (with errno set) on failure. */
+static int tcp_set_options(int fd, unsigned options)
+{
+    if (options & TCP_OPTION_NODELAY) {
+        int one = 1;
+        if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)) == -1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int tcp_listen(struct sockaddr const* addr, socklen_t addr_len, int backlog)
+{
+    int fd = socket(addr->sa_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        return -1;
+    }
+    int one = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) == -1
+        || bind(fd, addr, addr_len) == -1 || listen(fd, backlog) == -1) {
+        int const error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
+
+/** Progress function for TcpAcceptFuture */
+static FutureState tcp_accept_progress(Future* base, Mio* mio, Waker waker)
+{
+    TcpAcceptFuture* self = (TcpAcceptFuture*)base;
+    debug("TcpAcceptFuture %p progress. listen_fd=%d\n", self, self->listen_fd);
+
+    MioReadiness readiness;
+    bool const persistent = mio_readiness(mio, self->listen_fd, &readiness);
+
+    // Take the whole backlog at once.
+    while (self->n_accepted < self->max_fds) {
+        if (persistent && !(readiness.events & EPOLLIN)) {
+            if (self->n_accepted > 0) {
+                break;
+            }
+            if (pipe_wait(mio, self->listen_fd, EPOLLIN, persistent, &readiness, waker)) {
+                return FUTURE_PENDING;
+            }
+            continue;
+        }
+        int fd = accept4(self->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd != -1 && tcp_set_options(fd, self->options) == -1) {
+            // Drop the connection, and handle the error like one of accept4().
+            int const error = errno;
+            close(fd);
+            fd = -1;
+            errno = error;
+        }
+        if (fd != -1) {
+            self->fds[self->n_accepted++] = fd;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (self->n_accepted > 0) {
+                break;
+            }
+            if (pipe_wait(mio, self->listen_fd, EPOLLIN, persistent, &readiness, waker)) {
+                return FUTURE_PENDING;
+            }
+        } else if (errno != EINTR && errno != ECONNABORTED && errno != EPROTO) {
+            if (self->n_accepted > 0) {
+                break; // Report the error on the next accept.
+            }
+            mio_unregister_interest(mio, self->listen_fd, EPOLLIN);
+            self->error = errno;
+            self->base.errcode = TCP_FUTURE_ERR_IO;
+            return FUTURE_FAILURE;
+        }
+    }
+
+    mio_unregister_interest(mio, self->listen_fd, EPOLLIN);
+    self->base.ok = self->fds;
+    return FUTURE_COMPLETED;
+}
+
+/** Cancel function for TcpAcceptFuture */
+static void tcp_accept_cancel(Future* base, Mio* mio)
+{
+    TcpAcceptFuture* self = (TcpAcceptFuture*)base;
+    mio_unregister_interest(mio, self->listen_fd, EPOLLIN);
+}
+
+TcpAcceptFuture tcp_accept_future_create(int listen_fd, int* fds, size_t max_fds, unsigned options)
+{
+    Future base = future_create(tcp_accept_progress);
+    base.cancel = tcp_accept_cancel;
+    return (TcpAcceptFuture) {
+        .base = base,
+        .listen_fd = listen_fd,
+        .fds = fds,
+        .max_fds = max_fds,
+        .n_accepted = 0,
+        .options = options,
+        .error = 0,
+    };
+}
+
+/** Fails a TcpConnectFuture with `error`, closing its socket. */
+static FutureState tcp_connect_fail(TcpConnectFuture* self, Mio* mio, int error)
+{
+    mio_unregister(mio, self->fd);
+    close(self->fd);
+    self->fd = -1;
+    self->error = error;
+    self->base.errcode = TCP_FUTURE_ERR_IO;
+    return FUTURE_FAILURE;
+}
+
+/** Progress function for TcpConnectFuture */
+static FutureState tcp_connect_progress(Future* base, Mio* mio, Waker waker)
+{
+    TcpConnectFuture* self = (TcpConnectFuture*)base;
+    debug("TcpConnectFuture %p progress. fd=%d\n", self, self->fd);
+
+    if (self->fd == -1) {
+        if (self->addr_len > sizeof(self->addr)) {
+            self->error = EINVAL; // The address did not fit, see tcp_connect_future_create().
+            self->base.errcode = TCP_FUTURE_ERR_IO;
+            return FUTURE_FAILURE;
+        }
+        self->fd = socket(self->addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (self->fd == -1) {
+            self->error = errno;
+            self->base.errcode = TCP_FUTURE_ERR_IO;
+            return FUTURE_FAILURE;
+        }
+        if (tcp_set_options(self->fd, self->options) == -1) {
+            return tcp_connect_fail(self, mio, errno);
+        }
+        if (connect(self->fd, (struct sockaddr*)&self->addr, self->addr_len) == -1) {
+            if (errno != EINPROGRESS) {
+                return tcp_connect_fail(self, mio, errno);
+            }
+            // The socket becomes writable once the handshake is over (one way or the other).
+            mio_register(mio, self->fd, EPOLLOUT, waker);
+            return FUTURE_PENDING;
+        }
+    } else {
+        int error = 0;
+        socklen_t len = sizeof(error);
+        if (getsockopt(self->fd, SOL_SOCKET, SO_ERROR, &error, &len) == -1) {
+            error = errno;
+        }
+        if (error != 0) {
+            return tcp_connect_fail(self, mio, error);
+        }
+        struct sockaddr_storage peer;
+        socklen_t peer_len = sizeof(peer);
+        if (getpeername(self->fd, (struct sockaddr*)&peer, &peer_len) == -1) {
+            // Woken before the handshake is over.
+            mio_register(mio, self->fd, EPOLLOUT, waker);
+            return FUTURE_PENDING;
+        }
+        mio_unregister_interest(mio, self->fd, EPOLLOUT);
+    }
+
+    self->base.ok = &self->fd;
+    return FUTURE_COMPLETED;
+}
+
+/** Cancel function for TcpConnectFuture */
+static void tcp_connect_cancel(Future* base, Mio* mio)
+{
+    TcpConnectFuture* self = (TcpConnectFuture*)base;
+    if (self->fd != -1) {
+        mio_unregister(mio, self->fd);
+        close(self->fd);
+        self->fd = -1;
+    }
+}
+
+TcpConnectFuture tcp_connect_future_create(
+    struct sockaddr const* addr, socklen_t addr_len, unsigned options)
+{
+    Future base = future_create(tcp_connect_progress);
+    base.cancel = tcp_connect_cancel;
+    TcpConnectFuture fut = {
+        .base = base,
+        .addr_len = addr_len,
+        .options = options,
+        .fd = -1,
+        .error = 0,
+    };
+    if (addr_len <= sizeof(fut.addr)) {
+        memcpy(&fut.addr, addr, addr_len);
+    }
+    return fut;
+}
+
+/** Progress function for TcpReadFuture */
+static FutureState tcp_read_progress(Future* base, Mio* mio, Waker waker)
+{
+    TcpReadFuture* self = (TcpReadFuture*)base;
+    debug("TcpReadFuture %p progress. n_read=%zu, min=%zu\n", self, self->n_read, self->min);
+
+    MioReadiness readiness;
+    bool const persistent = mio_readiness(mio, self->fd, &readiness);
+
+    while (self->n_read < self->min) {
+        if (persistent && !(readiness.events & EPOLLIN)) {
+            if (pipe_wait(mio, self->fd, EPOLLIN, persistent, &readiness, waker)) {
+                return FUTURE_PENDING;
+            }
+            continue;
+        }
+        ssize_t const n_read = recv(self->fd, self->buffer + self->n_read, self->n - self->n_read, 0);
+        if (n_read > 0) {
+            self->n_read += n_read;
+            if (self->n_read < self->min && !future_budget_consume()) {
+                waker_wake(&waker);
+                return FUTURE_PENDING;
+            }
+        } else if (n_read == 0) {
+            mio_unregister_interest(mio, self->fd, EPOLLIN);
+            self->base.errcode = TCP_FUTURE_ERR_EOF;
+            return FUTURE_FAILURE;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (pipe_wait(mio, self->fd, EPOLLIN, persistent, &readiness, waker)) {
+                return FUTURE_PENDING;
+            }
+        } else if (errno != EINTR) {
+            mio_unregister_interest(mio, self->fd, EPOLLIN);
+            self->error = errno;
+            self->base.errcode = TCP_FUTURE_ERR_IO;
+            return FUTURE_FAILURE;
+        }
+    }
+
+    mio_unregister_interest(mio, self->fd, EPOLLIN);
+    self->base.ok = self->buffer;
+    return FUTURE_COMPLETED;
+}
+
+/** Cancel function for TcpReadFuture */
+static void tcp_read_cancel(Future* base, Mio* mio)
+{
+    TcpReadFuture* self = (TcpReadFuture*)base;
+    mio_unregister_interest(mio, self->fd, EPOLLIN);
+}
+
+TcpReadFuture tcp_read_future_create(int fd, uint8_t* buffer, size_t n, size_t min)
+{
+    Future base = future_create(tcp_read_progress);
+    base.cancel = tcp_read_cancel;
+    return (TcpReadFuture) {
+        .base = base,
+        .fd = fd,
+        .buffer = buffer,
+        .n = n,
+        .min = n == 0 ? 0 : (min < 1 ? 1 : (min > n ? n : min)), // Nothing to wait for if n is 0.
+        .n_read = 0,
+        .error = 0,
+    };
+}
+
+/** Progress function for TcpWriteFuture */
+static FutureState tcp_write_progress(Future* base, Mio* mio, Waker waker)
+{
+    TcpWriteFuture* self = (TcpWriteFuture*)base;
+    debug("TcpWriteFuture %p progress. n_written=%zu, n=%zu\n", self, self->n_written, self->n);
+
+    MioReadiness readiness;
+    bool const persistent = mio_readiness(mio, self->fd, &readiness);
+
+    while (self->n_written < self->n) {
+        if (persistent && !(readiness.events & EPOLLOUT)) {
+            if (pipe_wait(mio, self->fd, EPOLLOUT, persistent, &readiness, waker)) {
+                return FUTURE_PENDING;
+            }
+            continue;
+        }
+        ssize_t const n_written = send(
+            self->fd, self->buffer + self->n_written, self->n - self->n_written, MSG_NOSIGNAL);
+        if (n_written >= 0) {
+            self->n_written += n_written;
+            if (self->n_written < self->n && !future_budget_consume()) {
+                waker_wake(&waker);
+                return FUTURE_PENDING;
+            }
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (pipe_wait(mio, self->fd, EPOLLOUT, persistent, &readiness, waker)) {
+                return FUTURE_PENDING;
+            }
+        } else if (errno != EINTR) {
+            mio_unregister_interest(mio, self->fd, EPOLLOUT);
+            self->error = errno;
+            self->base.errcode = TCP_FUTURE_ERR_IO;
+            return FUTURE_FAILURE;
+        }
+    }
+
+    mio_unregister_interest(mio, self->fd, EPOLLOUT);
+    self->base.ok = (void*)self->buffer;
+    return FUTURE_COMPLETED;
+}
+
+/** Cancel function for TcpWriteFuture */
+static void tcp_write_cancel(Future* base, Mio* mio)
+{
+    TcpWriteFuture* self = (TcpWriteFuture*)base;
+    mio_unregister_interest(mio, self->fd, EPOLLOUT);
+}
+
+TcpWriteFuture tcp_write_future_create(int fd, uint8_t const* buffer, size_t n)
+{
+    Future base = future_create(tcp_write_progress);
+    base.cancel = tcp_write_cancel;
+    return (TcpWriteFuture) {
+        .base = base,
+        .fd = fd,
+        .buffer = buffer,
+        .n = n,
+        .n_written = 0,
+        .error = 0,
+    };
+}
+
+// ============================== UDP ===============================
+
+int udp_bind(struct sockaddr const* addr, socklen_t addr_len)
+{
+    int fd = socket(addr->sa_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        return -1;
+    }
+    if (bind(fd, addr, addr_len) == -1) {
+        int const error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
+
+/** Progress function for UdpRecvFuture */
+static FutureState udp_recv_progress(Future* base, Mio* mio, Waker waker)
+{
+    UdpRecvFuture* self = (UdpRecvFuture*)base;
+    debug("UdpRecvFuture %p progress. fd=%d\n", self, self->fd);
+
+    MioReadiness readiness;
+    bool const persistent = mio_readiness(mio, self->fd, &readiness);
+
+    for (;;) {
+        if (persistent && !(readiness.events & EPOLLIN)) {
+            if (pipe_wait(mio, self->fd, EPOLLIN, persistent, &readiness, waker)) {
+                return FUTURE_PENDING;
+            }
+            continue;
+        }
+        // A whole batch of datagrams per syscall.
+        int const n_received = recvmmsg(self->fd, self->msgs, self->max_msgs, MSG_DONTWAIT, NULL);
+        if (n_received > 0) {
+            self->n_received = n_received;
+            break;
+        }
+        if (n_received == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (pipe_wait(mio, self->fd, EPOLLIN, persistent, &readiness, waker)) {
+                return FUTURE_PENDING;
+            }
+        } else if (n_received == -1 && errno != EINTR) {
+            mio_unregister_interest(mio, self->fd, EPOLLIN);
+            self->error = errno;
+            self->base.errcode = UDP_FUTURE_ERR_IO;
+            return FUTURE_FAILURE;
+        }
+    }
+
+    mio_unregister_interest(mio, self->fd, EPOLLIN);
+    self->base.ok = self->msgs;
+    return FUTURE_COMPLETED;
+}
+
+/** Cancel function for UdpRecvFuture */
+static void udp_recv_cancel(Future* base, Mio* mio)
+{
+    UdpRecvFuture* self = (UdpRecvFuture*)base;
+    mio_unregister_interest(mio, self->fd, EPOLLIN);
+}
+
+UdpRecvFuture udp_recv_future_create(int fd, struct mmsghdr* msgs, size_t max_msgs)
+{
+    Future base = future_create(udp_recv_progress);
+    base.cancel = udp_recv_cancel;
+    return (UdpRecvFuture) {
+        .base = base,
+        .fd = fd,
+        .msgs = msgs,
+        .max_msgs = max_msgs,
+        .n_received = 0,
+        .error = 0,
+    };
+}
+
+/** Progress function for UdpSendFuture */
+static FutureState udp_send_progress(Future* base, Mio* mio, Waker waker)
+{
+    UdpSendFuture* self = (UdpSendFuture*)base;
+    debug("UdpSendFuture %p progress. n_sent=%zu, n_msgs=%zu\n", self, self->n_sent, self->n_msgs);
+
+    MioReadiness readiness;
+    bool const persistent = mio_readiness(mio, self->fd, &readiness);
+
+    while (self->n_sent < self->n_msgs) {
+        if (persistent && !(readiness.events & EPOLLOUT)) {
+            if (pipe_wait(mio, self->fd, EPOLLOUT, persistent, &readiness, waker)) {
+                return FUTURE_PENDING;
+            }
+            continue;
+        }
+        int const n_sent = sendmmsg(
+            self->fd, self->msgs + self->n_sent, self->n_msgs - self->n_sent, MSG_DONTWAIT);
+        if (n_sent > 0) {
+            self->n_sent += n_sent;
+            if (self->n_sent < self->n_msgs && !future_budget_consume()) {
+                waker_wake(&waker);
+                return FUTURE_PENDING;
+            }
+        } else if (n_sent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (pipe_wait(mio, self->fd, EPOLLOUT, persistent, &readiness, waker)) {
+                return FUTURE_PENDING;
+            }
+        } else if (n_sent == -1 && errno != EINTR) {
+            mio_unregister_interest(mio, self->fd, EPOLLOUT);
+            self->error = errno;
+            self->base.errcode = UDP_FUTURE_ERR_IO;
+            return FUTURE_FAILURE;
+        }
+    }
+
+    mio_unregister_interest(mio, self->fd, EPOLLOUT);
+    self->base.ok = self->msgs;
+    return FUTURE_COMPLETED;
+}
+
+/** Cancel function for UdpSendFuture */
+static void udp_send_cancel(Future* base, Mio* mio)
+{
+    UdpSendFuture* self = (UdpSendFuture*)base;
+    mio_unregister_interest(mio, self->fd, EPOLLOUT);
+}
+
+UdpSendFuture udp_send_future_create(int fd, struct mmsghdr* msgs, size_t n_msgs)
+{
+    Future base = future_create(udp_send_progress);
+    base.cancel = udp_send_cancel;
+    return (UdpSendFuture) {
+        .base = base,
+        .fd = fd,
+        .msgs = msgs,
+        .n_msgs = n_msgs,
+        .n_sent = 0,
+        .error = 0,
     };
 }
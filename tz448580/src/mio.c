@@ -1,6 +1,10 @@
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
 #include <errno.h>
 
@@ -12,9 +16,34 @@
 #include "executor.h"
 #include "waker.h"
 #include "err.h"
+#include "timer_wheel.h"
+#include "uring.h"
 
-// Maximum number of events to handle per epoll_wait call.
-#define MAX_EVENTS 64
+// Number of events (or completions) whose wakers are collected under a lock before calling them.
+#define WAKE_BATCH 64
+
+// After this many polls in a row that fill less than a quarter of the events buffer, it shrinks.
+#define SHRINK_AFTER_POLLS 64
+
+// Bound on the polls that drain events without blocking after a full batch (see mio_poll()).
+#define MAX_DRAIN_POLLS 16
+
+// Token of no registration (and the index of the end of the free list).
+#define MIO_NO_TOKEN UINT32_MAX
+
+// Epoll data of the wakeup eventfd (no registration has it, as its token would be MIO_NO_TOKEN).
+#define MIO_WAKEUP_DATA UINT64_MAX
+
+// Submission entries of the io_uring (operations queued in one executor tick).
+#define MIO_URING_ENTRIES 256
+
+// User data of the io_uring completions that are not of operations (whose user data is their id).
+#define MIO_URING_EPOLL_DATA UINT64_MAX // The ring's poll of epoll_fd.
+#define MIO_URING_IGNORE_DATA (UINT64_MAX - 1) // Cancellations.
+
+// Events that wake the futures waiting to read or to write (errors and hangups wake both).
+#define MIO_READ_EVENTS (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)
+#define MIO_WRITE_EVENTS (EPOLLOUT | EPOLLHUP | EPOLLERR)
 
 // ================================= Utils ================================
 
@@ -38,13 +67,82 @@ void set_nonblocking(int fd)
 
 // ================================== Mio =================================
 
+/**
+ * A registered fd, with the wakers of the futures waiting to read from it and to write to it
+ * (so that a reader and a writer can share e.g. a socket).
+ *
+ * Its epoll events carry its token (its index in the table) and generation, so they lead
+ * straight to it, and events that were already pending when the slot got reused are ignored.
+ */
+typedef struct MioRegistration {
+    int fd; // -1 if the slot is free.
+    uint32_t generation; // Bumped whenever the slot is freed.
+    uint32_t interest; // EPOLLIN and/or EPOLLOUT, as currently armed in epoll.
+    bool in_epoll; // The fd is in epoll (possibly disarmed, after a one-shot event).
+    uint32_t next_free; // Next slot of the free list (only meaningful if the slot is free).
+    bool persistent; // Registered edge-triggered, see mio_register_persistent().
+    MioReadiness readiness; // Cached readiness (only meaningful if persistent).
+    Waker read_waker; // future == NULL if no future waits to read.
+    Waker write_waker; // future == NULL if no future waits to write.
+} MioRegistration;
+
+/**
+ * A read or write submitted to the io_uring, see mio_submit_read(). Its id is its index in the
+ * table; it is freed by the future that submitted it, once the kernel is done with its buffer.
+ */
+typedef struct MioOp {
+    int fd;
+    uint8_t opcode; // IORING_OP_READ or IORING_OP_WRITE.
+    bool polling; // Waiting for the fd to get ready before retrying (after -EAGAIN).
+    bool cancelled; // See mio_op_cancel().
+    bool done;
+    void* buffer;
+    uint32_t len;
+    int32_t result; // Bytes transferred or -errno (only meaningful if done).
+    uint32_t next_free; // Next slot of the free list (only meaningful if the slot is free).
+    Waker waker; // future == NULL if no future waits for the result.
+} MioOp;
+
 struct Mio {
     Executor* executor;
+    MioBackend backend;
     int epoll_fd;
-    struct epoll_event events[MAX_EVENTS];
+    int wakeup_fd; // Eventfd (registered in epoll) used by mio_wakeup() to interrupt mio_poll().
+    struct epoll_event* events; // Buffer for epoll_wait() (only used by the polling thread).
+    size_t cap_events; // Its size, between MIO_MIN_EVENTS and max_events.
+    size_t last_cap_events; // Its size during the last epoll_wait() (a full batch returns that many).
+    size_t n_small_polls; // Polls in a row that filled less than a quarter of the buffer.
+    atomic_size_t max_events; // See mio_set_max_events().
+
+    pthread_mutex_t reg_lock; // Protects the fields below (futures may register on any thread).
+    MioRegistration* regs; // Slab of registrations, indexed by token.
+    size_t n_regs; // Slots ever used (the free ones are on the free list).
+    size_t cap_regs;
+    uint32_t free_reg; // Head of the free list (MIO_NO_TOKEN if it is empty).
+    uint32_t* fd_tokens; // Indexed by fd: token of its registration (MIO_NO_TOKEN if none).
+    size_t n_fd_tokens;
+
+    _Atomic uint64_t n_polls; // Statistics, see MioStats.
+    _Atomic uint64_t n_events;
+    _Atomic uint64_t n_ctls;
+    _Atomic uint64_t batch_sizes[MIO_BATCH_BUCKETS];
+
+    pthread_mutex_t uring_lock; // Protects the fields below (only used with MIO_BACKEND_IO_URING).
+    Uring ring;
+    MioOp* ops; // Slab of operations, indexed by id.
+    size_t n_ops;
+    size_t cap_ops;
+    uint32_t free_op; // Head of the free list (MIO_NO_TOKEN if it is empty).
+    bool epoll_armed; // Whether the ring polls epoll_fd (which has the registrations and wakeups).
+    size_t n_uring_waiting; // Threads waiting in io_uring_enter() (see mio_submit()).
+    _Atomic uint64_t n_submitted; // Statistics, see MioStats.
+
+    pthread_mutex_t timer_lock; // Protects the fields below (timers may be armed by any thread).
+    TimerWheel timers;
+    uint64_t poll_deadline; // When the ongoing mio_poll() will time out (0 if none is ongoing).
 };
 
-Mio* mio_create(Executor* executor)
+Mio* mio_create(Executor* executor, MioBackend backend)
 {
     // Allocate memory for the Mio instance.
     Mio* mio = (Mio*) malloc(sizeof(Mio));
@@ -59,71 +157,883 @@ Mio* mio_create(Executor* executor)
         debug("mio_create (epoll_create1)");
         return NULL;
     }
+    // Create the wakeup eventfd and watch it.
+    mio->wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (mio->wakeup_fd == -1) {
+        close(mio->epoll_fd);
+        free(mio);
+        debug("mio_create (eventfd)");
+        return NULL;
+    }
+    struct epoll_event event = { .events = EPOLLIN, .data.u64 = MIO_WAKEUP_DATA };
+    if (epoll_ctl(mio->epoll_fd, EPOLL_CTL_ADD, mio->wakeup_fd, &event) == -1) {
+        close(mio->wakeup_fd);
+        close(mio->epoll_fd);
+        free(mio);
+        debug("mio_create (epoll_ctl)");
+        return NULL;
+    }
     // Save the executor.
     mio->executor = executor;
 
+    mio->events = (struct epoll_event*) malloc(MIO_MIN_EVENTS * sizeof(struct epoll_event));
+    if (!mio->events) {
+        close(mio->wakeup_fd);
+        close(mio->epoll_fd);
+        free(mio);
+        debug("mio_create (malloc)");
+        return NULL;
+    }
+    mio->cap_events = MIO_MIN_EVENTS;
+    mio->last_cap_events = MIO_MIN_EVENTS;
+    mio->n_small_polls = 0;
+    atomic_init(&mio->max_events, MIO_DEFAULT_MAX_EVENTS);
+
+    // Set up the io_uring, if asked for and supported.
+    mio->backend = MIO_BACKEND_EPOLL;
+    if (backend == MIO_BACKEND_IO_URING) {
+        if (uring_init(&mio->ring, MIO_URING_ENTRIES) == 0) {
+            mio->backend = MIO_BACKEND_IO_URING;
+        } else {
+            debug("Mio (%p): io_uring is not supported, falling back to epoll\n", mio);
+        }
+    }
+    ASSERT_ZERO(pthread_mutex_init(&mio->uring_lock, NULL));
+    mio->ops = NULL;
+    mio->n_ops = 0;
+    mio->cap_ops = 0;
+    mio->free_op = MIO_NO_TOKEN;
+    mio->epoll_armed = false;
+    mio->n_uring_waiting = 0;
+    atomic_init(&mio->n_submitted, 0);
+
+    ASSERT_ZERO(pthread_mutex_init(&mio->reg_lock, NULL));
+    mio->regs = NULL;
+    mio->n_regs = 0;
+    mio->cap_regs = 0;
+    mio->free_reg = MIO_NO_TOKEN;
+    mio->fd_tokens = NULL;
+    mio->n_fd_tokens = 0;
+    atomic_init(&mio->n_polls, 0);
+    atomic_init(&mio->n_events, 0);
+    atomic_init(&mio->n_ctls, 0);
+    for (size_t i = 0; i < MIO_BATCH_BUCKETS; i++) {
+        atomic_init(&mio->batch_sizes[i], 0);
+    }
+
+    ASSERT_ZERO(pthread_mutex_init(&mio->timer_lock, NULL));
+    timer_wheel_init(&mio->timers, timer_now_ms());
+    mio->poll_deadline = 0;
+
     return mio;
 }
 
 void mio_destroy(Mio* mio)
 {
+    if (mio->backend == MIO_BACKEND_IO_URING) {
+        uring_destroy(&mio->ring);
+    }
+    ASSERT_ZERO(pthread_mutex_destroy(&mio->uring_lock));
+    free(mio->ops);
+    free(mio->events);
+    close(mio->wakeup_fd);
     close(mio->epoll_fd);
+    ASSERT_ZERO(pthread_mutex_destroy(&mio->timer_lock));
+    ASSERT_ZERO(pthread_mutex_destroy(&mio->reg_lock));
+    free(mio->regs);
+    free(mio->fd_tokens);
     free(mio);
 }
 
+/** Returns the registration of fd, creating one (with no interest) if needed. NULL on failure. */
+static MioRegistration* mio_registration_get(Mio* mio, int fd)
+{
+    if ((size_t) fd >= mio->n_fd_tokens) {
+        // Grow the fd index to fit fd.
+        size_t n = mio->n_fd_tokens ? mio->n_fd_tokens : 64;
+        while (n <= (size_t) fd) {
+            n *= 2;
+        }
+        uint32_t* fd_tokens = (uint32_t*) realloc(mio->fd_tokens, n * sizeof(uint32_t));
+        if (!fd_tokens) {
+            debug("mio_register (realloc)");
+            return NULL;
+        }
+        for (size_t i = mio->n_fd_tokens; i < n; i++) {
+            fd_tokens[i] = MIO_NO_TOKEN;
+        }
+        mio->fd_tokens = fd_tokens;
+        mio->n_fd_tokens = n;
+    }
+    if (mio->fd_tokens[fd] != MIO_NO_TOKEN) {
+        return &mio->regs[mio->fd_tokens[fd]];
+    }
+
+    // Take a slot from the free list, or a new one.
+    uint32_t token = mio->free_reg;
+    if (token != MIO_NO_TOKEN) {
+        mio->free_reg = mio->regs[token].next_free;
+    } else {
+        if (mio->n_regs == mio->cap_regs) {
+            size_t cap = mio->cap_regs ? 2 * mio->cap_regs : 64;
+            MioRegistration* regs = (MioRegistration*) realloc(mio->regs, cap * sizeof(MioRegistration));
+            if (!regs) {
+                debug("mio_register (realloc)");
+                return NULL;
+            }
+            mio->regs = regs;
+            mio->cap_regs = cap;
+        }
+        token = mio->n_regs++;
+        mio->regs[token].generation = 0;
+    }
+    MioRegistration* reg = &mio->regs[token];
+    reg->fd = fd;
+    reg->interest = 0;
+    reg->in_epoll = false;
+    reg->next_free = MIO_NO_TOKEN;
+    reg->persistent = false;
+    reg->readiness = (MioReadiness) { .tick = 0, .events = 0 };
+    reg->read_waker = (Waker) { .executor = NULL, .future = NULL };
+    reg->write_waker = (Waker) { .executor = NULL, .future = NULL };
+    mio->fd_tokens[fd] = token;
+    return reg;
+}
+
+/** Frees the slot of a registration (that is no longer in epoll). */
+static void mio_registration_free(Mio* mio, MioRegistration* reg)
+{
+    uint32_t const token = reg - mio->regs;
+    mio->fd_tokens[reg->fd] = MIO_NO_TOKEN;
+    reg->fd = -1;
+    reg->generation++;
+    reg->next_free = mio->free_reg;
+    mio->free_reg = token;
+}
+
+/** Adds fd to epoll or modifies its registration (retrying with the other op if needed). */
+static int mio_epoll_ctl(Mio* mio, int op, int fd, struct epoll_event* event)
+{
+    // The fd may have been closed (and so dropped by epoll) and reused since it was registered.
+    if (epoll_ctl(mio->epoll_fd, op, fd, event) == -1) {
+        int const retry_op = op == EPOLL_CTL_MOD ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+        atomic_fetch_add_explicit(&mio->n_ctls, 1, memory_order_relaxed);
+        if ((errno != ENOENT && errno != EEXIST) || epoll_ctl(mio->epoll_fd, retry_op, fd, event) == -1) {
+            debug("epoll_ctl (%s)", op == EPOLL_CTL_MOD ? "EPOLL_CTL_MOD" : "EPOLL_CTL_ADD");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Brings the epoll interest in reg's fd in line with its wakers (with EPOLL_CTL_ADD, MOD or DEL),
+ * freeing the registration once nobody waits on the fd. Returns 0 on success, -1 on failure.
+ *
+ * The interest is armed one-shot: an event disarms the fd, so that a level-triggered fd whose
+ * future has not run yet is not reported again by every poll in the meantime.
+ */
+static int mio_registration_update(Mio* mio, MioRegistration* reg)
+{
+    if (reg->persistent) {
+        return 0; // Stays registered for everything until mio_unregister().
+    }
+    uint32_t const interest
+        = (reg->read_waker.future ? EPOLLIN : 0) | (reg->write_waker.future ? EPOLLOUT : 0);
+    if (interest == reg->interest && (interest || !reg->in_epoll)) {
+        if (!interest) {
+            mio_registration_free(mio, reg);
+        }
+        return 0;
+    }
+
+    int const fd = reg->fd;
+    int result = 0;
+    atomic_fetch_add_explicit(&mio->n_ctls, 1, memory_order_relaxed);
+    if (!interest) {
+        if (epoll_ctl(mio->epoll_fd, EPOLL_CTL_DEL, fd, NULL) == -1) {
+            debug("epoll_ctl (EPOLL_CTL_DEL)");
+            result = -1;
+        }
+        mio_registration_free(mio, reg);
+        return result;
+    }
+
+    struct epoll_event event;
+    event.events = interest | EPOLLONESHOT;
+    event.data.u64 = ((uint64_t) reg->generation << 32) | (uint32_t) (reg - mio->regs);
+    int const op = reg->in_epoll ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if (mio_epoll_ctl(mio, op, fd, &event) == -1) {
+        result = -1;
+    }
+    if (result == 0) {
+        reg->interest = interest;
+        reg->in_epoll = true;
+    }
+    return result;
+}
+
 int mio_register(Mio* mio, int fd, uint32_t events, Waker waker)
 {
     set_nonblocking(fd); // Sets O_NONBLOCK on fd if necessary.
-    Future* fut = waker.future;
-    debug("Registering (in Mio = %p) fd = %d\n with future %p\n", mio, fd, fut);
-    
-    // Create an epoll event structure.
-    struct epoll_event event;
-    event.events = events;
-    event.data.fd = fd;
-    event.data.ptr = (void*) fut; // Save the future in the data.ptr field.
-    // Register fd.
-    if (epoll_ctl(mio->epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
-        if (errno == EEXIST) {
-            debug("[Mio] fd already registered\n");
-            return 0;
-        }
-        debug("epoll_ctl (EPOLL_CTL_ADD)");
+    debug("Registering (in Mio = %p) fd = %d\n with future %p\n", mio, fd, waker.future);
+    if (fd < 0 || !(events & (EPOLLIN | EPOLLOUT))) {
+        debug("mio_register: bad fd or events");
         return -1;
     }
-    return 0;
+
+    ASSERT_ZERO(pthread_mutex_lock(&mio->reg_lock));
+    int result = -1;
+    MioRegistration* reg = mio_registration_get(mio, fd);
+    if (reg) {
+        Waker const old_read = reg->read_waker;
+        Waker const old_write = reg->write_waker;
+        if (events & EPOLLIN) {
+            reg->read_waker = waker;
+        }
+        if (events & EPOLLOUT) {
+            reg->write_waker = waker;
+        }
+        result = mio_registration_update(mio, reg);
+        if (result == -1) {
+            reg->read_waker = old_read;
+            reg->write_waker = old_write;
+            if (!reg->in_epoll) {
+                mio_registration_free(mio, reg);
+            }
+        }
+    }
+    ASSERT_ZERO(pthread_mutex_unlock(&mio->reg_lock));
+    return result;
+}
+
+int mio_unregister_interest(Mio* mio, int fd, uint32_t events)
+{
+    debug("Unregistering (from Mio = %p) fd = %d, events = %u\n", mio, fd, events);
+    int result = 0;
+    ASSERT_ZERO(pthread_mutex_lock(&mio->reg_lock));
+    if (fd >= 0 && (size_t) fd < mio->n_fd_tokens && mio->fd_tokens[fd] != MIO_NO_TOKEN) {
+        MioRegistration* reg = &mio->regs[mio->fd_tokens[fd]];
+        if (events & EPOLLIN) {
+            reg->read_waker.future = NULL;
+        }
+        if (events & EPOLLOUT) {
+            reg->write_waker.future = NULL;
+        }
+        result = mio_registration_update(mio, reg);
+    }
+    ASSERT_ZERO(pthread_mutex_unlock(&mio->reg_lock));
+    return result;
 }
 
 int mio_unregister(Mio* mio, int fd)
 {
     debug("Unregistering (from Mio = %p) fd = %d\n", mio, fd);
-    // Unregister.
-    if (epoll_ctl(mio->epoll_fd, EPOLL_CTL_DEL, fd, NULL) == -1) {
-        debug("epoll_ctl (EPOLL_CTL_DEL)");
+    int result = 0;
+    ASSERT_ZERO(pthread_mutex_lock(&mio->reg_lock));
+    if (fd >= 0 && (size_t) fd < mio->n_fd_tokens && mio->fd_tokens[fd] != MIO_NO_TOKEN) {
+        MioRegistration* reg = &mio->regs[mio->fd_tokens[fd]];
+        reg->persistent = false;
+        reg->read_waker.future = NULL;
+        reg->write_waker.future = NULL;
+        result = mio_registration_update(mio, reg);
+    }
+    ASSERT_ZERO(pthread_mutex_unlock(&mio->reg_lock));
+    return result;
+}
+
+int mio_register_persistent(Mio* mio, int fd)
+{
+    set_nonblocking(fd); // Sets O_NONBLOCK on fd if necessary.
+    debug("Registering persistently (in Mio = %p) fd = %d\n", mio, fd);
+    if (fd < 0) {
+        debug("mio_register_persistent: bad fd");
         return -1;
     }
-    return 0;
+
+    ASSERT_ZERO(pthread_mutex_lock(&mio->reg_lock));
+    int result = -1;
+    MioRegistration* reg = mio_registration_get(mio, fd);
+    if (reg && reg->persistent) {
+        result = 0;
+    } else if (reg) {
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.u64 = ((uint64_t) reg->generation << 32) | (uint32_t) (reg - mio->regs);
+        atomic_fetch_add_explicit(&mio->n_ctls, 1, memory_order_relaxed);
+        result = mio_epoll_ctl(mio, reg->in_epoll ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &event);
+        if (result == 0) {
+            reg->persistent = true;
+            reg->interest = EPOLLIN | EPOLLOUT;
+            reg->in_epoll = true;
+            // Nothing is known yet: let the first operations find out.
+            reg->readiness.events = EPOLLIN | EPOLLOUT;
+        } else if (!reg->in_epoll) {
+            mio_registration_free(mio, reg);
+        }
+    }
+    ASSERT_ZERO(pthread_mutex_unlock(&mio->reg_lock));
+    return result;
 }
 
-void mio_poll(Mio* mio)
+bool mio_readiness(Mio* mio, int fd, MioReadiness* readiness)
 {
-    debug("Mio (%p) polling\n", mio);
-    // Wait for events.
-    int n = epoll_wait(mio->epoll_fd, mio->events, MAX_EVENTS, -1);
+    bool persistent = false;
+    ASSERT_ZERO(pthread_mutex_lock(&mio->reg_lock));
+    if (fd >= 0 && (size_t) fd < mio->n_fd_tokens && mio->fd_tokens[fd] != MIO_NO_TOKEN) {
+        MioRegistration const* reg = &mio->regs[mio->fd_tokens[fd]];
+        persistent = reg->persistent;
+        *readiness = reg->readiness;
+    }
+    ASSERT_ZERO(pthread_mutex_unlock(&mio->reg_lock));
+    return persistent;
+}
+
+bool mio_clear_readiness(Mio* mio, int fd, MioReadiness readiness, uint32_t events, Waker waker)
+{
+    bool cleared = false;
+    ASSERT_ZERO(pthread_mutex_lock(&mio->reg_lock));
+    if (fd >= 0 && (size_t) fd < mio->n_fd_tokens && mio->fd_tokens[fd] != MIO_NO_TOKEN) {
+        MioRegistration* reg = &mio->regs[mio->fd_tokens[fd]];
+        if (reg->persistent && reg->readiness.tick == readiness.tick) {
+            // No event since the operation started, so the fd is not ready for it anymore.
+            reg->readiness.events &= ~events;
+            if (events & EPOLLIN) {
+                reg->read_waker = waker;
+            }
+            if (events & EPOLLOUT) {
+                reg->write_waker = waker;
+            }
+            cleared = true;
+        }
+    }
+    ASSERT_ZERO(pthread_mutex_unlock(&mio->reg_lock));
+    return cleared;
+}
+
+void mio_stats(Mio* mio, MioStats* stats)
+{
+    stats->n_polls = atomic_load_explicit(&mio->n_polls, memory_order_relaxed);
+    stats->n_events = atomic_load_explicit(&mio->n_events, memory_order_relaxed);
+    stats->n_ctls = atomic_load_explicit(&mio->n_ctls, memory_order_relaxed);
+    stats->n_submitted = atomic_load_explicit(&mio->n_submitted, memory_order_relaxed);
+    for (size_t i = 0; i < MIO_BATCH_BUCKETS; i++) {
+        stats->batch_sizes[i] = atomic_load_explicit(&mio->batch_sizes[i], memory_order_relaxed);
+    }
+}
+
+void mio_set_max_events(Mio* mio, size_t max_events)
+{
+    atomic_store_explicit(&mio->max_events,
+        max_events > MIO_MIN_EVENTS ? max_events : MIO_MIN_EVENTS, memory_order_relaxed);
+}
+
+MioBackend mio_backend(Mio* mio)
+{
+    return mio->backend;
+}
+
+// ============================== io_uring ===============================
+
+#ifdef MIO_HAVE_IO_URING
+
+/** Returns a free submission entry, first submitting the queued ones if there is none. */
+static struct io_uring_sqe* mio_uring_sqe(Mio* mio)
+{
+    struct io_uring_sqe* sqe = uring_get_sqe(&mio->ring);
+    if (!sqe) {
+        atomic_fetch_add_explicit(&mio->n_polls, 1, memory_order_relaxed);
+        if (uring_enter(&mio->ring, uring_pending(&mio->ring), 0, 0) == -1) {
+            syserr("io_uring_enter");
+        }
+        sqe = uring_get_sqe(&mio->ring);
+        if (!sqe) {
+            fatal("io_uring: submission queue full");
+        }
+    }
+    return sqe;
+}
+
+/** Queues (the next attempt of) an operation: the read or write itself, or a poll for its fd. */
+static void mio_uring_queue_op(Mio* mio, uint32_t id)
+{
+    MioOp* op = &mio->ops[id];
+    struct io_uring_sqe* sqe = mio_uring_sqe(mio);
+    sqe->fd = op->fd;
+    sqe->user_data = id;
+    if (op->polling) {
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->poll32_events = op->opcode == IORING_OP_READ ? POLLIN : POLLOUT;
+    } else {
+        sqe->opcode = op->opcode;
+        sqe->addr = (uint64_t) (uintptr_t) op->buffer;
+        sqe->len = op->len;
+        sqe->off = (uint64_t) -1; // At the current position (pipes and sockets have none).
+        atomic_fetch_add_explicit(&mio->n_submitted, 1, memory_order_relaxed);
+    }
+}
+
+/** Adds an operation to the table and queues it. Returns its id. */
+static int mio_submit(Mio* mio, uint8_t opcode, int fd, void* buffer, size_t n, Waker waker)
+{
+    if (mio->backend != MIO_BACKEND_IO_URING) {
+        debug("mio_submit: not an io_uring Mio");
+        return -1;
+    }
+    ASSERT_ZERO(pthread_mutex_lock(&mio->uring_lock));
+    uint32_t id = mio->free_op;
+    if (id != MIO_NO_TOKEN) {
+        mio->free_op = mio->ops[id].next_free;
+    } else {
+        if (mio->n_ops == mio->cap_ops) {
+            size_t cap = mio->cap_ops ? 2 * mio->cap_ops : 64;
+            MioOp* ops = (MioOp*) realloc(mio->ops, cap * sizeof(MioOp));
+            if (!ops) {
+                ASSERT_ZERO(pthread_mutex_unlock(&mio->uring_lock));
+                debug("mio_submit (realloc)");
+                return -1;
+            }
+            mio->ops = ops;
+            mio->cap_ops = cap;
+        }
+        id = mio->n_ops++;
+    }
+    mio->ops[id] = (MioOp) {
+        .fd = fd,
+        .opcode = opcode,
+        .polling = false,
+        .cancelled = false,
+        .done = false,
+        .buffer = buffer,
+        .len = n < UINT32_MAX ? (uint32_t) n : UINT32_MAX,
+        .result = 0,
+        .next_free = MIO_NO_TOKEN,
+        .waker = waker,
+    };
+    mio_uring_queue_op(mio, id);
+    // Submitted by the next poll; if a thread is already waiting in one, it has to come back.
+    bool const kick = mio->n_uring_waiting > 0;
+    ASSERT_ZERO(pthread_mutex_unlock(&mio->uring_lock));
+    if (kick) {
+        mio_wakeup(mio);
+    }
+    return (int) id;
+}
+
+/** Frees the slot of an operation that is done. */
+static void mio_op_free(Mio* mio, uint32_t id)
+{
+    mio->ops[id].next_free = mio->free_op;
+    mio->free_op = id;
+}
+
+/**
+ * Takes up to `max_wakers` completions from the ring (with uring_lock held), storing the wakers
+ * to call in `wakers`. Sets `*epoll_ready` if epoll_fd has become ready. Returns the number of
+ * wakers (if it is `max_wakers`, there may be more completions).
+ */
+static size_t mio_uring_reap(Mio* mio, Waker* wakers, size_t max_wakers, bool* epoll_ready)
+{
+    size_t n_wakers = 0;
+    UringCompletion completion;
+    while (n_wakers < max_wakers && uring_next_completion(&mio->ring, &completion)) {
+        if (completion.user_data == MIO_URING_EPOLL_DATA) {
+            mio->epoll_armed = false;
+            *epoll_ready = true;
+            continue;
+        }
+        if (completion.user_data == MIO_URING_IGNORE_DATA) {
+            continue;
+        }
+        uint32_t const id = (uint32_t) completion.user_data;
+        MioOp* op = &mio->ops[id];
+        if (!op->cancelled) {
+            if (completion.res == -EAGAIN && !op->polling) {
+                // Older kernels do not wait for fds with O_NONBLOCK: poll, then try again.
+                op->polling = true;
+                mio_uring_queue_op(mio, id);
+                continue;
+            }
+            if (op->polling && completion.res >= 0) {
+                op->polling = false;
+                mio_uring_queue_op(mio, id);
+                continue;
+            }
+        }
+        debug("Mio (%p) operation %u completed: %d\n", mio, id, completion.res);
+        op->done = true;
+        op->result = op->polling && op->cancelled ? -ECANCELED : completion.res;
+        if (op->waker.future) {
+            wakers[n_wakers++] = op->waker;
+        }
+    }
+    return n_wakers;
+}
+
+/**
+ * Submits the queued operations and handles the completions, waiting for some for up to
+ * `timeout` ms (forever if negative). Returns whether epoll_fd has become ready.
+ */
+static bool mio_uring_poll(Mio* mio, int timeout)
+{
+    ASSERT_ZERO(pthread_mutex_lock(&mio->uring_lock));
+    if (!mio->epoll_armed) {
+        // Registrations and wakeups still go through epoll: have the ring watch it.
+        struct io_uring_sqe* sqe = mio_uring_sqe(mio);
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = mio->epoll_fd;
+        sqe->poll32_events = POLLIN;
+        sqe->user_data = MIO_URING_EPOLL_DATA;
+        mio->epoll_armed = true;
+    }
+    unsigned const to_submit = uring_pending(&mio->ring);
+    bool const wait = timeout != 0;
+    mio->n_uring_waiting += wait;
+    ASSERT_ZERO(pthread_mutex_unlock(&mio->uring_lock));
+
+    // A single system call submits the whole tick's operations (and waits, if asked to).
+    if (to_submit > 0 || wait) {
+        atomic_fetch_add_explicit(&mio->n_polls, 1, memory_order_relaxed);
+        if (uring_enter(&mio->ring, to_submit, wait ? 1 : 0, timeout) == -1) {
+            executor_destroy(mio->executor);
+            syserr("io_uring_enter");
+        }
+    }
+    if (wait) {
+        ASSERT_ZERO(pthread_mutex_lock(&mio->uring_lock));
+        mio->n_uring_waiting--;
+        ASSERT_ZERO(pthread_mutex_unlock(&mio->uring_lock));
+    }
+
+    bool epoll_ready = false;
+    Waker wakers[2 * WAKE_BATCH];
+    size_t n_wakers;
+    do {
+        ASSERT_ZERO(pthread_mutex_lock(&mio->uring_lock));
+        n_wakers = mio_uring_reap(mio, wakers, 2 * WAKE_BATCH, &epoll_ready);
+        ASSERT_ZERO(pthread_mutex_unlock(&mio->uring_lock));
+        for (size_t i = 0; i < n_wakers; i++) {
+            waker_wake(&wakers[i]);
+        }
+    } while (n_wakers == 2 * WAKE_BATCH);
+    return epoll_ready;
+}
+
+int mio_submit_read(Mio* mio, int fd, void* buffer, size_t n, Waker waker)
+{
+    return mio_submit(mio, IORING_OP_READ, fd, buffer, n, waker);
+}
+
+int mio_submit_write(Mio* mio, int fd, void const* buffer, size_t n, Waker waker)
+{
+    return mio_submit(mio, IORING_OP_WRITE, fd, (void*) buffer, n, waker);
+}
+
+bool mio_op_poll(Mio* mio, int id, Waker waker, int* result)
+{
+    ASSERT_ZERO(pthread_mutex_lock(&mio->uring_lock));
+    MioOp* op = &mio->ops[id];
+    bool const done = op->done;
+    if (done) {
+        *result = op->result;
+        mio_op_free(mio, id);
+    } else {
+        op->waker = waker;
+    }
+    ASSERT_ZERO(pthread_mutex_unlock(&mio->uring_lock));
+    return done;
+}
+
+void mio_op_cancel(Mio* mio, int id)
+{
+    ASSERT_ZERO(pthread_mutex_lock(&mio->uring_lock));
+    MioOp* op = &mio->ops[id];
+    if (!op->done) {
+        op->cancelled = true;
+        op->waker.future = NULL;
+        struct io_uring_sqe* sqe = mio_uring_sqe(mio);
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = (uint64_t) id;
+        sqe->user_data = MIO_URING_IGNORE_DATA;
+    }
+    // The kernel may still write to the buffer until the operation completes: wait for that
+    // (whoever takes its completion from the ring).
+    while (!op->done) {
+        unsigned const to_submit = uring_pending(&mio->ring);
+        ASSERT_ZERO(pthread_mutex_unlock(&mio->uring_lock));
+        if (uring_enter(&mio->ring, to_submit, 1, 1) == -1) {
+            syserr("io_uring_enter");
+        }
+        bool epoll_ready = false; // The next poll re-arms the ring's poll of epoll_fd.
+        Waker wakers[2 * WAKE_BATCH];
+        ASSERT_ZERO(pthread_mutex_lock(&mio->uring_lock));
+        size_t const n_wakers = mio_uring_reap(mio, wakers, 2 * WAKE_BATCH, &epoll_ready);
+        ASSERT_ZERO(pthread_mutex_unlock(&mio->uring_lock));
+        for (size_t i = 0; i < n_wakers; i++) {
+            waker_wake(&wakers[i]);
+        }
+        ASSERT_ZERO(pthread_mutex_lock(&mio->uring_lock));
+        op = &mio->ops[id];
+    }
+    mio_op_free(mio, id);
+    ASSERT_ZERO(pthread_mutex_unlock(&mio->uring_lock));
+}
+
+#else // MIO_HAVE_IO_URING
+
+static bool mio_uring_poll(Mio* mio, int timeout)
+{
+    return true;
+}
+
+int mio_submit_read(Mio* mio, int fd, void* buffer, size_t n, Waker waker)
+{
+    return -1;
+}
+
+int mio_submit_write(Mio* mio, int fd, void const* buffer, size_t n, Waker waker)
+{
+    return -1;
+}
+
+bool mio_op_poll(Mio* mio, int id, Waker waker, int* result)
+{
+    fatal("mio_op_poll: no io_uring");
+}
+
+void mio_op_cancel(Mio* mio, int id)
+{
+    fatal("mio_op_cancel: no io_uring");
+}
+
+#endif // MIO_HAVE_IO_URING
+
+/**
+ * Calls epoll_wait() (with the given timeout) into the events buffer, and then adapts the buffer
+ * to the number of events returned: doubles it (up to max_events) if they filled it, or halves
+ * it (down to MIO_MIN_EVENTS) if they have filled less than a quarter of it for a while.
+ * Returns the number of events (0 if interrupted by a signal).
+ */
+static int mio_epoll_wait(Mio* mio, int timeout)
+{
+    mio->last_cap_events = mio->cap_events;
+    int n = epoll_wait(mio->epoll_fd, mio->events, (int) mio->cap_events, timeout);
+    atomic_fetch_add_explicit(&mio->n_polls, 1, memory_order_relaxed);
     if (n == -1) {
-        // Error in poll() leaves no hope.
-        executor_destroy(mio->executor);
-        fatal("epoll_wait");
+        if (errno == EINTR) {
+            // Interrupted by a signal (whose handler may have woken some futures).
+            n = 0;
+        } else {
+            // Error in poll() leaves no hope.
+            executor_destroy(mio->executor);
+            fatal("epoll_wait");
+        }
     }
-    // Handle events.
-    for (int i = 0; i < n; i++) {
-        int fd = mio->events[i].data.fd;
-        debug("Mio (%p) received event on fd = %d\n", mio, fd);
-        Future* fut = (Future*) mio->events[i].data.ptr;
-        debug("Mio (%p) waking up future %p\n", mio, fut);
-        Waker waker = { .executor = mio->executor, .future = fut };
-        waker_wake(&waker);
+    atomic_fetch_add_explicit(&mio->n_events, n, memory_order_relaxed);
+    size_t bucket = 0;
+    while (bucket < MIO_BATCH_BUCKETS - 1 && ((size_t) n >> bucket) > 0) {
+        bucket++;
+    }
+    atomic_fetch_add_explicit(&mio->batch_sizes[bucket], 1, memory_order_relaxed);
+
+    // Realloc() keeps the events, as the new size is never below n.
+    size_t const max_events = atomic_load_explicit(&mio->max_events, memory_order_relaxed);
+    size_t cap = mio->cap_events;
+    if ((size_t) n == cap && cap < max_events) {
+        cap = 2 * cap < max_events ? 2 * cap : max_events;
+        mio->n_small_polls = 0;
+    } else if (cap > max_events && (size_t) n <= max_events) {
+        cap = max_events; // The ceiling has been lowered.
+    } else if ((size_t) n < cap / 4 && cap > MIO_MIN_EVENTS) {
+        if (++mio->n_small_polls >= SHRINK_AFTER_POLLS) {
+            cap = cap / 2;
+            mio->n_small_polls = 0;
+        }
+    } else {
+        mio->n_small_polls = 0;
+    }
+    if (cap != mio->cap_events) {
+        struct epoll_event* events
+            = (struct epoll_event*) realloc(mio->events, cap * sizeof(struct epoll_event));
+        if (events) {
+            debug("Mio (%p) events buffer resized to %zu\n", mio, cap);
+            mio->events = events;
+            mio->cap_events = cap;
+        }
+    }
+    return n;
+}
+
+/** Calls the wakers of the first `n` events of the buffer. */
+static void mio_dispatch(Mio* mio, int n)
+{
+    // Look up the wakers first, and call them without holding the lock.
+    Waker wakers[2 * WAKE_BATCH];
+    for (int batch = 0; batch < n; batch += WAKE_BATCH) {
+        int const batch_end = n - batch < WAKE_BATCH ? n : batch + WAKE_BATCH;
+        int n_wakers = 0;
+        ASSERT_ZERO(pthread_mutex_lock(&mio->reg_lock));
+        for (int i = batch; i < batch_end; i++) {
+            uint64_t const data = mio->events[i].data.u64;
+            if (data == MIO_WAKEUP_DATA) {
+                // Just a wakeup: reset the eventfd counter so that the next poll can block again.
+                uint64_t count;
+                if (read(mio->wakeup_fd, &count, sizeof(count)) == -1 && errno != EAGAIN) {
+                    debug("read (wakeup eventfd)");
+                }
+                debug("Mio (%p) woken up\n", mio);
+                continue;
+            }
+            uint32_t const token = (uint32_t) data;
+            uint32_t const events = mio->events[i].events;
+            if (token >= mio->n_regs || mio->regs[token].generation != (uint32_t) (data >> 32)) {
+                continue; // The fd has been unregistered since the event was reported.
+            }
+            MioRegistration* reg = &mio->regs[token];
+            debug("Mio (%p) received events %u on fd = %d\n", mio, events, reg->fd);
+            if (reg->persistent) {
+                reg->readiness.tick++;
+                reg->readiness.events |= ((events & MIO_READ_EVENTS) ? EPOLLIN : 0)
+                    | ((events & MIO_WRITE_EVENTS) ? EPOLLOUT : 0);
+            }
+            if ((events & MIO_READ_EVENTS) && reg->read_waker.future) {
+                wakers[n_wakers++] = reg->read_waker;
+            }
+            if ((events & MIO_WRITE_EVENTS) && reg->write_waker.future) {
+                wakers[n_wakers++] = reg->write_waker;
+            }
+            if (!reg->persistent) {
+                // The one-shot event disarmed the fd and used up the wakers it woke; rearm it
+                // right away only for a waker still waiting for the other direction.
+                reg->interest = 0;
+                if (events & MIO_READ_EVENTS) {
+                    reg->read_waker.future = NULL;
+                }
+                if (events & MIO_WRITE_EVENTS) {
+                    reg->write_waker.future = NULL;
+                }
+                if (reg->read_waker.future || reg->write_waker.future) {
+                    mio_registration_update(mio, reg);
+                }
+            }
+        }
+        ASSERT_ZERO(pthread_mutex_unlock(&mio->reg_lock));
+        for (int i = 0; i < n_wakers; i++) {
+            debug("Mio (%p) waking up future %p\n", mio, wakers[i].future);
+            waker_wake(&wakers[i]);
+        }
     }
 }
 
+/** Fires the timers that are due; returns how many fired. */
+static size_t mio_fire_timers(Mio* mio)
+{
+    // As in mio_dispatch(), take the wakers out under the lock, and call them without it.
+    Waker wakers[WAKE_BATCH];
+    size_t fired = 0;
+    size_t n;
+    do {
+        ASSERT_ZERO(pthread_mutex_lock(&mio->timer_lock));
+        n = timer_wheel_advance(&mio->timers, timer_now_ms(), wakers, WAKE_BATCH);
+        ASSERT_ZERO(pthread_mutex_unlock(&mio->timer_lock));
+        for (size_t i = 0; i < n; i++) {
+            waker_wake(&wakers[i]);
+        }
+        fired += n;
+    } while (n == WAKE_BATCH);
+    return fired;
+}
 
+/** Fires due timers and handles ready events; waits for them (until the next timer) if `block`. */
+static void mio_poll_events(Mio* mio, bool block)
+{
+    debug("Mio (%p) polling\n", mio);
+    // Fire overdue timers, then sleep until the next deadline (or not at all if something fired).
+    size_t const fired = mio_fire_timers(mio);
+    int timeout = 0;
+    if (block && fired == 0) {
+        ASSERT_ZERO(pthread_mutex_lock(&mio->timer_lock));
+        uint64_t const now = timer_now_ms();
+        uint64_t const deadline = timer_wheel_next_deadline(&mio->timers);
+        timeout = -1;
+        if (deadline != UINT64_MAX) {
+            // A timer armed since the wheel was advanced may already be due.
+            uint64_t const delay = deadline > now ? deadline - now : 0;
+            timeout = delay < INT_MAX ? (int)delay : INT_MAX;
+        }
+        mio->poll_deadline = deadline;
+        ASSERT_ZERO(pthread_mutex_unlock(&mio->timer_lock));
+    }
+
+    // Wait for events (with io_uring, for completions, and for epoll_fd only if it is ready).
+    int n = 0;
+    if (mio->backend != MIO_BACKEND_IO_URING || mio_uring_poll(mio, timeout)) {
+        n = mio_epoll_wait(mio, mio->backend == MIO_BACKEND_IO_URING ? 0 : timeout);
+    }
+
+    // Fire the timers that expired while waiting.
+    ASSERT_ZERO(pthread_mutex_lock(&mio->timer_lock));
+    mio->poll_deadline = 0;
+    ASSERT_ZERO(pthread_mutex_unlock(&mio->timer_lock));
+    mio_fire_timers(mio);
+
+    mio_dispatch(mio, n);
+
+    // A full batch means that more events may be ready: take them too (into the grown buffer)
+    // before returning to the executor, so that a busy tick does not wait for them.
+    for (int drained = 0; n > 0 && (size_t) n == mio->last_cap_events && drained < MAX_DRAIN_POLLS;
+         drained++) {
+        n = mio_epoll_wait(mio, 0);
+        mio_dispatch(mio, n);
+    }
+}
+
+void mio_poll(Mio* mio)
+{
+    mio_poll_events(mio, true);
+}
+
+void mio_poll_nowait(Mio* mio)
+{
+    mio_poll_events(mio, false);
+}
+
+void mio_wakeup(Mio* mio)
+{
+    uint64_t one = 1;
+    if (write(mio->wakeup_fd, &one, sizeof(one)) == -1 && errno != EAGAIN) {
+        debug("write (wakeup eventfd)");
+    }
+}
+
+void mio_timer_arm(Mio* mio, TimerEntry* timer, uint64_t deadline, Waker waker)
+{
+    debug("Arming (in Mio = %p) timer %p for future %p at %lu\n", mio, timer, waker.future,
+        (unsigned long)deadline);
+    ASSERT_ZERO(pthread_mutex_lock(&mio->timer_lock));
+    if (atomic_load(&timer->state) == TIMER_ARMED) {
+        timer_wheel_remove(&mio->timers, timer);
+    }
+    timer->deadline = deadline;
+    timer->waker = waker;
+    atomic_store(&timer->state, TIMER_ARMED);
+    timer_wheel_insert(&mio->timers, timer);
+    // An ongoing poll has to recompute its timeout if it would oversleep this deadline.
+    if (deadline < mio->poll_deadline) {
+        mio_wakeup(mio);
+    }
+    ASSERT_ZERO(pthread_mutex_unlock(&mio->timer_lock));
+}
+
+bool mio_timer_cancel(Mio* mio, TimerEntry* timer)
+{
+    bool was_armed = false;
+    ASSERT_ZERO(pthread_mutex_lock(&mio->timer_lock));
+    if (atomic_load(&timer->state) == TIMER_ARMED) {
+        timer_wheel_remove(&mio->timers, timer);
+        atomic_store(&timer->state, TIMER_IDLE);
+        was_armed = true;
+    }
+    ASSERT_ZERO(pthread_mutex_unlock(&mio->timer_lock));
+    return was_armed;
+}
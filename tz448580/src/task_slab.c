@@ -0,0 +1,124 @@
+#include "task_slab.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "err.h"
+
+// Marks slots allocated with malloc() (too large for any class).
+#define TASK_SLAB_LARGE SIZE_MAX
+
+/** The header preceding every slot's payload. */
+typedef union SlotHeader {
+    union SlotHeader* next_free; // While free: next slot on the class's free list.
+    size_t size_class; // While allocated: index of the class (or TASK_SLAB_LARGE).
+    max_align_t align; // Keeps the payload aligned for any type.
+} SlotHeader;
+
+typedef union Chunk {
+    union Chunk* next;
+    max_align_t align;
+} Chunk;
+
+struct TaskSlab {
+    pthread_mutex_t lock; // Protects the fields below.
+    SlotHeader* free[TASK_SLAB_N_CLASSES];
+    Chunk* chunks; // All chunks ever allocated, to be freed with the slab.
+};
+
+static size_t slot_size(size_t size_class)
+{
+    return (size_t) TASK_SLAB_MIN_SLOT << size_class;
+}
+
+TaskSlab* task_slab_create(void)
+{
+    TaskSlab* slab = (TaskSlab*) malloc(sizeof(TaskSlab));
+    if (!slab) {
+        return NULL;
+    }
+    ASSERT_ZERO(pthread_mutex_init(&slab->lock, NULL));
+    for (size_t i = 0; i < TASK_SLAB_N_CLASSES; i++) {
+        slab->free[i] = NULL;
+    }
+    slab->chunks = NULL;
+    return slab;
+}
+
+/** Allocates a new chunk of slots of the given class and puts them on its free list. */
+static bool slab_grow(TaskSlab* slab, size_t size_class)
+{
+    size_t const size = slot_size(size_class);
+    Chunk* chunk = (Chunk*) malloc(sizeof(Chunk) + TASK_SLAB_SLOTS_PER_CHUNK * size);
+    if (!chunk) {
+        return false;
+    }
+    chunk->next = slab->chunks;
+    slab->chunks = chunk;
+
+    char* slots = (char*) (chunk + 1);
+    for (size_t i = TASK_SLAB_SLOTS_PER_CHUNK; i-- > 0;) {
+        SlotHeader* slot = (SlotHeader*) (slots + i * size);
+        slot->next_free = slab->free[size_class];
+        slab->free[size_class] = slot;
+    }
+    return true;
+}
+
+void* task_slab_alloc(TaskSlab* slab, size_t size)
+{
+    size_t size_class = 0;
+    while (size_class < TASK_SLAB_N_CLASSES && slot_size(size_class) < sizeof(SlotHeader) + size) {
+        size_class++;
+    }
+
+    SlotHeader* slot;
+    if (size_class == TASK_SLAB_N_CLASSES) {
+        slot = (SlotHeader*) malloc(sizeof(SlotHeader) + size);
+        if (!slot) {
+            return NULL;
+        }
+        slot->size_class = TASK_SLAB_LARGE;
+        return slot + 1;
+    }
+
+    ASSERT_ZERO(pthread_mutex_lock(&slab->lock));
+    if (!slab->free[size_class] && !slab_grow(slab, size_class)) {
+        ASSERT_ZERO(pthread_mutex_unlock(&slab->lock));
+        return NULL;
+    }
+    slot = slab->free[size_class];
+    slab->free[size_class] = slot->next_free;
+    ASSERT_ZERO(pthread_mutex_unlock(&slab->lock));
+
+    slot->size_class = size_class;
+    return slot + 1;
+}
+
+void task_slab_free(TaskSlab* slab, void* ptr)
+{
+    SlotHeader* slot = (SlotHeader*) ptr - 1;
+    size_t const size_class = slot->size_class;
+    if (size_class == TASK_SLAB_LARGE) {
+        free(slot);
+        return;
+    }
+
+    ASSERT_ZERO(pthread_mutex_lock(&slab->lock));
+    slot->next_free = slab->free[size_class];
+    slab->free[size_class] = slot;
+    ASSERT_ZERO(pthread_mutex_unlock(&slab->lock));
+}
+
+void task_slab_destroy(TaskSlab* slab)
+{
+    while (slab->chunks) {
+        Chunk* next = slab->chunks->next;
+        free(slab->chunks);
+        slab->chunks = next;
+    }
+    ASSERT_ZERO(pthread_mutex_destroy(&slab->lock));
+    free(slab);
+}
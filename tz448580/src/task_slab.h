@@ -0,0 +1,32 @@
+#ifndef TASK_SLAB_H
+#define TASK_SLAB_H
+
+#include <stddef.h>
+
+/** Slots come in TASK_SLAB_N_CLASSES size classes: TASK_SLAB_MIN_SLOT, twice that, and so on. */
+#define TASK_SLAB_N_CLASSES 6
+#define TASK_SLAB_MIN_SLOT 64
+#define TASK_SLAB_SLOTS_PER_CHUNK 64
+
+/**
+ * A size-class slab allocator for the state of futures owned by an executor.
+ *
+ * Slots are carved out of chunks of TASK_SLAB_SLOTS_PER_CHUNK slots, and freed slots go to
+ * per-class free lists; chunks are only returned to the system when the slab is destroyed.
+ * Larger requests fall back to malloc(). May be used from any thread.
+ */
+typedef struct TaskSlab TaskSlab;
+
+/** Creates an empty slab. Returns NULL on failure. */
+TaskSlab* task_slab_create(void);
+
+/** Returns a slot of at least `size` bytes (suitably aligned for any type), or NULL. */
+void* task_slab_alloc(TaskSlab* slab, size_t size);
+
+/** Returns a slot obtained from task_slab_alloc() to the slab. */
+void task_slab_free(TaskSlab* slab, void* ptr);
+
+/** Frees the slab with all of its chunks (the slots must not be used anymore). */
+void task_slab_destroy(TaskSlab* slab);
+
+#endif // TASK_SLAB_H
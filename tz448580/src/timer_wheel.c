@@ -0,0 +1,150 @@
+#include "timer_wheel.h"
+
+#include <time.h>
+
+#include "debug.h"
+
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+
+uint64_t timer_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+void timer_wheel_init(TimerWheel* wheel, uint64_t now)
+{
+    wheel->elapsed = now;
+    wheel->n_timers = 0;
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        wheel->occupied[level] = 0;
+        for (int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+            wheel->slots[level][slot] = NULL;
+        }
+    }
+}
+
+void timer_wheel_insert(TimerWheel* wheel, TimerEntry* timer)
+{
+    // Overdue timers go to the current slot, so that they fire on the next advance.
+    uint64_t deadline = timer->deadline > wheel->elapsed ? timer->deadline : wheel->elapsed;
+    if (deadline - wheel->elapsed > TIMER_WHEEL_MAX_DELAY) {
+        deadline = wheel->elapsed + TIMER_WHEEL_MAX_DELAY;
+    }
+
+    // The level is given by the highest bit in which the deadline differs from the current time:
+    // all timers on lower levels are then due before any timer on this one.
+    uint64_t masked = (wheel->elapsed ^ deadline) | SLOT_MASK;
+    if (masked > TIMER_WHEEL_MAX_DELAY) {
+        masked = TIMER_WHEEL_MAX_DELAY;
+    }
+    int level = (63 - __builtin_clzll(masked)) / TIMER_WHEEL_SLOT_BITS;
+    int slot = (deadline >> (level * TIMER_WHEEL_SLOT_BITS)) & SLOT_MASK;
+
+    timer->level = level;
+    timer->slot = slot;
+    timer->prev = NULL;
+    timer->next = wheel->slots[level][slot];
+    if (timer->next) {
+        timer->next->prev = timer;
+    }
+    wheel->slots[level][slot] = timer;
+    wheel->occupied[level] |= UINT64_C(1) << slot;
+    wheel->n_timers++;
+}
+
+void timer_wheel_remove(TimerWheel* wheel, TimerEntry* timer)
+{
+    if (timer->prev) {
+        timer->prev->next = timer->next;
+    } else {
+        wheel->slots[timer->level][timer->slot] = timer->next;
+        if (!timer->next) {
+            wheel->occupied[timer->level] &= ~(UINT64_C(1) << timer->slot);
+        }
+    }
+    if (timer->next) {
+        timer->next->prev = timer->prev;
+    }
+    timer->prev = timer->next = NULL;
+    wheel->n_timers--;
+}
+
+/** Finds the earliest non-empty slot; returns false if the wheel is empty. */
+static bool next_expiration(TimerWheel* wheel, int* level_out, int* slot_out, uint64_t* deadline_out)
+{
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        uint64_t occupied = wheel->occupied[level];
+        if (!occupied) {
+            continue;
+        }
+        int shift = level * TIMER_WHEEL_SLOT_BITS;
+        uint64_t slot_range = UINT64_C(1) << shift;
+        uint64_t level_range = slot_range << TIMER_WHEEL_SLOT_BITS;
+        int now_slot = (wheel->elapsed >> shift) & SLOT_MASK;
+
+        // First occupied slot at or after the current one (cyclically).
+        uint64_t rotated = now_slot ? (occupied >> now_slot) | (occupied << (64 - now_slot)) : occupied;
+        int slot = (__builtin_ctzll(rotated) + now_slot) & SLOT_MASK;
+
+        uint64_t deadline = (wheel->elapsed & ~(level_range - 1)) + slot * slot_range;
+        if (slot < now_slot) {
+            // Only clamped timers wrap around to the next rotation of the top level.
+            deadline += level_range;
+        }
+        *level_out = level;
+        *slot_out = slot;
+        *deadline_out = deadline;
+        return true;
+    }
+    return false;
+}
+
+uint64_t timer_wheel_next_deadline(TimerWheel* wheel)
+{
+    int level, slot;
+    uint64_t deadline;
+    if (!next_expiration(wheel, &level, &slot, &deadline)) {
+        return UINT64_MAX;
+    }
+    return deadline > wheel->elapsed ? deadline : wheel->elapsed;
+}
+
+size_t timer_wheel_advance(TimerWheel* wheel, uint64_t now, Waker* fired, size_t max_fired)
+{
+    size_t n_fired = 0;
+    bool full = false;
+    int level, slot;
+    uint64_t deadline;
+    while (!full && next_expiration(wheel, &level, &slot, &deadline) && deadline <= now) {
+        // Take the whole slot: fire what is due and move the rest to finer levels.
+        TimerEntry* timer = wheel->slots[level][slot];
+        wheel->slots[level][slot] = NULL;
+        wheel->occupied[level] &= ~(UINT64_C(1) << slot);
+        if (deadline > wheel->elapsed) {
+            wheel->elapsed = deadline;
+        }
+
+        while (timer) {
+            TimerEntry* next = timer->next;
+            wheel->n_timers--;
+            full = n_fired == max_fired;
+            if (timer->deadline <= now && !full) {
+                // Once the state is set, the owner may reuse the timer: copy the waker first.
+                fired[n_fired++] = timer->waker;
+                timer->prev = timer->next = NULL;
+                atomic_store(&timer->state, TIMER_FIRED);
+                debug("[Timer] Timer %p fired\n", timer);
+            } else {
+                // Overdue timers that did not fit go back to the current slot.
+                timer_wheel_insert(wheel, timer);
+            }
+            timer = next;
+        }
+    }
+    if (!full && now > wheel->elapsed) {
+        wheel->elapsed = now;
+    }
+    return n_fired;
+}
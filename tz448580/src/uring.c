@@ -0,0 +1,164 @@
+#include "uring.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "debug.h"
+
+#ifdef MIO_HAVE_IO_URING
+
+int uring_init(Uring* ring, unsigned entries)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int) syscall(SYS_io_uring_setup, entries, &params);
+    if (ring->fd == -1) {
+        debug("io_uring_setup");
+        return -1;
+    }
+    // Waiting with a timeout needs IORING_ENTER_EXT_ARG (Linux 5.11).
+    unsigned const needed = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+    if ((params.features & needed) != needed) {
+        debug("io_uring: missing features");
+        close(ring->fd);
+        errno = ENOSYS;
+        return -1;
+    }
+
+    // With IORING_FEAT_SINGLE_MMAP, both rings live in one mapping.
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    size_t const size = sq_size > cq_size ? sq_size : cq_size;
+    void* rings = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+        IORING_OFF_SQ_RING);
+    if (rings == MAP_FAILED) {
+        debug("mmap (io_uring rings)");
+        close(ring->fd);
+        return -1;
+    }
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        debug("mmap (io_uring sqes)");
+        munmap(rings, size);
+        close(ring->fd);
+        return -1;
+    }
+    ring->sq_ring = ring->cq_ring = rings;
+    ring->sq_ring_size = ring->cq_ring_size = size;
+
+    char* sq = ring->sq_ring;
+    ring->sq_head = (unsigned*) (sq + params.sq_off.head);
+    ring->sq_tail = (unsigned*) (sq + params.sq_off.tail);
+    ring->sq_array = (unsigned*) (sq + params.sq_off.array);
+    ring->sq_mask = *(unsigned*) (sq + params.sq_off.ring_mask);
+    ring->sq_entries = params.sq_entries;
+    char* cq = ring->cq_ring;
+    ring->cq_head = (unsigned*) (cq + params.cq_off.head);
+    ring->cq_tail = (unsigned*) (cq + params.cq_off.tail);
+    ring->cqes = (struct io_uring_cqe*) (cq + params.cq_off.cqes);
+    ring->cq_mask = *(unsigned*) (cq + params.cq_off.ring_mask);
+    return 0;
+}
+
+void uring_destroy(Uring* ring)
+{
+    munmap(ring->sqes, ring->sqes_size);
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+}
+
+struct io_uring_sqe* uring_get_sqe(Uring* ring)
+{
+    unsigned const head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    unsigned const tail = *ring->sq_tail;
+    if (tail - head >= ring->sq_entries) {
+        return NULL;
+    }
+    unsigned const index = tail & ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[index] = index;
+    // The kernel only looks at the entry once the tail moves past it, in uring_enter().
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    return sqe;
+}
+
+int uring_enter(Uring* ring, unsigned to_submit, unsigned min_complete, int timeout_ms)
+{
+    unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    void* argp = NULL;
+    size_t argsz = 0;
+    if (min_complete > 0 && timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long long) (timeout_ms % 1000) * 1000000;
+        arg.ts = (uint64_t) (uintptr_t) &ts;
+        flags |= IORING_ENTER_EXT_ARG;
+        argp = &arg;
+        argsz = sizeof(arg);
+    }
+    long n = syscall(SYS_io_uring_enter, ring->fd, to_submit, min_complete, flags, argp, argsz);
+    if (n == -1 && errno != ETIME && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+        return -1;
+    }
+    return 0;
+}
+
+unsigned uring_pending(Uring* ring)
+{
+    return *ring->sq_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+}
+
+bool uring_next_completion(Uring* ring, UringCompletion* completion)
+{
+    unsigned const head = *ring->cq_head;
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    struct io_uring_cqe const* cqe = &ring->cqes[head & ring->cq_mask];
+    completion->user_data = cqe->user_data;
+    completion->res = cqe->res;
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+#else // MIO_HAVE_IO_URING
+
+int uring_init(Uring* ring, unsigned entries)
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+void uring_destroy(Uring* ring) { }
+
+struct io_uring_sqe* uring_get_sqe(Uring* ring)
+{
+    return NULL;
+}
+
+int uring_enter(Uring* ring, unsigned to_submit, unsigned min_complete, int timeout_ms)
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+unsigned uring_pending(Uring* ring)
+{
+    return 0;
+}
+
+bool uring_next_completion(Uring* ring, UringCompletion* completion)
+{
+    return false;
+}
+
+#endif // MIO_HAVE_IO_URING
@@ -0,0 +1,75 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef MIO_HAVE_IO_URING
+#include <linux/io_uring.h>
+#else
+struct io_uring_sqe;
+#endif
+
+/**
+ * A minimal io_uring instance (set up and entered with raw system calls), used by Mio.
+ *
+ * Submission queue entries are only handed to the kernel by `uring_enter()`, so that all the
+ * operations queued in between are submitted with a single system call.
+ * Not thread-safe (Mio guards it with a lock), except that `uring_enter()` may be called by
+ * several threads at once.
+ */
+typedef struct Uring {
+    int fd;
+    void* sq_ring; // Mapped submission ring (may be the same mapping as the completion ring).
+    size_t sq_ring_size;
+    void* cq_ring; // Mapped completion ring.
+    size_t cq_ring_size;
+    struct io_uring_sqe* sqes; // Mapped submission queue entries.
+    size_t sqes_size;
+    unsigned* sq_head; // Shared with the kernel.
+    unsigned* sq_tail;
+    unsigned* sq_array;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned* cq_head; // Shared with the kernel.
+    unsigned* cq_tail;
+    struct io_uring_cqe* cqes;
+    unsigned cq_mask;
+} Uring;
+
+/** A completion: the user_data of the submitted entry and the result of its operation. */
+typedef struct UringCompletion {
+    uint64_t user_data;
+    int32_t res;
+} UringCompletion;
+
+/**
+ * Sets up an io_uring with (at least) `entries` submission entries. Returns -1 (with errno set)
+ * if io_uring is not supported by the kernel (or lacks the features Mio needs), 0 on success.
+ */
+int uring_init(Uring* ring, unsigned entries);
+
+/** Tears the io_uring down (the kernel cancels the operations still in flight). */
+void uring_destroy(Uring* ring);
+
+/**
+ * Returns a zeroed submission entry to fill in (it is queued right away, and submitted by the
+ * next `uring_enter()`), or NULL if the submission queue is full.
+ */
+struct io_uring_sqe* uring_get_sqe(Uring* ring);
+
+/** Returns the number of queued entries the kernel has not consumed yet. */
+unsigned uring_pending(Uring* ring);
+
+/**
+ * Submits (up to `to_submit` of) the queued entries, and waits until at least `min_complete`
+ * completions are ready, or `timeout_ms` milliseconds pass (if not negative).
+ * Returns -1 (with errno set) on failure.
+ */
+int uring_enter(Uring* ring, unsigned to_submit, unsigned min_complete, int timeout_ms);
+
+/** Takes the next completion from the completion queue; returns false if there is none. */
+bool uring_next_completion(Uring* ring, UringCompletion* completion);
+
+#endif // URING_H
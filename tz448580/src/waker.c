@@ -0,0 +1,105 @@
+#include "waker.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "err.h"
+
+#define WAKE_CELLS_PER_CHUNK 4096
+// Links have 26 bits for the index of a cell.
+#define WAKE_CELL_MAX_CHUNKS ((1 << 26) / WAKE_CELLS_PER_CHUNK)
+
+/**
+ * The pool of all cells: chunks are only ever added (and published before any of their cells
+ * is handed out), so a link always leads to a cell, even a stale one.
+ */
+static WakeCell* _Atomic chunks[WAKE_CELL_MAX_CHUNKS];
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER; // Protects the fields below.
+static size_t n_chunks;
+static WakeCell* free_cells;
+
+static WakeCell* wake_cell_at(uint64_t link)
+{
+    uint32_t const index = (uint32_t) (link >> 6) & ((1 << 26) - 1);
+    WakeCell* chunk = atomic_load_explicit(&chunks[index / WAKE_CELLS_PER_CHUNK], memory_order_acquire);
+    return &chunk[index % WAKE_CELLS_PER_CHUNK];
+}
+
+/** Allocates a new chunk of cells and puts them on the free list. */
+static bool pool_grow(void)
+{
+    if (n_chunks == WAKE_CELL_MAX_CHUNKS) {
+        return false;
+    }
+    WakeCell* chunk = (WakeCell*) malloc(WAKE_CELLS_PER_CHUNK * sizeof(WakeCell));
+    if (!chunk) {
+        return false;
+    }
+    for (size_t i = WAKE_CELLS_PER_CHUNK; i-- > 0;) {
+        atomic_init(&chunk[i].bits, 0);
+        atomic_init(&chunk[i].parent, 0);
+        atomic_init(&chunk[i].generation, 1);
+        chunk[i].index = (uint32_t) (n_chunks * WAKE_CELLS_PER_CHUNK + i);
+        chunk[i].next_free = free_cells;
+        free_cells = &chunk[i];
+    }
+    atomic_store_explicit(&chunks[n_chunks++], chunk, memory_order_release);
+    return true;
+}
+
+bool wake_cells_alloc(WakeCell** cells, size_t n)
+{
+    ASSERT_ZERO(pthread_mutex_lock(&pool_lock));
+    for (size_t i = 0; i < n; i++) {
+        if (!free_cells && !pool_grow()) {
+            while (i-- > 0) {
+                cells[i]->next_free = free_cells;
+                free_cells = cells[i];
+            }
+            ASSERT_ZERO(pthread_mutex_unlock(&pool_lock));
+            return false;
+        }
+        cells[i] = free_cells;
+        free_cells = free_cells->next_free;
+    }
+    ASSERT_ZERO(pthread_mutex_unlock(&pool_lock));
+
+    for (size_t i = 0; i < n; i++) {
+        atomic_store_explicit(&cells[i]->bits, 0, memory_order_relaxed);
+        atomic_store_explicit(&cells[i]->parent, 0, memory_order_relaxed);
+    }
+    return true;
+}
+
+void wake_cells_release(WakeCell* const* cells, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        // Generation 0 would make a link of 0, which means no link at all.
+        uint32_t const generation = atomic_load_explicit(&cells[i]->generation, memory_order_relaxed);
+        atomic_store(&cells[i]->generation, generation == UINT32_MAX ? 1 : generation + 1);
+    }
+    ASSERT_ZERO(pthread_mutex_lock(&pool_lock));
+    for (size_t i = 0; i < n; i++) {
+        cells[i]->next_free = free_cells;
+        free_cells = cells[i];
+    }
+    ASSERT_ZERO(pthread_mutex_unlock(&pool_lock));
+}
+
+void wake_link_set(uint64_t link)
+{
+    while (link != 0) {
+        WakeCell* cell = wake_cell_at(link);
+        uint32_t const generation = (uint32_t) (link >> 32);
+        if (atomic_load(&cell->generation) != generation) {
+            return; // The combinator has let go of the cell: nobody is interested anymore.
+        }
+        atomic_fetch_or(&cell->bits, UINT64_C(1) << (link & 63));
+        link = atomic_load(&cell->parent);
+        // If the cell was released meanwhile, the bit set above was at worst a spurious one,
+        // but the parent read may belong to the cell's next owner.
+        if (atomic_load(&cell->generation) != generation) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,158 @@
+// Required for `unistd.h` include to contain `pipe2`.
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h> // For O_NONBLOCK
+#include <stdio.h> // For printf
+#include <sys/epoll.h>
+#include <time.h> // For clock_gettime
+#include <unistd.h> // For pipe2, read, write
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "mio.h"
+#include "waker.h"
+
+#define N_PIPES 8192
+#define ROUNDS 100
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static size_t n_consumed; // Bytes read by all the readers so far.
+static size_t round_target; // Value of n_consumed at which the current round ends.
+static Waker writer_waker;
+
+/** Reads ROUNDS bytes from a persistently registered pipe, one per round. */
+typedef struct ReaderTask {
+    Future base;
+    int fd;
+    size_t rounds_left;
+} ReaderTask;
+
+static FutureState reader_progress(Future* fut, Mio* mio, Waker waker)
+{
+    ReaderTask* self = (ReaderTask*)fut;
+    MioReadiness readiness;
+    mio_readiness(mio, self->fd, &readiness);
+    while (self->rounds_left > 0) {
+        char byte;
+        if (!(readiness.events & EPOLLIN) || read(self->fd, &byte, 1) == -1) {
+            if ((readiness.events & EPOLLIN) && errno != EAGAIN) {
+                syserr("read");
+            }
+            if (mio_clear_readiness(mio, self->fd, readiness, EPOLLIN, waker)) {
+                return FUTURE_PENDING;
+            }
+            mio_readiness(mio, self->fd, &readiness);
+            continue;
+        }
+        self->rounds_left--;
+        if (++n_consumed == round_target) {
+            waker_wake(&writer_waker);
+        }
+    }
+    return FUTURE_COMPLETED;
+}
+
+/** Makes every pipe readable at once, then waits for the readers to drain them; ROUNDS times. */
+typedef struct WriterTask {
+    Future base;
+    int const* fds;
+    size_t rounds_left;
+} WriterTask;
+
+static FutureState writer_progress(Future* fut, Mio* mio, Waker waker)
+{
+    WriterTask* self = (WriterTask*)fut;
+    if (n_consumed < round_target) {
+        return FUTURE_PENDING;
+    }
+    if (self->rounds_left == 0) {
+        return FUTURE_COMPLETED;
+    }
+    self->rounds_left--;
+    writer_waker = waker;
+    round_target += N_PIPES;
+    for (size_t i = 0; i < N_PIPES; i++) {
+        ASSERT_SYS_OK(write(self->fds[i], "x", 1));
+    }
+    return FUTURE_PENDING;
+}
+
+static void bench_burst(size_t max_events)
+{
+    Executor* executor = executor_create(0);
+    Mio* mio = executor_mio(executor);
+    mio_set_max_events(mio, max_events);
+
+    static int read_fds[N_PIPES];
+    static int write_fds[N_PIPES];
+    static ReaderTask readers[N_PIPES];
+    for (size_t i = 0; i < N_PIPES; i++) {
+        int fds[2];
+        ASSERT_SYS_OK(pipe2(fds, O_NONBLOCK));
+        read_fds[i] = fds[0];
+        write_fds[i] = fds[1];
+        ASSERT_ZERO(mio_register_persistent(mio, read_fds[i]));
+        readers[i] = (ReaderTask) {
+            .base = future_create(reader_progress),
+            .fd = read_fds[i],
+            .rounds_left = ROUNDS,
+        };
+        executor_spawn(executor, &readers[i].base);
+    }
+    WriterTask writer = {
+        .base = future_create(writer_progress),
+        .fds = write_fds,
+        .rounds_left = ROUNDS,
+    };
+    executor_spawn(executor, &writer.base);
+
+    n_consumed = 0;
+    round_target = 0;
+    MioStats before;
+    mio_stats(mio, &before);
+    double start = now();
+    executor_run(executor);
+    double elapsed = now() - start;
+
+    MioStats after;
+    mio_stats(mio, &after);
+    uint64_t const polls = after.n_polls - before.n_polls;
+    uint64_t const events = after.n_events - before.n_events;
+    size_t largest = 0;
+    for (size_t i = 1; i < MIO_BATCH_BUCKETS; i++) {
+        if (after.batch_sizes[i] > 0) {
+            largest = (size_t)1 << (i - 1);
+        }
+    }
+    printf("%10zu %12.1f %12.1f %12.1f %12zu\n", max_events, elapsed / ROUNDS * 1e6,
+        (double)polls / ROUNDS, (double)events / polls, largest);
+
+    for (size_t i = 0; i < N_PIPES; i++) {
+        close(read_fds[i]);
+        close(write_fds[i]);
+    }
+    executor_destroy(executor);
+}
+
+int main()
+{
+    // N_PIPES fds get ready at once: how long it takes to get through them, and how many
+    // epoll_wait() calls it takes, with the events buffer capped at various sizes.
+    printf("%10s %12s %12s %12s %12s\n", "max_events", "us/round", "polls/round", "events/poll",
+        "largest");
+    for (int round = 0; round < 2; round++) {
+        bench_burst(MIO_MIN_EVENTS);
+        bench_burst(1024);
+        bench_burst(MIO_DEFAULT_MAX_EVENTS);
+        bench_burst(N_PIPES);
+    }
+    return 0;
+}
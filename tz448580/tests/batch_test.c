@@ -0,0 +1,216 @@
+// Required for `unistd.h` include to contain `pipe2`.
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "future_examples.h"
+#include "mio.h"
+#include "waker.h"
+
+#define N_PIPES 1000 // Far more than MIO_MIN_EVENTS.
+#define SLEEP_MS 10
+
+/** Sleeps (so that the readers get to wait on their pipes), then writes a byte to each pipe. */
+typedef struct WriteAllFuture {
+    Future base;
+    SleepFuture sleep;
+    int const* fds;
+} WriteAllFuture;
+
+static FutureState write_all_progress(Future* fut, Mio* mio, Waker waker)
+{
+    WriteAllFuture* self = (WriteAllFuture*)fut;
+    if (self->sleep.base.progress(&self->sleep.base, mio, waker) == FUTURE_PENDING) {
+        return FUTURE_PENDING;
+    }
+    for (size_t i = 0; i < N_PIPES; i++) {
+        ASSERT_SYS_OK(write(self->fds[i], "x", 1));
+    }
+    return FUTURE_COMPLETED;
+}
+
+/**
+ * Makes N_PIPES fds ready at once, and returns the largest number of events a single poll
+ * returned (rounded down to a power of two, see MioStats.batch_sizes).
+ */
+static size_t run_burst(size_t max_events)
+{
+    Executor* executor = executor_create(0);
+    mio_set_max_events(executor_mio(executor), max_events);
+
+    static int read_fds[N_PIPES];
+    static int write_fds[N_PIPES];
+    static uint8_t buffers[N_PIPES];
+    static PipeReadFuture reads[N_PIPES];
+    for (size_t i = 0; i < N_PIPES; i++) {
+        int fds[2];
+        ASSERT_SYS_OK(pipe2(fds, O_NONBLOCK));
+        read_fds[i] = fds[0];
+        write_fds[i] = fds[1];
+        reads[i] = pipe_read_future_create(read_fds[i], &buffers[i], 1);
+        executor_spawn(executor, &reads[i].base);
+    }
+    WriteAllFuture write_all = {
+        .base = future_create(write_all_progress),
+        .sleep = sleep_for_future_create(SLEEP_MS),
+        .fds = write_fds,
+    };
+    executor_spawn(executor, &write_all.base);
+    executor_run(executor);
+
+    for (size_t i = 0; i < N_PIPES; i++) {
+        assert(reads[i].base.errcode == FUTURE_SUCCESS);
+        assert(buffers[i] == 'x');
+        close(read_fds[i]);
+        close(write_fds[i]);
+    }
+
+    MioStats stats;
+    mio_stats(executor_mio(executor), &stats);
+    executor_destroy(executor);
+    size_t largest = 0;
+    for (size_t i = 1; i < MIO_BATCH_BUCKETS; i++) {
+        if (stats.batch_sizes[i] > 0) {
+            largest = (size_t)1 << (i - 1);
+        }
+    }
+    return largest;
+}
+
+/**
+ * One-shot registrations: a future that is never spawned stays inactive, so waking it only sets
+ * its bit in `cell`, which lets the test see exactly which wakers each poll woke.
+ */
+static Future idle_future;
+static WakeCell* cell;
+
+enum { READ_BIT, WRITE_BIT };
+
+static Waker bit_waker(Executor* executor, unsigned bit)
+{
+    Waker waker = { .executor = executor, .future = &idle_future, .flag = 0 };
+    return waker_for_child(waker, cell, bit);
+}
+
+/** Polls without blocking, and returns (and clears) the bits of the wakers that were woken. */
+static uint64_t poll_woken(Mio* mio)
+{
+    mio_poll_nowait(mio);
+    return atomic_exchange(&cell->bits, 0);
+}
+
+static uint64_t bit(unsigned b)
+{
+    return UINT64_C(1) << b;
+}
+
+/** An fd that stays ready wakes its waker once per registration. */
+static void test_one_wake_per_registration(Executor* executor)
+{
+    Mio* mio = executor_mio(executor);
+    int fds[2];
+    ASSERT_SYS_OK(pipe2(fds, O_NONBLOCK));
+    ASSERT_SYS_OK(write(fds[1], "x", 1));
+
+    ASSERT_ZERO(mio_register(mio, fds[0], EPOLLIN, bit_waker(executor, READ_BIT)));
+    assert(poll_woken(mio) == bit(READ_BIT));
+    // The byte is still there, but nobody registered again.
+    assert(poll_woken(mio) == 0);
+    ASSERT_ZERO(mio_register(mio, fds[0], EPOLLIN, bit_waker(executor, READ_BIT)));
+    assert(poll_woken(mio) == bit(READ_BIT));
+    assert(poll_woken(mio) == 0);
+
+    ASSERT_ZERO(mio_unregister(mio, fds[0]));
+    close(fds[0]);
+    close(fds[1]);
+}
+
+/** Waking the waker of one direction leaves the fd armed for the other one, still waiting. */
+static void test_rearm_other_direction(Executor* executor)
+{
+    Mio* mio = executor_mio(executor);
+    int fds[2];
+    ASSERT_SYS_OK(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds));
+
+    // Writable right away, but nothing to read yet.
+    ASSERT_ZERO(mio_register(mio, fds[0], EPOLLIN, bit_waker(executor, READ_BIT)));
+    ASSERT_ZERO(mio_register(mio, fds[0], EPOLLOUT, bit_waker(executor, WRITE_BIT)));
+    assert(poll_woken(mio) == bit(WRITE_BIT));
+    assert(poll_woken(mio) == 0);
+
+    ASSERT_SYS_OK(write(fds[1], "x", 1));
+    assert(poll_woken(mio) == bit(READ_BIT));
+    assert(poll_woken(mio) == 0);
+
+    ASSERT_ZERO(mio_unregister(mio, fds[0]));
+    close(fds[0]);
+    close(fds[1]);
+}
+
+/** A duplex fd that is only readable wakes the reader, and the writer keeps waiting. */
+static void test_duplex_one_side(Executor* executor)
+{
+    Mio* mio = executor_mio(executor);
+    int fds[2];
+    ASSERT_SYS_OK(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds));
+
+    // Fill the socket buffers, so that fds[0] is not writable, and give it something to read.
+    static char chunk[4096];
+    while (write(fds[0], chunk, sizeof(chunk)) > 0) { }
+    assert(errno == EAGAIN);
+    ASSERT_SYS_OK(write(fds[1], "x", 1));
+
+    ASSERT_ZERO(mio_register(mio, fds[0], EPOLLIN, bit_waker(executor, READ_BIT)));
+    ASSERT_ZERO(mio_register(mio, fds[0], EPOLLOUT, bit_waker(executor, WRITE_BIT)));
+    assert(poll_woken(mio) == bit(READ_BIT));
+    assert(poll_woken(mio) == 0);
+
+    // Draining the other end makes room, which wakes the writer (and only it).
+    while (read(fds[1], chunk, sizeof(chunk)) > 0) { }
+    assert(poll_woken(mio) == bit(WRITE_BIT));
+    assert(poll_woken(mio) == 0);
+
+    ASSERT_ZERO(mio_unregister(mio, fds[0]));
+    close(fds[0]);
+    close(fds[1]);
+}
+
+static void test_one_shot(void)
+{
+    Executor* executor = executor_create(0);
+    idle_future = future_create(NULL);
+    bool const allocated = wake_cells_alloc(&cell, 1);
+    assert(allocated);
+
+    test_one_wake_per_registration(executor);
+    test_rearm_other_direction(executor);
+    test_duplex_one_side(executor);
+
+    wake_cells_release(&cell, 1);
+    executor_destroy(executor);
+}
+
+int main()
+{
+    // With the buffer fixed at its minimum, no poll can return more.
+    size_t const fixed = run_burst(MIO_MIN_EVENTS);
+    assert(fixed == MIO_MIN_EVENTS);
+    // Otherwise it grows with the burst (while draining it).
+    size_t const grown = run_burst(MIO_DEFAULT_MAX_EVENTS);
+    assert(grown >= 256);
+
+    test_one_shot();
+
+    printf("Batch test passed\n");
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "executor.h"
+#include "future.h"
+#include "future_combinators.h"
+#include "future_examples.h"
+#include "timer_wheel.h"
+
+#define N_JOBS 4
+#define JOB_MS 300
+
+void* slow_square(void* arg)
+{
+    intptr_t number = (intptr_t)arg;
+    usleep(JOB_MS * 1000);
+    return (void*)(number * number);
+}
+
+int main()
+{
+    // Blocking jobs run in parallel on the pool, while the executor keeps progressing timers.
+    {
+        Executor* executor = executor_create(0);
+        BlockingFuture jobs[N_JOBS];
+        for (intptr_t i = 0; i < N_JOBS; i++) {
+            jobs[i] = executor_spawn_blocking(slow_square, (void*)i);
+            executor_spawn(executor, (Future*)&jobs[i]);
+        }
+        SleepFuture ticks[5];
+        for (int i = 0; i < 5; i++) {
+            ticks[i] = sleep_for_future_create(50 * (i + 1));
+            executor_spawn(executor, (Future*)&ticks[i]);
+        }
+
+        uint64_t const start = timer_now_ms();
+        executor_run(executor);
+        uint64_t const elapsed = timer_now_ms() - start;
+        printf("%d blocking jobs of %d ms took %lu ms\n", N_JOBS, JOB_MS, (unsigned long)elapsed);
+
+        assert(elapsed >= JOB_MS && elapsed < 2 * JOB_MS);
+        for (intptr_t i = 0; i < N_JOBS; i++) {
+            assert(jobs[i].base.errcode == FUTURE_SUCCESS);
+            assert((intptr_t)jobs[i].base.ok == i * i);
+            assert(atomic_load(&jobs[i].job_state) == BLOCKING_JOB_DONE);
+        }
+        executor_destroy(executor);
+    }
+
+    // The pool is bounded: with 2 threads, 4 jobs take two rounds (on a multi-threaded executor).
+    {
+        Executor* executor = executor_create_multi(2, 0);
+        executor_set_max_blocking_threads(executor, 2);
+        BlockingFuture jobs[N_JOBS];
+        for (intptr_t i = 0; i < N_JOBS; i++) {
+            jobs[i] = executor_spawn_blocking(slow_square, (void*)(i + 1));
+            executor_spawn(executor, (Future*)&jobs[i]);
+        }
+
+        uint64_t const start = timer_now_ms();
+        executor_run(executor);
+        uint64_t const elapsed = timer_now_ms() - start;
+        printf("%d blocking jobs on 2 threads took %lu ms\n", N_JOBS, (unsigned long)elapsed);
+
+        assert(elapsed >= 2 * JOB_MS && elapsed < 3 * JOB_MS);
+        for (intptr_t i = 0; i < N_JOBS; i++) {
+            assert((intptr_t)jobs[i].base.ok == (i + 1) * (i + 1));
+        }
+        executor_destroy(executor);
+    }
+
+    // A timed-out job is cancelled: a queued one never runs, a running one is detached (the
+    // executor does not wait for it, and its result is dropped).
+    {
+        Executor* executor = executor_create(0);
+        executor_set_max_blocking_threads(executor, 1);
+        BlockingFuture running = executor_spawn_blocking(slow_square, (void*)3);
+        BlockingFuture queued = executor_spawn_blocking(slow_square, (void*)4);
+        TimeoutFuture running_timeout = future_timeout((Future*)&running, timer_now_ms() + 150);
+        TimeoutFuture queued_timeout = future_timeout((Future*)&queued, timer_now_ms() + 50);
+        executor_spawn(executor, (Future*)&running_timeout);
+        executor_spawn(executor, (Future*)&queued_timeout);
+
+        uint64_t const start = timer_now_ms();
+        executor_run(executor);
+        uint64_t const elapsed = timer_now_ms() - start;
+        printf("Cancelling a running blocking job took %lu ms\n", (unsigned long)elapsed);
+
+        assert(elapsed < JOB_MS);
+        assert(running_timeout.base.errcode == TIMEOUT_FUTURE_ERR_TIMED_OUT);
+        assert(queued_timeout.base.errcode == TIMEOUT_FUTURE_ERR_TIMED_OUT);
+        assert(atomic_load(&running.job_state) == BLOCKING_JOB_NEW);
+        assert(atomic_load(&queued.job_state) == BLOCKING_JOB_NEW);
+        executor_destroy(executor); // Waits for the detached job's thread.
+        assert(running.base.ok == NULL);
+    }
+
+    printf("Blocking test passed\n");
+    return 0;
+}
@@ -0,0 +1,171 @@
+// Required for `unistd.h` include to contain `pipe2`.
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "future_combinators.h"
+#include "future_examples.h"
+#include "timer_wheel.h"
+
+#define QUIET_MS 50
+
+void* square(void* arg)
+{
+    intptr_t number = (intptr_t)arg;
+    return (void*)(number * number);
+}
+
+/**
+ * Drives `inner` to its end, then makes the pipes behind the abandoned futures readable and
+ * sleeps for a while, counting its polls: stale registrations would keep waking it.
+ */
+typedef struct QuietFuture {
+    Future base;
+    Future* inner;
+    FutureState inner_state;
+    int const* write_fds;
+    size_t n_fds;
+    SleepFuture sleep;
+    int quiet_polls;
+} QuietFuture;
+
+static FutureState quiet_progress(Future* fut, Mio* mio, Waker waker)
+{
+    QuietFuture* self = (QuietFuture*)fut;
+    if (self->inner_state == FUTURE_PENDING) {
+        self->inner_state = self->inner->progress(self->inner, mio, waker);
+        if (self->inner_state == FUTURE_PENDING) {
+            return FUTURE_PENDING;
+        }
+        for (size_t i = 0; i < self->n_fds; i++) {
+            ASSERT_SYS_OK(write(self->write_fds[i], "x", 1));
+        }
+        self->sleep = sleep_for_future_create(QUIET_MS);
+    } else {
+        self->quiet_polls++;
+    }
+    return self->sleep.base.progress(&self->sleep.base, mio, waker);
+}
+
+static QuietFuture quiet_future_create(Future* inner, int const* write_fds, size_t n_fds)
+{
+    return (QuietFuture) {
+        .base = future_create(quiet_progress),
+        .inner = inner,
+        .inner_state = FUTURE_PENDING,
+        .write_fds = write_fds,
+        .n_fds = n_fds,
+        .quiet_polls = 0,
+    };
+}
+
+static void run(Future* fut)
+{
+    Executor* executor = executor_create(0);
+    executor_spawn(executor, fut);
+    executor_run(executor);
+    executor_destroy(executor);
+}
+
+typedef struct CancelArgs {
+    Executor* executor;
+    Future* fut;
+} CancelArgs;
+
+static void* cancel_thread(void* arg)
+{
+    CancelArgs* args = arg;
+    usleep(20000);
+    executor_cancel(args->executor, args->fut);
+    return NULL;
+}
+
+int main()
+{
+    // The losing read of a select is unregistered, so its pipe does not wake anyone anymore.
+    {
+        int fds[2];
+        ASSERT_SYS_OK(pipe2(fds, O_NONBLOCK));
+        uint8_t buffer[1];
+        PipeReadFuture read = pipe_read_future_create(fds[0], buffer, 1);
+        ApplyFuture apply = apply_future_create(square);
+        apply.base.arg = (void*)3;
+        SelectFuture select = future_select(&read.base, &apply.base);
+        QuietFuture quiet = quiet_future_create(&select.base, &fds[1], 1);
+
+        run(&quiet.base);
+
+        printf("%d polls after the select\n", quiet.quiet_polls);
+        assert(quiet.inner_state == FUTURE_COMPLETED);
+        assert(select.which_completed == SELECT_COMPLETED_FUT2);
+        assert((intptr_t)select.base.ok == 9);
+        assert(quiet.quiet_polls <= 1);
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    // Cancelling a combinator (here by a timeout) cancels its pending children.
+    {
+        int fds[3][2];
+        int write_fds[3];
+        uint8_t buffers[3];
+        PipeReadFuture reads[3];
+        for (int i = 0; i < 3; i++) {
+            ASSERT_SYS_OK(pipe2(fds[i], O_NONBLOCK));
+            write_fds[i] = fds[i][1];
+            reads[i] = pipe_read_future_create(fds[i][0], &buffers[i], 1);
+        }
+        JoinFuture join = future_join(&reads[0].base, &reads[1].base);
+        ThenFuture then = future_then(&join.base, &reads[2].base);
+        TimeoutFuture timeout = future_timeout(&then.base, timer_now_ms() + 20);
+        QuietFuture quiet = quiet_future_create(&timeout.base, write_fds, 2);
+
+        run(&quiet.base);
+
+        printf("%d polls after the timeout\n", quiet.quiet_polls);
+        assert(quiet.inner_state == FUTURE_FAILURE);
+        assert(timeout.base.errcode == TIMEOUT_FUTURE_ERR_TIMED_OUT);
+        assert(quiet.quiet_polls <= 1);
+        for (int i = 0; i < 3; i++) {
+            close(fds[i][0]);
+            close(fds[i][1]);
+        }
+    }
+
+    // A spawned task can be cancelled by the executor, also from another thread.
+    for (size_t n_workers = 0; n_workers <= 4; n_workers += 4) {
+        int fds[2];
+        ASSERT_SYS_OK(pipe2(fds, O_NONBLOCK));
+        uint8_t buffer[1];
+        PipeReadFuture read = pipe_read_future_create(fds[0], buffer, 1);
+        JoinHandle handle;
+
+        Executor* executor = n_workers ? executor_create_multi(n_workers, 0) : executor_create(0);
+        bool const spawned = executor_spawn_joinable(executor, &read.base, &handle);
+        assert(spawned);
+        CancelArgs args = { .executor = executor, .fut = &read.base };
+        pthread_t canceller;
+        ASSERT_ZERO(pthread_create(&canceller, NULL, cancel_thread, &args));
+        executor_run(executor);
+        ASSERT_ZERO(pthread_join(canceller, NULL));
+        executor_destroy(executor);
+
+        assert(handle.result == FUTURE_FAILURE);
+        assert(handle.base.errcode == FUTURE_ERR_CANCELLED);
+        assert(!read.base.is_active);
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    printf("Cancel test passed\n");
+    return 0;
+}
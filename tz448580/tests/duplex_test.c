@@ -0,0 +1,70 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "future_examples.h"
+
+#define N_BYTES (1 << 20) // Much more than fits in the socket buffers.
+
+/**
+ * Sends N_BYTES each way over a socket pair, with a reader and a writer (separate tasks)
+ * sharing each socket, so that both wait on the same fd at once.
+ */
+static void run_duplex(Executor* executor)
+{
+    int fds[2];
+    ASSERT_SYS_OK(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds));
+
+    char* out[2];
+    uint8_t* in[2];
+    PipeWriteFuture writes[2];
+    PipeReadFuture reads[2];
+    for (int i = 0; i < 2; i++) {
+        out[i] = malloc(N_BYTES);
+        in[i] = malloc(N_BYTES);
+        assert(out[i] && in[i]);
+        memset(out[i], 'a' + i, N_BYTES);
+        writes[i] = pipe_write_future_create(fds[i], N_BYTES, false);
+        writes[i].base.arg = out[i];
+        reads[i] = pipe_read_future_create(fds[i], in[i], N_BYTES);
+    }
+    for (int i = 0; i < 2; i++) {
+        executor_spawn(executor, &writes[i].base);
+        executor_spawn(executor, &reads[i].base);
+    }
+    executor_run(executor);
+
+    for (int i = 0; i < 2; i++) {
+        assert(writes[i].base.errcode == FUTURE_SUCCESS);
+        assert(reads[i].base.errcode == FUTURE_SUCCESS);
+        assert(reads[i].read_so_far == N_BYTES);
+        // Each socket receives what the other one sent.
+        assert(memcmp(in[i], out[1 - i], N_BYTES) == 0);
+    }
+    for (int i = 0; i < 2; i++) {
+        free(out[i]);
+        free(in[i]);
+        close(fds[i]);
+    }
+}
+
+int main()
+{
+    Executor* executor = executor_create(0);
+    run_duplex(executor);
+    executor_destroy(executor);
+
+    executor = executor_create_multi(4, 0);
+    run_duplex(executor);
+    executor_destroy(executor);
+
+    printf("Duplex test passed\n");
+    return 0;
+}
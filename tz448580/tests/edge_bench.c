@@ -0,0 +1,160 @@
+// Required for `unistd.h` include to contain `pipe2`.
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h> // For O_NONBLOCK
+#include <stdio.h> // For printf
+#include <sys/epoll.h>
+#include <time.h> // For clock_gettime
+#include <unistd.h> // For pipe2, read, write
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "mio.h"
+#include "waker.h"
+
+#define PIPE_PAIRS 16
+#define BYTES_PER_PAIR (16 << 20)
+#define MESSAGE_SIZE 4096
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static size_t n_rw_calls; // read() and write() calls of all the tasks.
+
+typedef struct StreamTask {
+    Future base;
+    int fd;
+    uint32_t events; // EPOLLIN for the consumer, EPOLLOUT for the producer.
+    bool registered; // Whether fd is registered in Mio (if it is not persistent).
+    size_t bytes_left;
+} StreamTask;
+
+/**
+ * Waits until the task's fd is ready, like the pipe futures do: with a level-triggered
+ * registration for each wait, or by clearing the cached readiness of a persistent one.
+ * Returns false if the task should try again right away.
+ */
+static bool stream_task_wait(StreamTask* self, Mio* mio, bool persistent, MioReadiness* readiness,
+    Waker waker)
+{
+    if (!persistent) {
+        mio_register(mio, self->fd, self->events, waker);
+        self->registered = true;
+        return true;
+    }
+    if (mio_clear_readiness(mio, self->fd, *readiness, self->events, waker)) {
+        return true;
+    }
+    mio_readiness(mio, self->fd, readiness);
+    return false;
+}
+
+/**
+ * Moves data through the task's pipe end: the producer writes a message per call (yielding in
+ * between), the consumer reads whatever is available.
+ */
+static FutureState stream_task_progress(Future* fut, Mio* mio, Waker waker)
+{
+    StreamTask* self = (StreamTask*)fut;
+    static char buffer[MESSAGE_SIZE];
+
+    MioReadiness readiness;
+    bool const persistent = mio_readiness(mio, self->fd, &readiness);
+    while (self->bytes_left > 0) {
+        if (persistent && !(readiness.events & self->events)) {
+            if (stream_task_wait(self, mio, persistent, &readiness, waker)) {
+                return FUTURE_PENDING;
+            }
+            continue;
+        }
+        size_t len = self->bytes_left < MESSAGE_SIZE ? self->bytes_left : MESSAGE_SIZE;
+        ssize_t n = self->events == EPOLLIN ? read(self->fd, buffer, len)
+                                            : write(self->fd, buffer, len);
+        n_rw_calls++;
+        if (n == -1) {
+            if (errno == EAGAIN) {
+                if (stream_task_wait(self, mio, persistent, &readiness, waker)) {
+                    return FUTURE_PENDING;
+                }
+                continue;
+            }
+            syserr("read/write");
+        }
+        if (n == 0) {
+            fatal("unexpected EOF");
+        }
+        if (self->registered) {
+            mio_unregister_interest(mio, self->fd, self->events);
+            self->registered = false;
+        }
+        self->bytes_left -= n;
+        if (self->events == EPOLLOUT && self->bytes_left > 0) {
+            waker_wake(&waker);
+            return FUTURE_PENDING;
+        }
+    }
+    if (self->registered) {
+        mio_unregister_interest(mio, self->fd, self->events);
+    }
+    return FUTURE_COMPLETED;
+}
+
+static void bench_stream(bool persistent)
+{
+    Executor* executor = executor_create(0);
+    Mio* mio = executor_mio(executor);
+    StreamTask tasks[2 * PIPE_PAIRS];
+    for (size_t i = 0; i < PIPE_PAIRS; i++) {
+        int fds[2];
+        ASSERT_SYS_OK(pipe2(fds, O_NONBLOCK));
+        for (size_t j = 0; j < 2; j++) {
+            if (persistent) {
+                ASSERT_ZERO(mio_register_persistent(mio, fds[j]));
+            }
+            tasks[2 * i + j] = (StreamTask) {
+                .base = future_create(stream_task_progress),
+                .fd = fds[j],
+                .events = j == 0 ? EPOLLIN : EPOLLOUT,
+                .registered = false,
+                .bytes_left = BYTES_PER_PAIR,
+            };
+            executor_spawn(executor, &tasks[2 * i + j].base);
+        }
+    }
+
+    n_rw_calls = 0;
+    double start = now();
+    executor_run(executor);
+    double elapsed = now() - start;
+
+    MioStats stats;
+    mio_stats(mio, &stats);
+    double const mb = (double)PIPE_PAIRS * BYTES_PER_PAIR / (1 << 20);
+    printf("%-10s %8.0f %10.1f %10.1f %10.1f %10.1f\n", persistent ? "edge" : "level",
+        mb / elapsed, (double)n_rw_calls / mb, (double)stats.n_polls / mb,
+        (double)stats.n_ctls / mb, (n_rw_calls + stats.n_polls + stats.n_ctls) / mb);
+
+    for (size_t i = 0; i < 2 * PIPE_PAIRS; i++) {
+        close(tasks[i].fd);
+    }
+    executor_destroy(executor);
+}
+
+int main()
+{
+    // Syscalls per MiB streamed through pipes, with the fds registered for each wait
+    // (level-triggered) or once (edge-triggered, with cached readiness).
+    printf("%-10s %8s %10s %10s %10s %10s\n", "mode", "MiB/s", "rw/MiB", "wait/MiB", "ctl/MiB",
+        "total/MiB");
+    for (int round = 0; round < 2; round++) {
+        bench_stream(false);
+        bench_stream(true);
+    }
+    return 0;
+}
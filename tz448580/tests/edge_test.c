@@ -0,0 +1,127 @@
+// Required for `unistd.h` include to contain `pipe2`.
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "future_examples.h"
+#include "mio.h"
+
+#define N_BYTES (4 << 20) // Many times the pipe buffer, so both ends keep waiting.
+#define N_CHUNKS 64
+
+/** Reads N_BYTES in N_CHUNKS pipe reads, one after another. */
+typedef struct ChunkedReadFuture {
+    Future base;
+    int fd;
+    uint8_t* buffer;
+    size_t chunk;
+    PipeReadFuture read;
+} ChunkedReadFuture;
+
+static FutureState chunked_read_progress(Future* fut, Mio* mio, Waker waker)
+{
+    ChunkedReadFuture* self = (ChunkedReadFuture*)fut;
+    while (self->chunk < N_CHUNKS) {
+        FutureState state = self->read.base.progress(&self->read.base, mio, waker);
+        if (state != FUTURE_COMPLETED) {
+            return state;
+        }
+        if (++self->chunk < N_CHUNKS) {
+            self->read = pipe_read_future_create(
+                self->fd, self->buffer + self->chunk * (N_BYTES / N_CHUNKS), N_BYTES / N_CHUNKS);
+        }
+    }
+    return FUTURE_COMPLETED;
+}
+
+/** Streams N_BYTES through a pipe whose ends are registered once, edge-triggered. */
+static void run_stream(Executor* executor)
+{
+    Mio* mio = executor_mio(executor);
+    int fds[2];
+    ASSERT_SYS_OK(pipe2(fds, O_NONBLOCK));
+    ASSERT_ZERO(mio_register_persistent(mio, fds[0]));
+    ASSERT_ZERO(mio_register_persistent(mio, fds[1]));
+    MioStats before;
+    mio_stats(mio, &before);
+
+    char* out = malloc(N_BYTES);
+    uint8_t* in = malloc(N_BYTES);
+    assert(out && in);
+    for (size_t i = 0; i < N_BYTES; i++) {
+        out[i] = (char)(i * 7);
+    }
+    PipeWriteFuture write = pipe_write_future_create(fds[1], N_BYTES, false);
+    write.base.arg = out;
+    ChunkedReadFuture read = {
+        .base = future_create(chunked_read_progress),
+        .fd = fds[0],
+        .buffer = in,
+        .chunk = 0,
+        .read = pipe_read_future_create(fds[0], in, N_BYTES / N_CHUNKS),
+    };
+    executor_spawn(executor, &read.base);
+    executor_spawn(executor, &write.base);
+    executor_run(executor);
+
+    MioStats after;
+    mio_stats(mio, &after);
+    printf("%lu polls, %lu epoll_ctl calls\n", (unsigned long)(after.n_polls - before.n_polls),
+        (unsigned long)(after.n_ctls - before.n_ctls));
+    assert(write.base.errcode == FUTURE_SUCCESS && read.read.base.errcode == FUTURE_SUCCESS);
+    assert(memcmp(in, out, N_BYTES) == 0);
+    // The waits did not touch the registrations.
+    assert(after.n_ctls == before.n_ctls);
+    // Still registered: the readiness is cached.
+    MioReadiness readiness;
+    bool registered = mio_readiness(mio, fds[0], &readiness);
+    assert(registered);
+
+    ASSERT_ZERO(mio_unregister(mio, fds[0]));
+    ASSERT_ZERO(mio_unregister(mio, fds[1]));
+    registered = mio_readiness(mio, fds[0], &readiness);
+    assert(!registered);
+    free(out);
+    free(in);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+int main()
+{
+    Executor* executor = executor_create(0);
+    run_stream(executor);
+
+    // Once unregistered, the fds are registered for each wait again (and ready data is read).
+    int fds[2];
+    ASSERT_SYS_OK(pipe2(fds, O_NONBLOCK));
+    ASSERT_ZERO(mio_register_persistent(executor_mio(executor), fds[0]));
+    ASSERT_ZERO(mio_unregister(executor_mio(executor), fds[0]));
+    ASSERT_SYS_OK(write(fds[1], "x", 1));
+    uint8_t byte;
+    PipeReadFuture read = pipe_read_future_create(fds[0], &byte, 1);
+    executor_spawn(executor, &read.base);
+    executor_run(executor);
+    assert(read.base.errcode == FUTURE_SUCCESS && byte == 'x');
+    close(fds[0]);
+    close(fds[1]);
+    executor_destroy(executor);
+
+    executor = executor_create_multi(4, 0);
+    run_stream(executor);
+    executor_destroy(executor);
+
+    printf("Edge-triggered test passed\n");
+    return 0;
+}
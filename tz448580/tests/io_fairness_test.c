@@ -0,0 +1,164 @@
+// Required for `unistd.h` include to contain `pipe2`.
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "mio.h"
+#include "waker.h"
+
+#define N_SPINNERS 4
+#define SPIN_US 100 // Length of a single progress() call of a spinner.
+#define GIVE_UP_US 2000000 // Spinners stop on their own after that long (instead of hanging).
+#define WRITE_DELAY_US 50000
+#define MAX_LATENCY_US 50000
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+typedef struct Shared {
+    int pipe_fds[2];
+    atomic_bool stop; // Set once the byte has been read.
+    uint64_t start_us;
+    _Atomic uint64_t written_us;
+    uint64_t read_us;
+} Shared;
+
+/** A CPU-heavy future that yields after every slice of work, but never waits for anything. */
+static FutureState spinner_progress(Future* fut, Mio* mio, Waker waker)
+{
+    Shared* shared = fut->arg;
+    uint64_t const until = now_us() + SPIN_US;
+    while (now_us() < until) { }
+    if (atomic_load(&shared->stop) || now_us() - shared->start_us > GIVE_UP_US) {
+        return FUTURE_COMPLETED;
+    }
+    waker_wake(&waker);
+    return FUTURE_PENDING;
+}
+
+/** A future that waits for a byte on the pipe and records when it got it. */
+static FutureState reader_progress(Future* fut, Mio* mio, Waker waker)
+{
+    Shared* shared = fut->arg;
+    uint8_t byte;
+    if (read(shared->pipe_fds[0], &byte, 1) == 1) {
+        shared->read_us = now_us();
+        atomic_store(&shared->stop, true);
+        mio_unregister(mio, shared->pipe_fds[0]);
+        return FUTURE_COMPLETED;
+    }
+    assert(errno == EAGAIN);
+    mio_register(mio, shared->pipe_fds[0], EPOLLIN, waker);
+    return FUTURE_PENDING;
+}
+
+static void* writer_thread(void* arg)
+{
+    Shared* shared = arg;
+    usleep(WRITE_DELAY_US);
+    atomic_store(&shared->written_us, now_us());
+    ASSERT_SYS_OK(write(shared->pipe_fds[1], "x", 1));
+    return NULL;
+}
+
+/** Returns how long the byte waited in the pipe while spinners kept the executor busy. */
+static uint64_t measure_latency(Executor* executor)
+{
+    Shared shared;
+    ASSERT_SYS_OK(pipe2(shared.pipe_fds, O_NONBLOCK));
+    atomic_init(&shared.stop, false);
+    atomic_init(&shared.written_us, 0);
+    shared.read_us = 0;
+    shared.start_us = now_us();
+
+    Future spinners[N_SPINNERS];
+    for (int i = 0; i < N_SPINNERS; i++) {
+        spinners[i] = future_create(spinner_progress);
+        spinners[i].arg = &shared;
+        executor_spawn(executor, &spinners[i]);
+    }
+    Future reader = future_create(reader_progress);
+    reader.arg = &shared;
+    executor_spawn(executor, &reader);
+
+    pthread_t writer;
+    ASSERT_ZERO(pthread_create(&writer, NULL, writer_thread, &shared));
+    executor_run(executor);
+    ASSERT_ZERO(pthread_join(writer, NULL));
+
+    close(shared.pipe_fds[0]);
+    close(shared.pipe_fds[1]);
+    return shared.read_us - atomic_load(&shared.written_us);
+}
+
+typedef struct BudgetFuture {
+    Future base;
+    unsigned steps; // Steps made in the last progress() call.
+    unsigned calls;
+} BudgetFuture;
+
+/** Makes as many steps as its budget allows, twice. */
+static FutureState budget_progress(Future* fut, Mio* mio, Waker waker)
+{
+    BudgetFuture* self = (BudgetFuture*)fut;
+    self->calls++;
+    self->steps = 0;
+    while (future_budget_consume()) {
+        self->steps++;
+    }
+    if (self->calls == 2) {
+        return FUTURE_COMPLETED;
+    }
+    waker_wake(&waker);
+    return FUTURE_PENDING;
+}
+
+int main()
+{
+    // A ready pipe is noticed soon, even though the spinners always have something to do.
+    {
+        Executor* executor = executor_create(0);
+        uint64_t latency = measure_latency(executor);
+        printf("Single-threaded: ready pipe waited %lu us\n", (unsigned long)latency);
+        assert(latency < MAX_LATENCY_US);
+        executor_destroy(executor);
+    }
+    {
+        Executor* executor = executor_create_multi(2, 0);
+        uint64_t latency = measure_latency(executor);
+        printf("Multi-threaded: ready pipe waited %lu us\n", (unsigned long)latency);
+        assert(latency < MAX_LATENCY_US);
+        executor_destroy(executor);
+    }
+
+    // The task budget is refilled before every progress() call.
+    {
+        Executor* executor = executor_create(0);
+        BudgetFuture fut = { .base = future_create(budget_progress), .steps = 0, .calls = 0 };
+        executor_spawn(executor, (Future*)&fut);
+        executor_run(executor);
+        assert(fut.calls == 2);
+        assert(fut.steps == FUTURE_TASK_BUDGET);
+        assert(future_budget_remaining() == 0);
+        executor_destroy(executor);
+    }
+
+    printf("IO fairness test passed\n");
+    return 0;
+}
@@ -0,0 +1,256 @@
+// Required for `unistd.h` include to contain `pipe2`.
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "future_combinators.h"
+#include "future_examples.h"
+
+#define N_APPLIES 5000 // More than 4096, to use several words of the summary bitset.
+#define N_PIPES 300
+#define N_LATCHES 200
+
+void* square(void* arg)
+{
+    intptr_t number = (intptr_t)arg;
+    return (void*)(number * number);
+}
+
+typedef struct CountedFuture {
+    Future base;
+    Future* inner;
+    int* polls;
+} CountedFuture;
+
+/** Forwards to the inner future, counting the polls. */
+static FutureState counted_progress(Future* fut, Mio* mio, Waker waker)
+{
+    CountedFuture* self = (CountedFuture*)fut;
+    (*self->polls)++;
+    FutureState state = self->inner->progress(self->inner, mio, waker);
+    self->base.ok = self->inner->ok;
+    self->base.errcode = self->inner->errcode;
+    return state;
+}
+
+static int write_fds[N_PIPES];
+
+/** Writes a byte to every pipe, one by one. */
+static void* writer_thread(void* arg)
+{
+    for (int i = 0; i < N_PIPES; i++) {
+        if (i % 10 == 0) {
+            usleep(1000);
+        }
+        ASSERT_SYS_OK(write(write_fds[(i * 7) % N_PIPES], "x", 1));
+    }
+    return NULL;
+}
+
+/** Completes once released; until then, leaves its waker in `wakers` for the waker thread. */
+typedef struct LatchFuture {
+    Future base;
+    size_t i;
+} LatchFuture;
+
+static pthread_mutex_t latch_lock = PTHREAD_MUTEX_INITIALIZER;
+static Waker latch_wakers[N_LATCHES];
+static bool latch_released[N_LATCHES];
+static _Atomic bool latches_done;
+
+static FutureState latch_progress(Future* fut, Mio* mio, Waker waker)
+{
+    LatchFuture* self = (LatchFuture*)fut;
+    ASSERT_ZERO(pthread_mutex_lock(&latch_lock));
+    bool const released = latch_released[self->i];
+    latch_wakers[self->i] = waker;
+    ASSERT_ZERO(pthread_mutex_unlock(&latch_lock));
+    return released ? FUTURE_COMPLETED : FUTURE_PENDING;
+}
+
+/** Releases the latches one by one, waking all of them (even the completed ones) every time. */
+static void* latch_thread(void* arg)
+{
+    for (size_t round = 0; !atomic_load(&latches_done); round++) {
+        ASSERT_ZERO(pthread_mutex_lock(&latch_lock));
+        if (round < N_LATCHES) {
+            latch_released[round] = true;
+        }
+        Waker wakers[N_LATCHES];
+        for (size_t i = 0; i < N_LATCHES; i++) {
+            wakers[i] = latch_wakers[i];
+        }
+        ASSERT_ZERO(pthread_mutex_unlock(&latch_lock));
+        for (size_t i = 0; i < N_LATCHES; i++) {
+            if (wakers[i].future) {
+                waker_wake(&wakers[i]);
+            }
+        }
+    }
+    return NULL;
+}
+
+/** Runs a JoinAllFuture on the heap, and frees it as soon as it is done. */
+typedef struct OuterFuture {
+    Future base;
+    LatchFuture latches[N_LATCHES];
+    Future* futs[N_LATCHES];
+    FutureResult results[N_LATCHES];
+    JoinAllFuture* join;
+} OuterFuture;
+
+static FutureState outer_progress(Future* fut, Mio* mio, Waker waker)
+{
+    OuterFuture* self = (OuterFuture*)fut;
+    if (!self->join) {
+        self->join = malloc(sizeof(JoinAllFuture));
+        assert(self->join);
+        *self->join = future_join_all(self->futs, N_LATCHES, self->results);
+    }
+    FutureState state = self->join->base.progress(&self->join->base, mio, waker);
+    if (state == FUTURE_PENDING) {
+        return FUTURE_PENDING;
+    }
+    self->base.errcode = self->join->base.errcode;
+    free(self->join);
+    return state;
+}
+
+int main()
+{
+    // Results of all the futures are saved.
+    {
+        ApplyFuture* applies = malloc(N_APPLIES * sizeof(ApplyFuture));
+        Future** futs = malloc(N_APPLIES * sizeof(Future*));
+        FutureResult* results = malloc(N_APPLIES * sizeof(FutureResult));
+        assert(applies && futs && results);
+        for (intptr_t i = 0; i < N_APPLIES; i++) {
+            applies[i] = apply_future_create(square);
+            applies[i].base.arg = (void*)i;
+            futs[i] = &applies[i].base;
+        }
+        JoinAllFuture join = future_join_all(futs, N_APPLIES, results);
+
+        Executor* executor = executor_create(0);
+        executor_spawn(executor, (Future*)&join);
+        executor_run(executor);
+        executor_destroy(executor);
+
+        assert(join.base.errcode == FUTURE_SUCCESS);
+        assert(join.base.ok == results);
+        for (intptr_t i = 0; i < N_APPLIES; i++) {
+            assert(results[i].state == FUTURE_COMPLETED);
+            assert((intptr_t)results[i].ok == i * i);
+        }
+        free(applies);
+        free(futs);
+        free(results);
+    }
+
+    // Failures are reported per future, and the others still complete.
+    {
+        int fds[2];
+        ASSERT_SYS_OK(pipe2(fds, O_NONBLOCK));
+        close(fds[1]); // The read gets EOF.
+        uint8_t buffer[1];
+        PipeReadFuture read = pipe_read_future_create(fds[0], buffer, 1);
+        ApplyFuture apply = apply_future_create(square);
+        apply.base.arg = (void*)7;
+        Future* futs[] = { &apply.base, &read.base };
+        FutureResult results[2];
+        JoinAllFuture join = future_join_all(futs, 2, results);
+
+        Executor* executor = executor_create(0);
+        executor_spawn(executor, (Future*)&join);
+        executor_run(executor);
+        executor_destroy(executor);
+
+        assert(join.base.errcode == JOIN_ALL_FUTURE_ERR_FAILED);
+        assert(results[0].state == FUTURE_COMPLETED && (intptr_t)results[0].ok == 49);
+        assert(results[1].state == FUTURE_FAILURE && results[1].errcode == PIPE_FUTURE_ERR_EOF);
+        close(fds[0]);
+    }
+
+    // A wake only re-polls the woken future.
+    {
+        int polls = 0;
+        static uint8_t buffers[N_PIPES];
+        static PipeReadFuture reads[N_PIPES];
+        static CountedFuture counted[N_PIPES];
+        static Future* futs[N_PIPES];
+        static FutureResult results[N_PIPES];
+        for (int i = 0; i < N_PIPES; i++) {
+            int fds[2];
+            ASSERT_SYS_OK(pipe2(fds, O_NONBLOCK));
+            write_fds[i] = fds[1];
+            reads[i] = pipe_read_future_create(fds[0], &buffers[i], 1);
+            counted[i] = (CountedFuture) { .base = future_create(counted_progress),
+                .inner = &reads[i].base, .polls = &polls };
+            futs[i] = &counted[i].base;
+        }
+        JoinAllFuture join = future_join_all(futs, N_PIPES, results);
+
+        Executor* executor = executor_create(0);
+        executor_spawn(executor, (Future*)&join);
+        pthread_t writer;
+        ASSERT_ZERO(pthread_create(&writer, NULL, writer_thread, NULL));
+        executor_run(executor);
+        ASSERT_ZERO(pthread_join(writer, NULL));
+        executor_destroy(executor);
+
+        printf("%d polls for %d pipe reads\n", polls, N_PIPES);
+        assert(join.base.errcode == FUTURE_SUCCESS);
+        assert(polls <= 2 * N_PIPES);
+        for (int i = 0; i < N_PIPES; i++) {
+            assert(buffers[i] == 'x');
+            close(reads[i].fd);
+            close(write_fds[i]);
+        }
+    }
+
+    // Wakers that outlive the join (here, ones its children kept) do not touch its freed state.
+    {
+        static OuterFuture outer;
+        outer.base = future_create(outer_progress);
+        for (size_t i = 0; i < N_LATCHES; i++) {
+            outer.latches[i] = (LatchFuture) { .base = future_create(latch_progress), .i = i };
+            outer.futs[i] = &outer.latches[i].base;
+        }
+        outer.join = NULL;
+
+        Executor* executor = executor_create(0);
+        executor_spawn(executor, &outer.base);
+        pthread_t waker_thread;
+        ASSERT_ZERO(pthread_create(&waker_thread, NULL, latch_thread, NULL));
+        executor_run(executor);
+        usleep(10000); // Let the stale wakes go on for a while.
+        atomic_store(&latches_done, true);
+        ASSERT_ZERO(pthread_join(waker_thread, NULL));
+        executor_destroy(executor);
+        assert(outer.base.errcode == FUTURE_SUCCESS);
+    }
+
+    // Joining nothing completes at once.
+    {
+        JoinAllFuture join = future_join_all(NULL, 0, NULL);
+        Executor* executor = executor_create(0);
+        executor_spawn(executor, (Future*)&join);
+        executor_run(executor);
+        executor_destroy(executor);
+        assert(join.base.errcode == FUTURE_SUCCESS);
+    }
+
+    printf("Join all test passed\n");
+    return 0;
+}
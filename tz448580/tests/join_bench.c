@@ -0,0 +1,125 @@
+// Required for `unistd.h` include to contain `pipe2`.
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdio.h> // For printf
+#include <stdlib.h> // For malloc
+#include <sys/resource.h> // For setrlimit
+#include <time.h> // For clock_gettime
+#include <unistd.h> // For pipe2, write
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "future_combinators.h"
+#include "future_examples.h"
+
+#define MAX_READS 10000
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static size_t n_reads;
+static int* read_fds;
+static int* write_fds;
+static uint8_t* buffers;
+static PipeReadFuture* reads;
+
+typedef struct WriterFuture {
+    Future base;
+    size_t next;
+} WriterFuture;
+
+/** Makes one pipe readable per poll (in a scattered order), yielding in between. */
+static FutureState writer_progress(Future* fut, Mio* mio, Waker waker)
+{
+    WriterFuture* self = (WriterFuture*)fut;
+    ASSERT_SYS_OK(write(write_fds[(self->next * 7919) % n_reads], "x", 1));
+    if (++self->next == n_reads) {
+        return FUTURE_COMPLETED;
+    }
+    waker_wake(&waker);
+    return FUTURE_PENDING;
+}
+
+/** Builds a balanced tree of JoinFutures over reads[lo, hi), using joins from `*next` on. */
+static Future* build_tree(JoinFuture* joins, size_t* next, size_t lo, size_t hi)
+{
+    if (hi - lo == 1) {
+        return &reads[lo].base;
+    }
+    size_t const mid = lo + (hi - lo) / 2;
+    Future* left = build_tree(joins, next, lo, mid);
+    Future* right = build_tree(joins, next, mid, hi);
+    JoinFuture* join = &joins[(*next)++];
+    *join = future_join(left, right);
+    return &join->base;
+}
+
+/** Runs the reads joined by `root`, while a writer makes them ready; returns seconds. */
+static double run(Future* root)
+{
+    for (size_t i = 0; i < n_reads; i++) {
+        reads[i] = pipe_read_future_create(read_fds[i], &buffers[i], 1);
+    }
+    WriterFuture writer = { .base = future_create(writer_progress), .next = 0 };
+    Executor* executor = executor_create(0);
+    double const start = now();
+    executor_spawn(executor, root);
+    executor_spawn(executor, &writer.base);
+    executor_run(executor);
+    double const elapsed = now() - start;
+    executor_destroy(executor);
+    if (root->errcode != FUTURE_SUCCESS) {
+        fatal("join failed");
+    }
+    return elapsed;
+}
+
+int main()
+{
+    // Joining many pipe reads that become ready one by one: a flat join_all versus a balanced
+    // tree of binary joins. (Two fds per pipe: the count is capped by RLIMIT_NOFILE.)
+    struct rlimit limit;
+    ASSERT_SYS_OK(getrlimit(RLIMIT_NOFILE, &limit));
+    limit.rlim_cur = limit.rlim_max;
+    ASSERT_SYS_OK(setrlimit(RLIMIT_NOFILE, &limit));
+    n_reads = limit.rlim_cur / 2 - 64 < MAX_READS ? limit.rlim_cur / 2 - 64 : MAX_READS;
+
+    read_fds = malloc(n_reads * sizeof(int));
+    write_fds = malloc(n_reads * sizeof(int));
+    buffers = malloc(n_reads);
+    reads = malloc(n_reads * sizeof(PipeReadFuture));
+    Future** futs = malloc(n_reads * sizeof(Future*));
+    FutureResult* results = malloc(n_reads * sizeof(FutureResult));
+    JoinFuture* joins = malloc(n_reads * sizeof(JoinFuture));
+    if (!read_fds || !write_fds || !buffers || !reads || !futs || !results || !joins) {
+        fatal("malloc");
+    }
+    for (size_t i = 0; i < n_reads; i++) {
+        int fds[2];
+        ASSERT_SYS_OK(pipe2(fds, O_NONBLOCK));
+        read_fds[i] = fds[0];
+        write_fds[i] = fds[1];
+        futs[i] = &reads[i].base;
+    }
+
+    // The first run pays for warming up the kernel's structures, so take the best of a few.
+    double flat = 1e9, tree = 1e9;
+    for (int rep = 0; rep < 3; rep++) {
+        JoinAllFuture join_all = future_join_all(futs, n_reads, results);
+        double const t = run(&join_all.base);
+        flat = t < flat ? t : flat;
+        size_t next = 0;
+        double const u = run(build_tree(joins, &next, 0, n_reads));
+        tree = u < tree ? u : tree;
+    }
+
+    printf("%zu pipe reads: join_all %7.2f ms (%5.2f us/read), nested join %7.2f ms (%5.2f us/read)\n",
+        n_reads, flat * 1e3, flat * 1e6 / n_reads, tree * 1e3, tree * 1e6 / n_reads);
+    return 0;
+}
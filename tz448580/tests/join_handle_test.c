@@ -0,0 +1,131 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "executor.h"
+#include "future.h"
+#include "future_combinators.h"
+#include "future_examples.h"
+#include "timer_wheel.h"
+#include "waker.h"
+
+#define N_TASKS 100
+
+typedef struct SquareFuture {
+    Future base;
+    intptr_t number;
+    int yields_left;
+} SquareFuture;
+
+/** Yields `number` times, then completes with the square of its number (or fails if it is odd). */
+static FutureState square_progress(Future* fut, Mio* mio, Waker waker)
+{
+    SquareFuture* self = (SquareFuture*)fut;
+    if (self->yields_left-- > 0) {
+        waker_wake(&waker);
+        return FUTURE_PENDING;
+    }
+    if (self->number % 2) {
+        self->base.errcode = (int)self->number;
+        return FUTURE_FAILURE;
+    }
+    self->base.ok = (void*)(self->number * self->number);
+    return FUTURE_COMPLETED;
+}
+
+typedef struct CollectFuture {
+    Future base;
+    JoinHandle* handles;
+    size_t next; // Index of the handle awaited now.
+    intptr_t sum; // Of the results of even tasks.
+    int errors; // Sum of the error codes of odd tasks.
+    int polls;
+} CollectFuture;
+
+/** Awaits the handles one by one. */
+static FutureState collect_progress(Future* fut, Mio* mio, Waker waker)
+{
+    CollectFuture* self = (CollectFuture*)fut;
+    self->polls++;
+    for (; self->next < N_TASKS; self->next++) {
+        Future* handle = &self->handles[self->next].base;
+        FutureState state = handle->progress(handle, mio, waker);
+        if (state == FUTURE_PENDING) {
+            return FUTURE_PENDING;
+        } else if (state == FUTURE_COMPLETED) {
+            self->sum += (intptr_t)handle->ok;
+        } else {
+            self->errors += handle->errcode;
+        }
+    }
+    return FUTURE_COMPLETED;
+}
+
+static void collect(Executor* executor, bool owned)
+{
+    static SquareFuture tasks[N_TASKS];
+    static JoinHandle handles[N_TASKS];
+    intptr_t expected_sum = 0;
+    int expected_errors = 0;
+    for (intptr_t i = 0; i < N_TASKS; i++) {
+        tasks[i] = (SquareFuture) { .base = future_create(square_progress), .number = i,
+            .yields_left = (int)i };
+        bool const spawned = owned
+            ? executor_spawn_owned(executor, (Future*)&tasks[i], sizeof(tasks[i]), &handles[i]) != NULL
+            : executor_spawn_joinable(executor, (Future*)&tasks[i], &handles[i]);
+        assert(spawned);
+        if (i % 2) {
+            expected_errors += i;
+        } else {
+            expected_sum += i * i;
+        }
+    }
+    CollectFuture collector = { .base = future_create(collect_progress), .handles = handles };
+    executor_spawn(executor, (Future*)&collector);
+    executor_run(executor);
+
+    assert(collector.sum == expected_sum);
+    assert(collector.errors == expected_errors);
+    // The collector is only polled when the awaited task completes, not on every task's wake
+    // (give or take a few polls while a result is handed over on another thread).
+    printf("Collector polled %d times for %d tasks\n", collector.polls, N_TASKS);
+    assert(collector.polls <= 2 * N_TASKS + 1);
+}
+
+int main()
+{
+    // Results of separately spawned tasks are collected through their handles.
+    {
+        Executor* executor = executor_create(0);
+        collect(executor, false);
+        collect(executor, true);
+        executor_destroy(executor);
+    }
+    {
+        Executor* executor = executor_create_multi(4, 0);
+        collect(executor, false);
+        collect(executor, true);
+        executor_destroy(executor);
+    }
+
+    // An abandoned handle is detached: the task still completes, but nothing touches the handle.
+    {
+        Executor* executor = executor_create(0);
+        SleepFuture sleep = sleep_for_future_create(200);
+        JoinHandle handle;
+        bool const spawned = executor_spawn_joinable(executor, (Future*)&sleep, &handle);
+        assert(spawned);
+        TimeoutFuture timeout = future_timeout((Future*)&handle, timer_now_ms() + 50);
+        executor_spawn(executor, (Future*)&timeout);
+        executor_run(executor);
+
+        assert(timeout.base.errcode == TIMEOUT_FUTURE_ERR_TIMED_OUT);
+        assert(atomic_load(&handle.join_state) == JOIN_DETACHED);
+        assert(!sleep.base.is_active);
+        executor_destroy(executor);
+    }
+
+    printf("Join handle test passed\n");
+    return 0;
+}
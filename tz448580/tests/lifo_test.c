@@ -0,0 +1,119 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "executor.h"
+#include "future.h"
+#include "waker.h"
+
+#define MAX_ROUNDS 1000000
+
+typedef struct PingPongFuture {
+    Future base;
+    struct PingPongFuture* peer;
+    Waker waker;
+    bool has_waker;
+    int* rounds;
+    bool* stop;
+} PingPongFuture;
+
+/** Wakes the peer (which wakes us back), until stopped. */
+static FutureState ping_pong_progress(Future* fut, Mio* mio, Waker waker)
+{
+    PingPongFuture* self = (PingPongFuture*)fut;
+    self->waker = waker;
+    self->has_waker = true;
+    if (*self->stop || ++*self->rounds == MAX_ROUNDS) {
+        if (self->peer->has_waker) {
+            waker_wake(&self->peer->waker); // Let the peer see the stop, too.
+        }
+        return FUTURE_COMPLETED;
+    }
+    if (self->peer->has_waker) {
+        waker_wake(&self->peer->waker);
+    }
+    return FUTURE_PENDING;
+}
+
+typedef struct LogFuture {
+    Future base;
+    int id;
+    int* log;
+    int* log_len;
+    Waker waker;
+    struct LogFuture* to_wake; // Woken on the first run, if set.
+    bool has_run;
+} LogFuture;
+
+/** Logs its id; the one to be woken stays pending until then. */
+static FutureState log_progress(Future* fut, Mio* mio, Waker waker)
+{
+    LogFuture* self = (LogFuture*)fut;
+    self->log[(*self->log_len)++] = self->id;
+    if (self->to_wake) {
+        waker_wake(&self->to_wake->waker);
+    }
+    if (self->id == 0 && !self->has_run) {
+        self->has_run = true;
+        self->waker = waker;
+        return FUTURE_PENDING;
+    }
+    return FUTURE_COMPLETED;
+}
+
+static FutureState stopper_progress(Future* fut, Mio* mio, Waker waker)
+{
+    *(bool*)fut->arg = true;
+    return FUTURE_COMPLETED;
+}
+
+int main()
+{
+    // A future woken by the running one runs next (only) when the LIFO slot is enabled.
+    for (int lifo = 0; lifo <= 1; lifo++) {
+        Executor* executor = executor_create(0);
+        executor_set_lifo_slot(executor, lifo);
+        int log[8];
+        int log_len = 0;
+        LogFuture futures[5];
+        for (int i = 0; i < 5; i++) {
+            futures[i] = (LogFuture) { .base = future_create(log_progress), .id = i, .log = log,
+                .log_len = &log_len, .to_wake = i == 1 ? &futures[0] : NULL, .has_run = false };
+            executor_spawn(executor, (Future*)&futures[i]);
+        }
+        executor_run(executor);
+        assert(log_len == 6);
+        int const expected[2][6] = { { 0, 1, 2, 3, 4, 0 }, { 0, 1, 0, 2, 3, 4 } };
+        for (int i = 0; i < 6; i++) {
+            assert(log[i] == expected[lifo][i]);
+        }
+        executor_destroy(executor);
+    }
+
+    // Two futures waking each other through the LIFO slot do not starve the queue.
+    for (int lifo = 0; lifo <= 1; lifo++) {
+        Executor* executor = executor_create(0);
+        executor_set_lifo_slot(executor, lifo);
+        int rounds = 0;
+        bool stop = false;
+        PingPongFuture a = { .base = future_create(ping_pong_progress), .rounds = &rounds,
+            .stop = &stop };
+        PingPongFuture b = { .base = future_create(ping_pong_progress), .rounds = &rounds,
+            .stop = &stop };
+        a.peer = &b;
+        b.peer = &a;
+        Future stopper = future_create(stopper_progress);
+        stopper.arg = &stop;
+
+        executor_spawn(executor, (Future*)&a);
+        executor_spawn(executor, (Future*)&b);
+        executor_spawn(executor, &stopper);
+        executor_run(executor);
+        printf("LIFO slot %s: the queued future ran after %d rounds\n", lifo ? "on" : "off", rounds);
+        assert(rounds < 2 * EXECUTOR_MAX_LIFO_POLLS + 4);
+        executor_destroy(executor);
+    }
+
+    printf("LIFO test passed\n");
+    return 0;
+}
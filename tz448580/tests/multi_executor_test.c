@@ -0,0 +1,91 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "executor.h"
+#include "future.h"
+#include "future_examples.h"
+#include "utils.h"
+#include "waker.h"
+
+#define N_THREADS 4
+#define N_TASKS 10000
+#define N_YIELDS 5
+#define N_PIPES 8
+
+typedef struct YieldingTask {
+    Future base;
+    atomic_bool in_progress; // Set while progress() runs, to detect concurrent calls.
+    int yields_left;
+} YieldingTask;
+
+static atomic_int progress_calls;
+
+/** A future that yields a few times before completing. */
+static FutureState yielding_future_progress(Future* fut, Mio* mio, Waker waker)
+{
+    YieldingTask* self = (YieldingTask*)fut;
+    bool was_in_progress = atomic_exchange(&self->in_progress, true);
+    assert(!was_in_progress);
+    atomic_fetch_add(&progress_calls, 1);
+
+    FutureState state = FUTURE_COMPLETED;
+    if (self->yields_left > 0) {
+        self->yields_left--;
+        waker_wake(&waker);
+        state = FUTURE_PENDING;
+    }
+
+    atomic_store(&self->in_progress, false);
+    return state;
+}
+
+int main()
+{
+    // Many CPU-only futures on several threads: each must complete, and no future
+    // may ever be progressed by two workers at once.
+    Executor* executor = executor_create_multi(N_THREADS, 0);
+
+    YieldingTask* tasks = calloc(N_TASKS, sizeof(YieldingTask));
+    assert(tasks);
+    for (size_t i = 0; i < N_TASKS; i++) {
+        tasks[i].base = future_create(yielding_future_progress);
+        atomic_init(&tasks[i].in_progress, false);
+        tasks[i].yields_left = N_YIELDS;
+        bool const spawned = executor_spawn(executor, (Future*)&tasks[i]);
+        assert(spawned);
+    }
+    executor_run(executor);
+    for (size_t i = 0; i < N_TASKS; i++) {
+        assert(tasks[i].yields_left == 0);
+        assert(!tasks[i].base.is_active);
+    }
+    assert(atomic_load(&progress_calls) == N_TASKS * (N_YIELDS + 1));
+    free(tasks);
+
+    // Pipe reads, woken through the shared Mio, on the same (reused) executor.
+    const char* message = "AAABBBCCCD";
+    int fds[N_PIPES];
+    uint8_t buffers[N_PIPES][16];
+    PipeReadFuture reads[N_PIPES];
+    for (size_t i = 0; i < N_PIPES; i++) {
+        fds[i] = create_example_read_pipe_end(message, 3, 0, 0);
+        reads[i] = pipe_read_future_create(fds[i], buffers[i], strlen(message) + 1);
+        bool const spawned = executor_spawn(executor, (Future*)&reads[i]);
+        assert(spawned);
+    }
+    executor_run(executor);
+    for (size_t i = 0; i < N_PIPES; i++) {
+        assert(reads[i].base.errcode == FUTURE_SUCCESS);
+        assert(memcmp(buffers[i], message, strlen(message) + 1) == 0);
+        close(fds[i]);
+    }
+
+    executor_destroy(executor);
+    printf("Multi-threaded executor test passed\n");
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "executor.h"
+#include "future.h"
+#include "waker.h"
+
+#define N_CHILDREN 10000
+
+typedef struct CountingFuture {
+    Future base;
+    atomic_int* completed;
+    int yields_left;
+    char payload[]; // Makes the future as large as it is spawned with.
+} CountingFuture;
+
+/** Yields a few times, checks its payload, and counts itself as completed. */
+static FutureState counting_progress(Future* fut, Mio* mio, Waker waker)
+{
+    CountingFuture* self = (CountingFuture*)fut;
+    if (self->yields_left-- > 0) {
+        waker_wake(&waker);
+        return FUTURE_PENDING;
+    }
+    assert(self->payload[0] == 'x');
+    atomic_fetch_add(self->completed, 1);
+    return FUTURE_COMPLETED;
+}
+
+typedef struct ParentFuture {
+    Future base;
+    Executor* executor;
+    atomic_int* completed;
+} ParentFuture;
+
+/** Spawns owned children while running (as a server would do per connection). */
+static FutureState parent_progress(Future* fut, Mio* mio, Waker waker)
+{
+    ParentFuture* self = (ParentFuture*)fut;
+    _Alignas(max_align_t) char template[sizeof(CountingFuture) + 1];
+    CountingFuture* child = (CountingFuture*)template;
+    for (int i = 0; i < N_CHILDREN; i++) {
+        child->base = future_create(counting_progress);
+        child->completed = self->completed;
+        child->yields_left = i % 3;
+        child->payload[0] = 'x';
+        Future* owned = executor_spawn_owned(self->executor, &child->base, sizeof(template), NULL);
+        assert(owned && owned->is_owned);
+    }
+    return FUTURE_COMPLETED;
+}
+
+static void spawn_children(Executor* executor)
+{
+    atomic_int completed = 0;
+    ParentFuture parent = { .base = future_create(parent_progress), .executor = executor,
+        .completed = &completed };
+    executor_spawn(executor, (Future*)&parent);
+    executor_run(executor);
+    assert(atomic_load(&completed) == N_CHILDREN);
+}
+
+int main()
+{
+    // Owned futures of various sizes (including ones too large for the slab) complete.
+    {
+        Executor* executor = executor_create(0);
+        atomic_int completed = 0;
+        size_t const sizes[] = { 1, 100, 1000, 5000, 100000 };
+        size_t const n = sizeof(sizes) / sizeof(sizes[0]);
+        static _Alignas(max_align_t) char template[sizeof(CountingFuture) + 100000];
+        for (size_t i = 0; i < n; i++) {
+            CountingFuture* fut = (CountingFuture*)template;
+            fut->base = future_create(counting_progress);
+            fut->completed = &completed;
+            fut->yields_left = 1;
+            memset(fut->payload, 'x', sizes[i]);
+            Future* owned = executor_spawn_owned(executor, &fut->base, sizeof(CountingFuture) + sizes[i], NULL);
+            assert(owned);
+            assert(!fut->base.is_active); // The template itself is left untouched.
+        }
+        executor_run(executor);
+        assert(atomic_load(&completed) == (int)n);
+        executor_destroy(executor);
+    }
+
+    // Slots are reused across runs, also by futures spawned from other futures.
+    {
+        Executor* executor = executor_create(0);
+        spawn_children(executor);
+        spawn_children(executor);
+        executor_destroy(executor);
+    }
+    {
+        Executor* executor = executor_create_multi(4, 0);
+        spawn_children(executor);
+        executor_destroy(executor);
+    }
+
+    // The admission limit applies (and the slot is not leaked).
+    {
+        Executor* executor = executor_create(1);
+        atomic_int completed = 0;
+        _Alignas(max_align_t) char template[sizeof(CountingFuture) + 1];
+        CountingFuture* fut = (CountingFuture*)template;
+        fut->base = future_create(counting_progress);
+        fut->completed = &completed;
+        fut->yields_left = 0;
+        fut->payload[0] = 'x';
+        Future* first = executor_spawn_owned(executor, &fut->base, sizeof(template), NULL);
+        Future* second = executor_spawn_owned(executor, &fut->base, sizeof(template), NULL);
+        assert(first);
+        assert(second == NULL);
+        executor_destroy(executor);
+    }
+
+    printf("Owned test passed\n");
+    return 0;
+}
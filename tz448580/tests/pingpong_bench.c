@@ -0,0 +1,133 @@
+// Required for `unistd.h` include to contain `pipe2`.
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "waker.h"
+
+#define N_ROUNDS 200000
+#define N_BACKGROUND 64 // Futures that keep the queue busy meanwhile.
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * One end of a ping-pong over a pair of pipes. After writing a message, a player wakes its peer
+ * directly (like a channel would), instead of waiting for epoll to report the pipe readable.
+ */
+typedef struct Player {
+    Future base;
+    int in_fd;
+    int out_fd;
+    struct Player* peer;
+    Waker waker; // Saved while waiting for a message.
+    bool waiting;
+    bool server; // Whether it sends the first message (and gets the last one).
+    bool served;
+    size_t rounds;
+    bool* done;
+} Player;
+
+static void player_send(Player* self)
+{
+    ASSERT_SYS_OK(write(self->out_fd, "x", 1));
+    if (self->peer->waiting) {
+        self->peer->waiting = false;
+        waker_wake(&self->peer->waker);
+    }
+}
+
+static FutureState player_progress(Future* fut, Mio* mio, Waker waker)
+{
+    Player* self = (Player*)fut;
+    if (self->server && !self->served) {
+        self->served = true;
+        player_send(self);
+    }
+    char byte;
+    while (read(self->in_fd, &byte, 1) == 1) {
+        if (++self->rounds == N_ROUNDS && self->server) {
+            *self->done = true;
+            return FUTURE_COMPLETED;
+        }
+        player_send(self);
+        if (self->rounds == N_ROUNDS) {
+            return FUTURE_COMPLETED;
+        }
+    }
+    if (errno != EAGAIN) {
+        syserr("read");
+    }
+    self->waker = waker;
+    self->waiting = true;
+    return FUTURE_PENDING;
+}
+
+/** A future that keeps yielding until the ping-pong is over. */
+static FutureState background_progress(Future* fut, Mio* mio, Waker waker)
+{
+    if (*(bool*)fut->arg) {
+        return FUTURE_COMPLETED;
+    }
+    waker_wake(&waker);
+    return FUTURE_PENDING;
+}
+
+static void bench(bool lifo)
+{
+    int ping_fds[2], pong_fds[2];
+    ASSERT_SYS_OK(pipe2(ping_fds, O_NONBLOCK));
+    ASSERT_SYS_OK(pipe2(pong_fds, O_NONBLOCK));
+    bool done = false;
+
+    Player ping = { .base = future_create(player_progress), .in_fd = pong_fds[0],
+        .out_fd = ping_fds[1], .server = true, .done = &done };
+    Player pong = { .base = future_create(player_progress), .in_fd = ping_fds[0],
+        .out_fd = pong_fds[1], .server = false, .done = &done };
+    ping.peer = &pong;
+    pong.peer = &ping;
+
+    Executor* executor = executor_create(0);
+    executor_set_lifo_slot(executor, lifo);
+    Future background[N_BACKGROUND];
+    for (int i = 0; i < N_BACKGROUND; i++) {
+        background[i] = future_create(background_progress);
+        background[i].arg = &done;
+        executor_spawn(executor, &background[i]);
+    }
+    executor_spawn(executor, (Future*)&ping);
+    executor_spawn(executor, (Future*)&pong);
+
+    double const start = now();
+    executor_run(executor);
+    double const elapsed = now() - start;
+    executor_destroy(executor);
+
+    printf("LIFO slot %-3s: %d round trips with %d busy futures, %7.2f us/round trip\n",
+        lifo ? "on" : "off", N_ROUNDS, N_BACKGROUND, elapsed * 1e6 / N_ROUNDS);
+    for (int i = 0; i < 2; i++) {
+        close(ping_fds[i]);
+        close(pong_fds[i]);
+    }
+}
+
+int main()
+{
+    // Latency of passing a message back and forth between two futures over pipes,
+    // while other futures keep the run queue busy.
+    bench(false);
+    bench(true);
+    return 0;
+}
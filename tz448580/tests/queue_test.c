@@ -0,0 +1,124 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "err.h"
+
+#include "executor.h"
+#include "future.h"
+#include "waker.h"
+
+#define N_TASKS 10000
+#define N_YIELDS 3
+#define N_SPAWNERS 8
+#define MAX_ACTIVE 50
+
+/** A future that yields a few times before completing. */
+static FutureState yielding_future_progress(Future* fut, Mio* mio, Waker waker)
+{
+    int* yields_left = fut->arg;
+    if (*yields_left > 0) {
+        (*yields_left)--;
+        waker_wake(&waker);
+        waker_wake(&waker); // A duplicate wake must not queue the future twice.
+        return FUTURE_PENDING;
+    }
+    return FUTURE_COMPLETED;
+}
+
+typedef struct Spawner {
+    Executor* executor;
+    Future* futs; // MAX_ACTIVE of them.
+    atomic_int* admitted;
+} Spawner;
+
+/** Spawns MAX_ACTIVE futures, counting the ones admitted. */
+static void* spawner_thread(void* arg)
+{
+    Spawner* spawner = arg;
+    for (size_t i = 0; i < MAX_ACTIVE; i++) {
+        if (executor_spawn(spawner->executor, &spawner->futs[i])) {
+            atomic_fetch_add(spawner->admitted, 1);
+        }
+    }
+    return NULL;
+}
+
+int main()
+{
+    // The run queue is unbounded: spawning many more futures than the old fixed
+    // capacity must not lose any of them.
+    Executor* executor = executor_create(0);
+
+    Future* futs = calloc(N_TASKS, sizeof(Future));
+    int* yields_left = calloc(N_TASKS, sizeof(int));
+    assert(futs && yields_left);
+    for (size_t i = 0; i < N_TASKS; i++) {
+        yields_left[i] = N_YIELDS;
+        futs[i] = future_create(yielding_future_progress);
+        futs[i].arg = &yields_left[i];
+        bool const spawned = executor_spawn(executor, &futs[i]);
+        assert(spawned);
+    }
+    executor_run(executor);
+    for (size_t i = 0; i < N_TASKS; i++) {
+        assert(yields_left[i] == 0);
+        assert(!futs[i].is_active);
+    }
+    executor_destroy(executor);
+
+    // With an admission limit, spawning past it is reported to the caller
+    // and does not count the rejected future as active.
+    executor = executor_create(2);
+    for (size_t i = 0; i < 3; i++) {
+        yields_left[i] = N_YIELDS;
+        futs[i] = future_create(yielding_future_progress);
+        futs[i].arg = &yields_left[i];
+    }
+    bool const spawned[] = {
+        executor_spawn(executor, &futs[0]),
+        executor_spawn(executor, &futs[1]),
+        executor_spawn(executor, &futs[2]),
+    };
+    assert(spawned[0] && spawned[1] && !spawned[2]);
+    assert(!futs[2].is_active);
+    executor_run(executor);
+    assert(yields_left[0] == 0 && yields_left[1] == 0 && yields_left[2] == N_YIELDS);
+
+    // Once the admitted futures complete, there is room again.
+    bool const respawned = executor_spawn(executor, &futs[2]);
+    assert(respawned);
+    executor_run(executor);
+    assert(yields_left[2] == 0);
+    executor_destroy(executor);
+
+    // Concurrent spawns do not overshoot the admission limit together.
+    executor = executor_create(MAX_ACTIVE);
+    atomic_int admitted = 0;
+    Spawner spawners[N_SPAWNERS];
+    pthread_t threads[N_SPAWNERS];
+    for (size_t i = 0; i < N_SPAWNERS * MAX_ACTIVE; i++) {
+        yields_left[i] = N_YIELDS;
+        futs[i] = future_create(yielding_future_progress);
+        futs[i].arg = &yields_left[i];
+    }
+    for (size_t i = 0; i < N_SPAWNERS; i++) {
+        spawners[i] = (Spawner) { .executor = executor, .futs = &futs[i * MAX_ACTIVE],
+            .admitted = &admitted };
+        ASSERT_ZERO(pthread_create(&threads[i], NULL, spawner_thread, &spawners[i]));
+    }
+    for (size_t i = 0; i < N_SPAWNERS; i++) {
+        ASSERT_ZERO(pthread_join(threads[i], NULL));
+    }
+    assert(atomic_load(&admitted) == MAX_ACTIVE);
+    executor_run(executor);
+    executor_destroy(executor);
+
+    free(futs);
+    free(yields_left);
+    printf("Queue test passed\n");
+    return 0;
+}
@@ -0,0 +1,258 @@
+// Required for `unistd.h` include to contain `pipe2`.
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "future_combinators.h"
+#include "future_examples.h"
+
+#define N_PIPES 200
+#define WINNER 137
+#define N_STRESS_TASKS 3000
+
+void* square(void* arg)
+{
+    intptr_t number = (intptr_t)arg;
+    return (void*)(number * number);
+}
+
+/** A future that never completes, counting how many times it gets cancelled. */
+typedef struct NeverFuture {
+    Future base;
+    int cancels;
+} NeverFuture;
+
+static FutureState never_progress(Future* fut, Mio* mio, Waker waker)
+{
+    (void)fut;
+    (void)mio;
+    (void)waker;
+    return FUTURE_PENDING;
+}
+
+static void never_cancel(Future* fut, Mio* mio)
+{
+    (void)mio;
+    ((NeverFuture*)fut)->cancels++;
+}
+
+static NeverFuture never_future_create(void)
+{
+    Future base = future_create(never_progress);
+    base.cancel = never_cancel;
+    return (NeverFuture) { .base = base, .cancels = 0 };
+}
+
+static int write_fds[N_PIPES];
+
+/** Writes a byte to the winning pipe only, after a while. */
+static void* writer_thread(void* arg)
+{
+    (void)arg;
+    usleep(20000);
+    ASSERT_SYS_OK(write(write_fds[WINNER], "x", 1));
+    return NULL;
+}
+
+static struct {
+    PipeReadFuture reads[2];
+    uint8_t buffers[2];
+    Future* futs[2];
+    FutureResult results[2];
+    QuorumFuture select;
+    int write_fds[2];
+} stress_tasks[N_STRESS_TASKS];
+
+/** Makes both pipes of every stress task ready, back to back. */
+static void* stress_writer_thread(void* arg)
+{
+    (void)arg;
+    for (int i = 0; i < N_STRESS_TASKS; i++) {
+        ASSERT_SYS_OK(write(stress_tasks[i].write_fds[0], "a", 1));
+        ASSERT_SYS_OK(write(stress_tasks[i].write_fds[1], "b", 1));
+    }
+    return NULL;
+}
+
+static void run(Future* fut)
+{
+    Executor* executor = executor_create(0);
+    executor_spawn(executor, fut);
+    executor_run(executor);
+    executor_destroy(executor);
+}
+
+int main()
+{
+    // The first future to complete wins, and the losers are cancelled.
+    {
+        int fds[2];
+        ASSERT_SYS_OK(pipe2(fds, O_NONBLOCK));
+        uint8_t buffer[1];
+        PipeReadFuture read = pipe_read_future_create(fds[0], buffer, 1);
+        NeverFuture never = never_future_create();
+        ApplyFuture apply = apply_future_create(square);
+        apply.base.arg = (void*)9;
+        Future* futs[] = { &read.base, &never.base, &apply.base };
+        FutureResult results[3];
+        QuorumFuture select = future_select_any(futs, 3, results);
+
+        run((Future*)&select);
+
+        assert(select.base.errcode == FUTURE_SUCCESS);
+        assert(select.winner == 2);
+        assert((intptr_t)select.base.ok == 81);
+        assert(results[2].state == FUTURE_COMPLETED);
+        assert(results[0].state == FUTURE_PENDING && results[1].state == FUTURE_PENDING);
+        assert(never.cancels == 1);
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    // A quorum completes once k futures do; results tell which ones.
+    {
+        int fds[2];
+        ASSERT_SYS_OK(pipe2(fds, O_NONBLOCK));
+        ASSERT_SYS_OK(write(fds[1], "y", 1));
+        uint8_t buffer[1];
+        PipeReadFuture read = pipe_read_future_create(fds[0], buffer, 1);
+        NeverFuture nevers[2] = { never_future_create(), never_future_create() };
+        ApplyFuture apply = apply_future_create(square);
+        apply.base.arg = (void*)5;
+        Future* futs[] = { &nevers[0].base, &apply.base, &read.base, &nevers[1].base };
+        FutureResult results[4];
+        QuorumFuture quorum = future_quorum(futs, 4, 2, results);
+
+        run((Future*)&quorum);
+
+        assert(quorum.base.errcode == FUTURE_SUCCESS);
+        assert(quorum.base.ok == results);
+        assert(quorum.winner == 1);
+        assert(results[1].state == FUTURE_COMPLETED && (intptr_t)results[1].ok == 25);
+        assert(results[2].state == FUTURE_COMPLETED && buffer[0] == 'y');
+        assert(results[0].state == FUTURE_PENDING && results[3].state == FUTURE_PENDING);
+        assert(nevers[0].cancels == 1 && nevers[1].cancels == 1);
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    // A quorum fails as soon as too many futures fail for k to complete.
+    {
+        int fds[2][2];
+        PipeReadFuture reads[2];
+        uint8_t buffers[2];
+        for (int i = 0; i < 2; i++) {
+            ASSERT_SYS_OK(pipe2(fds[i], O_NONBLOCK));
+            close(fds[i][1]); // The read gets EOF.
+            reads[i] = pipe_read_future_create(fds[i][0], &buffers[i], 1);
+        }
+        NeverFuture never = never_future_create();
+        Future* futs[] = { &reads[0].base, &never.base, &reads[1].base };
+        FutureResult results[3];
+        QuorumFuture quorum = future_quorum(futs, 3, 2, results);
+
+        run((Future*)&quorum);
+
+        assert(quorum.base.errcode == QUORUM_FUTURE_ERR_UNREACHABLE);
+        assert(results[0].state == FUTURE_FAILURE && results[0].errcode == PIPE_FUTURE_ERR_EOF);
+        assert(results[2].state == FUTURE_FAILURE);
+        assert(never.cancels == 1);
+        close(fds[0][0]);
+        close(fds[1][0]);
+    }
+
+    // Only the woken child wins; the losers' pipes are released, so a new read of them works.
+    {
+        static uint8_t buffers[N_PIPES];
+        static PipeReadFuture reads[N_PIPES];
+        static Future* futs[N_PIPES];
+        static FutureResult results[N_PIPES];
+        for (int i = 0; i < N_PIPES; i++) {
+            int fds[2];
+            ASSERT_SYS_OK(pipe2(fds, O_NONBLOCK));
+            write_fds[i] = fds[1];
+            reads[i] = pipe_read_future_create(fds[0], &buffers[i], 1);
+            futs[i] = &reads[i].base;
+        }
+        QuorumFuture select = future_select_any(futs, N_PIPES, results);
+
+        Executor* executor = executor_create_multi(4, 0);
+        executor_spawn(executor, (Future*)&select);
+        pthread_t writer;
+        ASSERT_ZERO(pthread_create(&writer, NULL, writer_thread, NULL));
+        executor_run(executor);
+        ASSERT_ZERO(pthread_join(writer, NULL));
+        executor_destroy(executor);
+
+        assert(select.base.errcode == FUTURE_SUCCESS);
+        assert(select.winner == WINNER);
+        assert(buffers[WINNER] == 'x');
+        for (int i = 0; i < N_PIPES; i++) {
+            assert(results[i].state == (i == WINNER ? FUTURE_COMPLETED : FUTURE_PENDING));
+        }
+
+        int const loser = WINNER + 1;
+        ASSERT_SYS_OK(write(write_fds[loser], "z", 1));
+        PipeReadFuture reread = pipe_read_future_create(reads[loser].fd, &buffers[loser], 1);
+        run((Future*)&reread);
+        assert(reread.base.errcode == FUTURE_SUCCESS && buffers[loser] == 'z');
+
+        for (int i = 0; i < N_PIPES; i++) {
+            close(reads[i].fd);
+            close(write_fds[i]);
+        }
+    }
+
+    // Many selects whose losers get cancelled while their wakes may be under way on other workers.
+    {
+        struct rlimit limit;
+        ASSERT_SYS_OK(getrlimit(RLIMIT_NOFILE, &limit));
+        limit.rlim_cur = limit.rlim_max;
+        ASSERT_SYS_OK(setrlimit(RLIMIT_NOFILE, &limit));
+
+        Executor* executor = executor_create_multi(4, 0);
+        for (int i = 0; i < N_STRESS_TASKS; i++) {
+            for (int j = 0; j < 2; j++) {
+                int fds[2];
+                ASSERT_SYS_OK(pipe2(fds, O_NONBLOCK));
+                stress_tasks[i].write_fds[j] = fds[1];
+                stress_tasks[i].reads[j]
+                    = pipe_read_future_create(fds[0], &stress_tasks[i].buffers[j], 1);
+                stress_tasks[i].futs[j] = &stress_tasks[i].reads[j].base;
+            }
+            stress_tasks[i].select
+                = future_select_any(stress_tasks[i].futs, 2, stress_tasks[i].results);
+            bool const spawned = executor_spawn(executor, (Future*)&stress_tasks[i].select);
+            assert(spawned);
+        }
+        pthread_t writer;
+        ASSERT_ZERO(pthread_create(&writer, NULL, stress_writer_thread, NULL));
+        executor_run(executor);
+        ASSERT_ZERO(pthread_join(writer, NULL));
+        executor_destroy(executor);
+
+        for (int i = 0; i < N_STRESS_TASKS; i++) {
+            QuorumFuture const* select = &stress_tasks[i].select;
+            assert(select->base.errcode == FUTURE_SUCCESS);
+            assert(stress_tasks[i].buffers[select->winner] == "ab"[select->winner]);
+            for (int j = 0; j < 2; j++) {
+                close(stress_tasks[i].reads[j].fd);
+                close(stress_tasks[i].write_fds[j]);
+            }
+        }
+    }
+
+    printf("Quorum test passed\n");
+    return 0;
+}
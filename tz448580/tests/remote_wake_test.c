@@ -0,0 +1,90 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "waker.h"
+
+#define N_THREADS 4
+#define N_WAKES 1000
+
+typedef struct RemoteFuture {
+    Future base;
+    _Atomic(Waker*) waker; // Published on the first progress() for the waking threads.
+    Waker saved_waker;
+    atomic_int wakes_sent; // Incremented by the waking threads before each wake.
+} RemoteFuture;
+
+/** A future that completes once every waking thread is done. */
+static FutureState remote_future_progress(Future* fut, Mio* mio, Waker waker)
+{
+    RemoteFuture* self = (RemoteFuture*)fut;
+    if (atomic_load(&self->waker) == NULL) {
+        self->saved_waker = waker;
+        atomic_store(&self->waker, &self->saved_waker);
+    }
+    if (atomic_load(&self->wakes_sent) == N_THREADS * N_WAKES) {
+        return FUTURE_COMPLETED;
+    }
+    // Nothing in this thread will wake us: only the other threads can.
+    return FUTURE_PENDING;
+}
+
+static void* waking_thread(void* arg)
+{
+    RemoteFuture* fut = arg;
+    Waker* waker;
+    while ((waker = atomic_load(&fut->waker)) == NULL) {
+        usleep(1000);
+    }
+    // Give the executor time to park in mio_poll(), so that the first wakes have to unpark it.
+    usleep(100000);
+    for (int i = 0; i < N_WAKES; i++) {
+        atomic_fetch_add(&fut->wakes_sent, 1);
+        waker_wake(waker);
+    }
+    return NULL;
+}
+
+static void run_with(Executor* executor)
+{
+    RemoteFuture fut = { .base = future_create(remote_future_progress) };
+    atomic_init(&fut.waker, NULL);
+    atomic_init(&fut.wakes_sent, 0);
+
+    pthread_t threads[N_THREADS];
+    for (int i = 0; i < N_THREADS; i++) {
+        ASSERT_ZERO(pthread_create(&threads[i], NULL, waking_thread, &fut));
+    }
+
+    bool const spawned = executor_spawn(executor, (Future*)&fut);
+    assert(spawned);
+    executor_run(executor);
+    assert(!fut.base.is_active);
+    assert(atomic_load(&fut.wakes_sent) == N_THREADS * N_WAKES);
+
+    for (int i = 0; i < N_THREADS; i++) {
+        ASSERT_ZERO(pthread_join(threads[i], NULL));
+    }
+}
+
+int main()
+{
+    // A future that is only ever woken from other threads must be able to complete,
+    // even though the executor is blocked in mio_poll() with no registered fds.
+    Executor* executor = executor_create(0);
+    run_with(executor);
+    executor_destroy(executor);
+
+    executor = executor_create_multi(2, 0);
+    run_with(executor);
+    executor_destroy(executor);
+
+    printf("Remote wake test passed\n");
+    return 0;
+}
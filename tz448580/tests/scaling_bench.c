@@ -0,0 +1,198 @@
+// Required for `unistd.h` include to contain `pipe2`.
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h> // For O_NONBLOCK
+#include <stdio.h> // For printf
+#include <stdlib.h> // For calloc
+#include <sys/epoll.h>
+#include <time.h> // For clock_gettime
+#include <unistd.h> // For pipe2, read, write
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "mio.h"
+#include "waker.h"
+
+#define CPU_TASKS 2048
+#define CPU_STAGES 20
+#define CPU_STAGE_ITERATIONS 20000
+
+#define PIPE_PAIRS 64
+#define PIPE_MESSAGES 5000
+#define PIPE_MESSAGE_SIZE 64
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// ============================== CPU-bound ===============================
+
+typedef struct CpuTask {
+    Future base;
+    int stages_left;
+    volatile unsigned sink; // Keeps the computation from being optimized away.
+} CpuTask;
+
+/** A future that does some computation in stages, yielding between them. */
+static FutureState cpu_task_progress(Future* fut, Mio* mio, Waker waker)
+{
+    CpuTask* self = (CpuTask*)fut;
+    unsigned x = self->sink;
+    for (int i = 0; i < CPU_STAGE_ITERATIONS; i++) {
+        x = x * 1103515245u + 12345u;
+    }
+    self->sink = x;
+
+    if (--self->stages_left > 0) {
+        waker_wake(&waker);
+        return FUTURE_PENDING;
+    }
+    return FUTURE_COMPLETED;
+}
+
+static double bench_cpu(size_t n_threads)
+{
+    Executor* executor = executor_create_multi(n_threads, 0);
+    CpuTask* tasks = calloc(CPU_TASKS, sizeof(CpuTask));
+    if (!tasks) {
+        fatal("calloc");
+    }
+    for (size_t i = 0; i < CPU_TASKS; i++) {
+        tasks[i].base = future_create(cpu_task_progress);
+        tasks[i].stages_left = CPU_STAGES;
+        executor_spawn(executor, (Future*)&tasks[i]);
+    }
+
+    double start = now();
+    executor_run(executor);
+    double elapsed = now() - start;
+
+    free(tasks);
+    executor_destroy(executor);
+    return CPU_TASKS * CPU_STAGES / elapsed;
+}
+
+// ============================== Pipe-bound ==============================
+
+typedef struct PipeTask {
+    Future base;
+    int fd;
+    bool registered; // Whether fd is registered in Mio.
+    size_t bytes_left;
+} PipeTask;
+
+/** Registers the task's fd for `events` (if needed) and returns FUTURE_PENDING. */
+static FutureState pipe_task_wait(PipeTask* self, Mio* mio, uint32_t events, Waker waker)
+{
+    if (!self->registered) {
+        mio_register(mio, self->fd, events, waker);
+        self->registered = true;
+    }
+    return FUTURE_PENDING;
+}
+
+/** Unregisters the task's fd (if needed) once it is ready again. */
+static void pipe_task_ready(PipeTask* self, Mio* mio)
+{
+    if (self->registered) {
+        mio_unregister(mio, self->fd);
+        self->registered = false;
+    }
+}
+
+/** A future that writes messages to a pipe, one per call, yielding between them. */
+static FutureState producer_progress(Future* fut, Mio* mio, Waker waker)
+{
+    PipeTask* self = (PipeTask*)fut;
+    static const char message[PIPE_MESSAGE_SIZE] = "ping";
+
+    ssize_t n = write(self->fd, message, PIPE_MESSAGE_SIZE);
+    if (n == -1) {
+        if (errno == EAGAIN) {
+            return pipe_task_wait(self, mio, EPOLLOUT, waker);
+        }
+        syserr("write");
+    }
+    pipe_task_ready(self, mio);
+    // Pipe writes of at most PIPE_BUF bytes are atomic.
+    self->bytes_left -= n;
+    if (self->bytes_left == 0) {
+        return FUTURE_COMPLETED;
+    }
+    waker_wake(&waker);
+    return FUTURE_PENDING;
+}
+
+/** A future that reads everything the producer writes. */
+static FutureState consumer_progress(Future* fut, Mio* mio, Waker waker)
+{
+    PipeTask* self = (PipeTask*)fut;
+    char buffer[4096];
+
+    while (self->bytes_left > 0) {
+        size_t len = self->bytes_left < sizeof(buffer) ? self->bytes_left : sizeof(buffer);
+        ssize_t n = read(self->fd, buffer, len);
+        if (n == -1) {
+            if (errno == EAGAIN) {
+                return pipe_task_wait(self, mio, EPOLLIN, waker);
+            }
+            syserr("read");
+        }
+        if (n == 0) {
+            fatal("unexpected EOF");
+        }
+        self->bytes_left -= n;
+    }
+    pipe_task_ready(self, mio);
+    return FUTURE_COMPLETED;
+}
+
+static double bench_pipe(size_t n_threads)
+{
+    Executor* executor = executor_create_multi(n_threads, 0);
+    PipeTask* tasks = calloc(2 * PIPE_PAIRS, sizeof(PipeTask));
+    if (!tasks) {
+        fatal("calloc");
+    }
+    for (size_t i = 0; i < PIPE_PAIRS; i++) {
+        int fds[2];
+        ASSERT_SYS_OK(pipe2(fds, O_NONBLOCK));
+        PipeTask* consumer = &tasks[2 * i];
+        PipeTask* producer = &tasks[2 * i + 1];
+        *consumer = (PipeTask) { .base = future_create(consumer_progress), .fd = fds[0] };
+        *producer = (PipeTask) { .base = future_create(producer_progress), .fd = fds[1] };
+        consumer->bytes_left = producer->bytes_left = (size_t)PIPE_MESSAGES * PIPE_MESSAGE_SIZE;
+        executor_spawn(executor, (Future*)consumer);
+        executor_spawn(executor, (Future*)producer);
+    }
+
+    double start = now();
+    executor_run(executor);
+    double elapsed = now() - start;
+
+    for (size_t i = 0; i < 2 * PIPE_PAIRS; i++) {
+        close(tasks[i].fd);
+    }
+    free(tasks);
+    executor_destroy(executor);
+    return (double)PIPE_PAIRS * PIPE_MESSAGES / elapsed;
+}
+
+int main()
+{
+    // Throughput of the multi-threaded executor for 1, 2, 4 and 8 workers.
+    size_t const threads[] = { 1, 2, 4, 8 };
+
+    printf("workers  cpu stages/s  pipe msgs/s\n");
+    for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+        double cpu = bench_cpu(threads[i]);
+        double pipe = bench_pipe(threads[i]);
+        printf("%7zu  %12.0f  %11.0f\n", threads[i], cpu, pipe);
+    }
+    return 0;
+}
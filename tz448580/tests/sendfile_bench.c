@@ -0,0 +1,172 @@
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h> // For printf
+#include <stdlib.h> // For mkstemp
+#include <sys/socket.h>
+#include <time.h> // For clock_gettime
+#include <unistd.h>
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "future_examples.h"
+
+#define FILE_SIZE (256L * 1024 * 1024) // Stays in the page cache once written.
+#define PASSES 4 // Times the file is sent per measurement.
+#define CHUNK (64 * 1024) // Bytes per read() and write().
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/** CPU time of the calling thread (CLOCK_THREAD_CPUTIME_ID) or process. */
+static double cpu_now(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/** Discards everything from the (blocking) socket until EOF, without copying it. */
+static void* sink_thread(void* arg)
+{
+    int const fd = *(int*)arg;
+    static uint8_t unused[1];
+    ssize_t n;
+    while ((n = recv(fd, unused, 1 << 20, MSG_TRUNC)) > 0) {
+    }
+    ASSERT_SYS_OK(n);
+    return NULL;
+}
+
+/** Sends the whole file PASSES times, with SendfileFutures, or with read() and TcpWriteFutures. */
+typedef struct StreamFuture {
+    Future base;
+    bool use_sendfile;
+    int file_fd;
+    int out_fd;
+    long n_streamed;
+    long chunk_end; // Where the TcpWriteFuture in flight ends (0 if none).
+    uint8_t buffer[CHUNK];
+    SendfileFuture send;
+    TcpWriteFuture write;
+} StreamFuture;
+
+static FutureState stream_progress(Future* fut, Mio* mio, Waker waker)
+{
+    StreamFuture* self = (StreamFuture*)fut;
+    while (self->n_streamed < PASSES * FILE_SIZE) {
+        FutureState state;
+        if (self->use_sendfile) {
+            if (!self->send.base.progress) {
+                self->send = sendfile_future_create(self->file_fd, self->out_fd, 0, FILE_SIZE);
+            }
+            state = self->send.base.progress(&self->send.base, mio, waker);
+        } else {
+            if (!self->chunk_end) {
+                // The file is in the page cache: read() does not block.
+                off_t const offset = self->n_streamed % FILE_SIZE;
+                ssize_t const n = pread(self->file_fd, self->buffer, CHUNK, offset);
+                ASSERT_SYS_OK(n);
+                self->write = tcp_write_future_create(self->out_fd, self->buffer, n);
+                self->chunk_end = self->n_streamed + n;
+            }
+            state = self->write.base.progress(&self->write.base, mio, waker);
+        }
+        if (state == FUTURE_PENDING) {
+            return FUTURE_PENDING;
+        }
+        if (state == FUTURE_FAILURE) {
+            fatal("stream failed");
+        }
+        if (self->use_sendfile) {
+            self->n_streamed += FILE_SIZE;
+            self->send.base.progress = NULL;
+        } else {
+            self->n_streamed = self->chunk_end;
+            self->chunk_end = 0;
+        }
+    }
+    return FUTURE_COMPLETED;
+}
+
+static void bench_stream(int file_fd, bool use_sendfile)
+{
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t addr_len = sizeof(addr);
+    int listen_fd = tcp_listen((struct sockaddr*)&addr, addr_len, 1);
+    ASSERT_SYS_OK(listen_fd);
+    ASSERT_SYS_OK(getsockname(listen_fd, (struct sockaddr*)&addr, &addr_len));
+    int out_fd = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_SYS_OK(out_fd);
+    ASSERT_SYS_OK(connect(out_fd, (struct sockaddr*)&addr, addr_len));
+    ASSERT_SYS_OK(fcntl(out_fd, F_SETFL, O_NONBLOCK));
+    int in_fd;
+    while ((in_fd = accept(listen_fd, NULL, NULL)) == -1) {
+        // The listening socket is non-blocking, and the connection may not be queued yet.
+    }
+    ASSERT_SYS_OK(fcntl(in_fd, F_SETFL, 0));
+    pthread_t sink;
+    ASSERT_ZERO(pthread_create(&sink, NULL, sink_thread, &in_fd));
+
+    static StreamFuture stream;
+    stream = (StreamFuture) {
+        .base = future_create(stream_progress),
+        .use_sendfile = use_sendfile,
+        .file_fd = file_fd,
+        .out_fd = out_fd,
+        .n_streamed = 0,
+        .chunk_end = 0,
+    };
+    Executor* executor = executor_create(0);
+    executor_spawn(executor, &stream.base);
+    double const process_cpu_start = cpu_now(CLOCK_PROCESS_CPUTIME_ID);
+    double const cpu_start = cpu_now(CLOCK_THREAD_CPUTIME_ID);
+    double const start = now();
+    executor_run(executor);
+    double const elapsed = now() - start;
+    double const cpu = cpu_now(CLOCK_THREAD_CPUTIME_ID) - cpu_start;
+    close(out_fd);
+    ASSERT_ZERO(pthread_join(sink, NULL));
+    double const process_cpu = cpu_now(CLOCK_PROCESS_CPUTIME_ID) - process_cpu_start;
+    executor_destroy(executor);
+    close(in_fd);
+    close(listen_fd);
+
+    long const mib = PASSES * FILE_SIZE >> 20;
+    printf("%-12s %10.2f %18.1f %18.1f\n", use_sendfile ? "sendfile" : "read+write",
+        PASSES * FILE_SIZE / elapsed / 1e9, cpu / mib * 1e6, process_cpu / mib * 1e6);
+}
+
+int main()
+{
+    char path[] = "/tmp/sendfile_bench_XXXXXX";
+    int file_fd = mkstemp(path);
+    ASSERT_SYS_OK(file_fd);
+    ASSERT_SYS_OK(unlink(path));
+    static uint8_t chunk[CHUNK];
+    for (size_t i = 0; i < CHUNK; i++) {
+        chunk[i] = (uint8_t)i;
+    }
+    for (long done = 0; done < FILE_SIZE;) {
+        ssize_t const n = write(file_fd, chunk, CHUNK);
+        ASSERT_SYS_OK(n);
+        done += n;
+    }
+
+    // A cached file streamed over a loopback TCP connection to a thread that discards it:
+    // GB/s, and CPU time per MiB of the sending thread and of the whole process.
+    printf("%-12s %10s %18s %18s\n", "path", "GB/s", "send_cpu_us/MiB", "total_cpu_us/MiB");
+    for (int round = 0; round < 2; round++) {
+        bench_stream(file_fd, false);
+        bench_stream(file_fd, true);
+    }
+    close(file_fd);
+    return 0;
+}
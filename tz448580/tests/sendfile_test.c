@@ -0,0 +1,122 @@
+// Required for `unistd.h` include to contain `pipe2`.
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h> // For mkstemp
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "future_examples.h"
+
+#define FILE_SIZE (3 * 1024 * 1024)
+#define REGION_OFFSET 1000 // Not page-aligned.
+#define REGION_LENGTH (2 * 1024 * 1024) // Far more than a pipe or a socket buffer holds.
+
+static uint8_t contents[FILE_SIZE];
+static uint8_t received[FILE_SIZE];
+
+typedef struct Sink {
+    int fd;
+    size_t n_read;
+} Sink;
+
+/** Reads from the (blocking) fd into `received` until EOF. */
+static void* sink_thread(void* arg)
+{
+    Sink* sink = arg;
+    for (;;) {
+        ssize_t const n = read(sink->fd, received + sink->n_read, FILE_SIZE - sink->n_read);
+        ASSERT_SYS_OK(n);
+        if (n == 0) {
+            return NULL;
+        }
+        sink->n_read += n;
+    }
+}
+
+/** Sends a region of the file to a pipe or a socket, read by another thread. */
+static void run_sendfile(Executor* executor, int file_fd, bool to_socket)
+{
+    int fds[2];
+    if (to_socket) {
+        ASSERT_SYS_OK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    } else {
+        ASSERT_SYS_OK(pipe(fds));
+    }
+    ASSERT_SYS_OK(fcntl(fds[1], F_SETFL, O_NONBLOCK));
+    Sink sink = { .fd = fds[0], .n_read = 0 };
+    pthread_t thread;
+    ASSERT_ZERO(pthread_create(&thread, NULL, sink_thread, &sink));
+
+    SendfileFuture send = sendfile_future_create(file_fd, fds[1], REGION_OFFSET, REGION_LENGTH);
+    executor_spawn(executor, &send.base);
+    executor_run(executor);
+    assert(send.base.errcode == FUTURE_SUCCESS);
+    assert(send.n_sent == REGION_LENGTH);
+    assert(send.offset == REGION_OFFSET + REGION_LENGTH);
+    assert(send.base.ok == &send.n_sent);
+
+    close(fds[1]);
+    ASSERT_ZERO(pthread_join(thread, NULL));
+    assert(sink.n_read == REGION_LENGTH);
+    assert(memcmp(received, contents + REGION_OFFSET, REGION_LENGTH) == 0);
+    // The file's own offset is left alone.
+    assert(lseek(file_fd, 0, SEEK_CUR) == 0);
+    close(fds[0]);
+}
+
+/** A region running past the end of the file fails with EOF, once the rest has been sent. */
+static void test_eof(int file_fd)
+{
+    int fds[2];
+    ASSERT_SYS_OK(pipe2(fds, O_NONBLOCK));
+    Executor* executor = executor_create(0);
+    SendfileFuture send = sendfile_future_create(file_fd, fds[1], FILE_SIZE - 10, 100);
+    executor_spawn(executor, &send.base);
+    executor_run(executor);
+    executor_destroy(executor);
+    assert(send.base.errcode == SENDFILE_FUTURE_ERR_EOF);
+    assert(send.n_sent == 10);
+    ssize_t const n_received = read(fds[0], received, sizeof(received));
+    assert(n_received == 10);
+    assert(memcmp(received, contents + FILE_SIZE - 10, 10) == 0);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+int main()
+{
+    for (size_t i = 0; i < FILE_SIZE; i++) {
+        contents[i] = (uint8_t)(i * 13 + i / 4093);
+    }
+    char path[] = "/tmp/sendfile_test_XXXXXX";
+    int file_fd = mkstemp(path);
+    ASSERT_SYS_OK(file_fd);
+    ASSERT_SYS_OK(unlink(path));
+    for (size_t done = 0; done < FILE_SIZE;) {
+        ssize_t const n = write(file_fd, contents + done, FILE_SIZE - done);
+        ASSERT_SYS_OK(n);
+        done += n;
+    }
+    ASSERT_SYS_OK(lseek(file_fd, 0, SEEK_SET));
+
+    Executor* executors[] = { executor_create(0), executor_create_multi(4, 0) };
+    for (int i = 0; i < 2; i++) {
+        run_sendfile(executors[i], file_fd, false);
+        run_sendfile(executors[i], file_fd, true);
+        executor_destroy(executors[i]);
+    }
+    test_eof(file_fd);
+
+    close(file_fd);
+    printf("Sendfile test passed\n");
+    return 0;
+}
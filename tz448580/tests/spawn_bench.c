@@ -0,0 +1,81 @@
+#include <stdio.h> // For printf
+#include <stdlib.h> // For malloc
+#include <string.h> // For memset
+#include <time.h> // For clock_gettime
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+
+#define N_TASKS 2000000
+#define BATCH 1000 // Tasks spawned before each executor_run().
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static FutureState done_progress(Future* fut, Mio* mio, Waker waker)
+{
+    return FUTURE_COMPLETED;
+}
+
+/** Spawns and completes N_TASKS futures of `size` bytes, each malloc()ed and freed; returns ns/task. */
+static double bench_malloc(Executor* executor, size_t size)
+{
+    Future* batch[BATCH];
+    double const start = now();
+    for (size_t done = 0; done < N_TASKS; done += BATCH) {
+        for (size_t i = 0; i < BATCH; i++) {
+            batch[i] = malloc(size);
+            if (!batch[i]) {
+                fatal("malloc");
+            }
+            *batch[i] = future_create(done_progress);
+            executor_spawn(executor, batch[i]);
+        }
+        executor_run(executor);
+        for (size_t i = 0; i < BATCH; i++) {
+            free(batch[i]);
+        }
+    }
+    return (now() - start) * 1e9 / N_TASKS;
+}
+
+/** Same, with executor_spawn_owned(). */
+static double bench_owned(Executor* executor, size_t size)
+{
+    char* template = malloc(size);
+    if (!template) {
+        fatal("malloc");
+    }
+    memset(template, 0, size);
+    *(Future*)template = future_create(done_progress);
+    double const start = now();
+    for (size_t done = 0; done < N_TASKS; done += BATCH) {
+        for (size_t i = 0; i < BATCH; i++) {
+            executor_spawn_owned(executor, (Future*)template, size, NULL);
+        }
+        executor_run(executor);
+    }
+    double const elapsed = now() - start;
+    free(template);
+    return elapsed * 1e9 / N_TASKS;
+}
+
+int main()
+{
+    // Throughput of spawning and completing short-lived heap-allocated tasks.
+    size_t const sizes[] = { sizeof(Future), 200, 1000, 4000 };
+    Executor* executor = executor_create(0);
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        double const with_malloc = bench_malloc(executor, sizes[s]);
+        double const owned = bench_owned(executor, sizes[s]);
+        printf("task size %5zu B: malloc/free %6.2f ns/task, spawn_owned %6.2f ns/task\n",
+            sizes[s], with_malloc, owned);
+    }
+    executor_destroy(executor);
+    return 0;
+}
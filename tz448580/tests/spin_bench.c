@@ -0,0 +1,154 @@
+// Required for `unistd.h` include to contain `pipe2`.
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h> // For O_NONBLOCK
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h> // For printf
+#include <stdlib.h> // For qsort
+#include <sys/epoll.h>
+#include <time.h> // For clock_gettime
+#include <unistd.h> // For pipe2, read, write
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "mio.h"
+#include "waker.h"
+
+#define N_ROUND_TRIPS 5000
+#define GAP_US 20 // Time the echo thread takes to answer (the pipeline's processing time).
+
+static long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static long cpu_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static atomic_bool stop_echo;
+
+/** Answers every byte from fds[0] on fds[1] after GAP_US (busy-waiting, so that it adds no jitter). */
+static void* echo_thread(void* arg)
+{
+    int const* fds = arg;
+    char byte;
+    while (!atomic_load(&stop_echo)) {
+        if (read(fds[0], &byte, 1) != 1) {
+            continue;
+        }
+        long const reply_at = now_ns() + GAP_US * 1000L;
+        while (now_ns() < reply_at) {
+        }
+        ASSERT_SYS_OK(write(fds[1], &byte, 1));
+    }
+    return NULL;
+}
+
+/** Sends a byte, waits for the echo (parking or spinning in between); N_ROUND_TRIPS times. */
+typedef struct PingFuture {
+    Future base;
+    int out_fd;
+    int in_fd;
+    bool waiting;
+    size_t n_done;
+    long sent_at;
+    long latencies_ns[N_ROUND_TRIPS];
+} PingFuture;
+
+static FutureState ping_progress(Future* fut, Mio* mio, Waker waker)
+{
+    PingFuture* self = (PingFuture*)fut;
+    for (;;) {
+        if (!self->waiting) {
+            if (self->n_done == N_ROUND_TRIPS) {
+                mio_unregister(mio, self->in_fd);
+                return FUTURE_COMPLETED;
+            }
+            self->sent_at = now_ns();
+            ASSERT_SYS_OK(write(self->out_fd, "x", 1));
+            self->waiting = true;
+        }
+        char byte;
+        if (read(self->in_fd, &byte, 1) == 1) {
+            self->latencies_ns[self->n_done++] = now_ns() - self->sent_at;
+            self->waiting = false;
+            continue;
+        }
+        if (errno != EAGAIN) {
+            syserr("read");
+        }
+        mio_register(mio, self->in_fd, EPOLLIN, waker);
+        return FUTURE_PENDING;
+    }
+}
+
+static int compare_longs(const void* a, const void* b)
+{
+    long x = *(const long*)a, y = *(const long*)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_spin(unsigned spin_us)
+{
+    int to_echo[2], from_echo[2];
+    ASSERT_SYS_OK(pipe2(to_echo, O_NONBLOCK));
+    ASSERT_SYS_OK(pipe2(from_echo, O_NONBLOCK));
+    int echo_fds[2] = { to_echo[0], from_echo[1] };
+    atomic_store(&stop_echo, false);
+    pthread_t thread;
+    ASSERT_ZERO(pthread_create(&thread, NULL, echo_thread, echo_fds));
+
+    Executor* executor = executor_create(0);
+    executor_set_spin(executor, spin_us);
+    static PingFuture ping;
+    ping = (PingFuture) {
+        .base = future_create(ping_progress),
+        .out_fd = to_echo[1],
+        .in_fd = from_echo[0],
+        .waiting = false,
+        .n_done = 0,
+    };
+    executor_spawn(executor, &ping.base);
+    long const cpu_start = cpu_ns();
+    long const start = now_ns();
+    executor_run(executor);
+    long const elapsed = now_ns() - start;
+    long const cpu = cpu_ns() - cpu_start;
+    executor_destroy(executor);
+
+    atomic_store(&stop_echo, true);
+    ASSERT_ZERO(pthread_join(thread, NULL));
+    for (int i = 0; i < 2; i++) {
+        close(to_echo[i]);
+        close(from_echo[i]);
+    }
+
+    qsort(ping.latencies_ns, N_ROUND_TRIPS, sizeof(long), compare_longs);
+    printf("%8u %10.2f %10.2f %10.2f %10.1f\n", spin_us,
+        ping.latencies_ns[N_ROUND_TRIPS / 2] / 1e3, ping.latencies_ns[N_ROUND_TRIPS * 99 / 100] / 1e3,
+        (ping.latencies_ns[N_ROUND_TRIPS / 2] - GAP_US * 1000L) / 1e3, 100.0 * cpu / elapsed);
+}
+
+int main()
+{
+    // Round trips through an echo thread that answers after GAP_US: how much the executor's park
+    // (and unpark) adds to each, and how much CPU spinning costs instead, by spin duration.
+    if (sysconf(_SC_NPROCESSORS_ONLN) < 2) {
+        printf("Warning: a single CPU, so spinning only delays the echo thread\n");
+    }
+    printf("%8s %10s %10s %10s %10s\n", "spin_us", "p50_us", "p99_us", "added_us", "cpu_%");
+    unsigned const spins[] = { 0, 5, 10, 15, 20, 25, 30, 50, 100 };
+    for (size_t i = 0; i < sizeof(spins) / sizeof(spins[0]); i++) {
+        bench_spin(spins[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+// Required for `unistd.h` include to contain `pipe2`.
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "future_examples.h"
+#include "timer_wheel.h"
+#include "waker.h"
+
+#define SPIN_US 2000000 // Far longer than the test: spinning must end as soon as there is work.
+#define DELAY_US 5000
+#define SLEEP_MS 20
+
+/** A future that completes once woken by another thread. */
+typedef struct RemoteFuture {
+    Future base;
+    _Atomic(Waker*) waker; // Published on the first progress() for the waking thread.
+    Waker saved_waker;
+    atomic_bool woken;
+} RemoteFuture;
+
+static FutureState remote_progress(Future* fut, Mio* mio, Waker waker)
+{
+    RemoteFuture* self = (RemoteFuture*)fut;
+    if (atomic_load(&self->woken)) {
+        return FUTURE_COMPLETED;
+    }
+    if (atomic_load(&self->waker) == NULL) {
+        self->saved_waker = waker;
+        atomic_store(&self->waker, &self->saved_waker);
+    }
+    return FUTURE_PENDING;
+}
+
+typedef struct Helper {
+    RemoteFuture* remote;
+    int write_fd;
+} Helper;
+
+/** After a delay, writes to the pipe; after another one, wakes the remote future. */
+static void* helper_thread(void* arg)
+{
+    Helper* helper = arg;
+    usleep(DELAY_US);
+    ASSERT_SYS_OK(write(helper->write_fd, "x", 1));
+    Waker* waker;
+    while ((waker = atomic_load(&helper->remote->waker)) == NULL) {
+        usleep(100);
+    }
+    usleep(DELAY_US);
+    atomic_store(&helper->remote->woken, true);
+    waker_wake(waker);
+    return NULL;
+}
+
+/**
+ * Runs a pipe read, a sleep and a future woken from another thread (one after another, as the
+ * executor spins in between) on a spinning executor: each must be noticed while spinning.
+ */
+static void run_spin(Executor* executor)
+{
+    executor_set_spin(executor, SPIN_US);
+
+    int fds[2];
+    ASSERT_SYS_OK(pipe2(fds, O_NONBLOCK));
+    uint8_t byte;
+    PipeReadFuture pipe_read = pipe_read_future_create(fds[0], &byte, 1);
+    SleepFuture sleep = sleep_for_future_create(SLEEP_MS);
+    RemoteFuture remote = { .base = future_create(remote_progress) };
+    atomic_init(&remote.waker, NULL);
+    atomic_init(&remote.woken, false);
+    Helper helper = { .remote = &remote, .write_fd = fds[1] };
+
+    pthread_t thread;
+    ASSERT_ZERO(pthread_create(&thread, NULL, helper_thread, &helper));
+    executor_spawn(executor, &pipe_read.base);
+    executor_spawn(executor, &sleep.base);
+    executor_spawn(executor, &remote.base);
+    uint64_t const start = timer_now_ms();
+    executor_run(executor);
+    uint64_t const elapsed = timer_now_ms() - start;
+    ASSERT_ZERO(pthread_join(thread, NULL));
+
+    assert(pipe_read.base.errcode == FUTURE_SUCCESS && byte == 'x');
+    assert(sleep.base.errcode == FUTURE_SUCCESS);
+    assert(atomic_load(&remote.woken));
+    assert(elapsed < SPIN_US / 1000);
+
+    close(fds[0]);
+    close(fds[1]);
+    executor_destroy(executor);
+}
+
+int main()
+{
+    run_spin(executor_create(0));
+    run_spin(executor_create_multi(4, 0));
+
+    printf("Spin test passed\n");
+    return 0;
+}
@@ -0,0 +1,169 @@
+// Required for `fcntl.h` include to contain `splice` and `F_SETPIPE_SZ`.
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h> // For printf
+#include <time.h> // For clock_gettime
+#include <unistd.h>
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "future_combinators.h"
+#include "future_examples.h"
+
+#define TOTAL_SIZE (1024L * 1024 * 1024)
+#define CHUNK (64 * 1024) // Bytes per read+write (a default pipe's capacity).
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double cpu_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint8_t source[CHUNK];
+
+/** Writes TOTAL_SIZE bytes to the (blocking) fd, then closes it. */
+static void* producer_thread(void* arg)
+{
+    int const fd = *(int*)arg;
+    for (long done = 0; done < TOTAL_SIZE;) {
+        ssize_t const n = write(fd, source, CHUNK);
+        ASSERT_SYS_OK(n);
+        done += n;
+    }
+    close(fd);
+    return NULL;
+}
+
+/** Discards everything from the (blocking) fd until EOF, without copying it. */
+static void* sink_thread(void* arg)
+{
+    int const fd = *(int*)arg;
+    int const null_fd = open("/dev/null", O_WRONLY);
+    ASSERT_SYS_OK(null_fd);
+    ssize_t n;
+    while ((n = splice(fd, NULL, null_fd, NULL, 1 << 20, SPLICE_F_MOVE)) > 0) {
+    }
+    ASSERT_SYS_OK(n);
+    close(null_fd);
+    return NULL;
+}
+
+/** Forwards TOTAL_SIZE bytes a CHUNK at a time, with a PipeReadFuture, then a PipeWriteFuture. */
+typedef struct CopyFuture {
+    Future base;
+    int in_fd;
+    int out_fd;
+    long n_copied;
+    uint8_t buffer[CHUNK];
+    PipeReadFuture read;
+    PipeWriteFuture write;
+    ThenFuture then;
+} CopyFuture;
+
+static FutureState copy_progress(Future* fut, Mio* mio, Waker waker)
+{
+    CopyFuture* self = (CopyFuture*)fut;
+    while (self->n_copied < TOTAL_SIZE) {
+        if (!self->then.base.progress) {
+            self->read = pipe_read_future_create(self->in_fd, self->buffer, CHUNK);
+            self->write = pipe_write_future_create(self->out_fd, CHUNK, false);
+            self->then = future_then(&self->read.base, &self->write.base);
+        }
+        FutureState state = self->then.base.progress(&self->then.base, mio, waker);
+        if (state == FUTURE_PENDING) {
+            return FUTURE_PENDING;
+        }
+        if (state == FUTURE_FAILURE) {
+            fatal("read+write failed");
+        }
+        self->n_copied += CHUNK;
+        self->then.base.progress = NULL;
+    }
+    return FUTURE_COMPLETED;
+}
+
+/** Runs the producer, the forwarder (`fut`, on an executor) and the sink; returns seconds. */
+static double run(Future* fut, int const* in, int const* out, double* cpu)
+{
+    pthread_t producer, sink;
+    ASSERT_ZERO(pthread_create(&producer, NULL, producer_thread, (void*)&in[1]));
+    ASSERT_ZERO(pthread_create(&sink, NULL, sink_thread, (void*)&out[0]));
+    Executor* executor = executor_create(0);
+    executor_spawn(executor, fut);
+    double const cpu_start = cpu_now();
+    double const start = now();
+    executor_run(executor);
+    double const elapsed = now() - start;
+    *cpu = cpu_now() - cpu_start;
+    executor_destroy(executor);
+    close(out[1]);
+    ASSERT_ZERO(pthread_join(producer, NULL));
+    ASSERT_ZERO(pthread_join(sink, NULL));
+    close(in[0]);
+    close(out[0]);
+    return elapsed;
+}
+
+static void bench_forward(char const* name, bool use_splice, bool with_tee)
+{
+    int in[2], out[2], tee_pipe[2] = { -1, -1 };
+    ASSERT_SYS_OK(pipe(in));
+    ASSERT_SYS_OK(pipe(out));
+    ASSERT_SYS_OK(fcntl(in[0], F_SETFL, O_NONBLOCK));
+    ASSERT_SYS_OK(fcntl(out[1], F_SETFL, O_NONBLOCK));
+    pthread_t tee_sink;
+    if (with_tee) {
+        ASSERT_SYS_OK(pipe(tee_pipe));
+        ASSERT_SYS_OK(fcntl(tee_pipe[1], F_SETFL, O_NONBLOCK));
+        ASSERT_ZERO(pthread_create(&tee_sink, NULL, sink_thread, &tee_pipe[0]));
+    }
+
+    double elapsed, cpu;
+    if (use_splice) {
+        SpliceFuture forward = splice_future_create(in[0], out[1], tee_pipe[1]);
+        elapsed = run(&forward.base, in, out, &cpu);
+        if (forward.n_forwarded != TOTAL_SIZE) {
+            fatal("forwarded %zu bytes", forward.n_forwarded);
+        }
+    } else {
+        static CopyFuture copy;
+        copy = (CopyFuture) {
+            .base = future_create(copy_progress),
+            .in_fd = in[0],
+            .out_fd = out[1],
+            .n_copied = 0,
+        };
+        elapsed = run(&copy.base, in, out, &cpu);
+    }
+    if (with_tee) {
+        close(tee_pipe[1]);
+        ASSERT_ZERO(pthread_join(tee_sink, NULL));
+        close(tee_pipe[0]);
+    }
+    printf("%-16s %10.2f %18.1f\n", name, TOTAL_SIZE / elapsed / 1e9, cpu / (TOTAL_SIZE >> 20) * 1e6);
+}
+
+int main()
+{
+    // A producer thread writes into a pipe, and a sink thread discards what comes out of another;
+    // the executor forwards from one to the other: GB/s, and the forwarding thread's CPU time.
+    printf("%-16s %10s %18s\n", "path", "GB/s", "forward_cpu_us/MiB");
+    for (int round = 0; round < 2; round++) {
+        bench_forward("read+write", false, false);
+        bench_forward("splice", true, false);
+        bench_forward("splice+tee", true, true);
+    }
+    return 0;
+}
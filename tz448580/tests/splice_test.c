@@ -0,0 +1,169 @@
+// Required for `unistd.h` include to contain `pipe2`.
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "future_examples.h"
+#include "mio.h"
+
+#define DATA_SIZE (4 * 1024 * 1024) // Several times the internal pipe.
+#define CHUNK 12345 // Odd-sized writes and reads, not aligned with the pipes' pages.
+
+static uint8_t data[DATA_SIZE];
+static uint8_t sunk[2][DATA_SIZE];
+
+typedef struct Sink {
+    int fd;
+    uint8_t* buffer;
+    size_t n_read;
+} Sink;
+
+/** Writes all of `data` to the (blocking) fd, then closes it. */
+static void* producer_thread(void* arg)
+{
+    int const fd = *(int*)arg;
+    for (size_t done = 0; done < DATA_SIZE;) {
+        size_t const n = DATA_SIZE - done < CHUNK ? DATA_SIZE - done : CHUNK;
+        ssize_t const written = write(fd, data + done, n);
+        ASSERT_SYS_OK(written);
+        done += written;
+    }
+    close(fd);
+    return NULL;
+}
+
+/** Reads from the (blocking) fd until EOF. */
+static void* sink_thread(void* arg)
+{
+    Sink* sink = arg;
+    for (;;) {
+        size_t const room = DATA_SIZE - sink->n_read < CHUNK ? DATA_SIZE - sink->n_read : CHUNK;
+        ssize_t const n = read(sink->fd, sink->buffer + sink->n_read, room > 0 ? room : 1);
+        ASSERT_SYS_OK(n);
+        if (n == 0) {
+            return NULL;
+        }
+        sink->n_read += n;
+        assert(sink->n_read <= DATA_SIZE);
+    }
+}
+
+/**
+ * Forwards DATA_SIZE bytes from a producer (over a pipe, or a socket) to a sink pipe, and also to
+ * a second one with tee() if `with_tee`; each sink gets exactly the data. With `persistent`, the
+ * forwarding fds are registered with `mio_register_persistent()`.
+ */
+static void run_forward(Executor* executor, bool from_socket, bool with_tee, bool persistent)
+{
+    int in[2], out[2], tee_pipe[2] = { -1, -1 };
+    if (from_socket) {
+        ASSERT_SYS_OK(socketpair(AF_UNIX, SOCK_STREAM, 0, in));
+    } else {
+        ASSERT_SYS_OK(pipe(in));
+    }
+    ASSERT_SYS_OK(pipe(out));
+    ASSERT_SYS_OK(fcntl(in[0], F_SETFL, O_NONBLOCK));
+    ASSERT_SYS_OK(fcntl(out[1], F_SETFL, O_NONBLOCK));
+    if (with_tee) {
+        ASSERT_SYS_OK(pipe(tee_pipe));
+        ASSERT_SYS_OK(fcntl(tee_pipe[1], F_SETFL, O_NONBLOCK));
+    }
+
+    Sink sinks[2] = { { .fd = out[0], .buffer = sunk[0] }, { .fd = tee_pipe[0], .buffer = sunk[1] } };
+    pthread_t producer, sink_threads[2];
+    ASSERT_ZERO(pthread_create(&producer, NULL, producer_thread, &in[1]));
+    for (int i = 0; i < (with_tee ? 2 : 1); i++) {
+        ASSERT_ZERO(pthread_create(&sink_threads[i], NULL, sink_thread, &sinks[i]));
+    }
+
+    int const forwarding_fds[] = { in[0], out[1], tee_pipe[1] };
+    if (persistent) {
+        for (int i = 0; i < (with_tee ? 3 : 2); i++) {
+            ASSERT_ZERO(mio_register_persistent(executor_mio(executor), forwarding_fds[i]));
+        }
+    }
+
+    SpliceFuture forward = splice_future_create(in[0], out[1], tee_pipe[1]);
+    executor_spawn(executor, &forward.base);
+    executor_run(executor);
+    if (persistent) {
+        for (int i = 0; i < (with_tee ? 3 : 2); i++) {
+            ASSERT_ZERO(mio_unregister(executor_mio(executor), forwarding_fds[i]));
+        }
+    }
+    assert(forward.base.errcode == FUTURE_SUCCESS);
+    assert(forward.n_forwarded == DATA_SIZE);
+    assert(forward.base.ok == &forward.n_forwarded);
+    assert(forward.pipe[0] == -1 && forward.pipe[1] == -1);
+
+    // The future leaves the fds open: closing them ends the sinks.
+    close(out[1]);
+    if (with_tee) {
+        close(tee_pipe[1]);
+    }
+    ASSERT_ZERO(pthread_join(producer, NULL));
+    for (int i = 0; i < (with_tee ? 2 : 1); i++) {
+        ASSERT_ZERO(pthread_join(sink_threads[i], NULL));
+        assert(sinks[i].n_read == DATA_SIZE);
+        assert(memcmp(sinks[i].buffer, data, DATA_SIZE) == 0);
+        close(sinks[i].fd);
+    }
+    close(in[0]);
+}
+
+/** Forwarding to a pipe nobody reads anymore fails with EPIPE. */
+static void test_broken_pipe(void)
+{
+    int in[2], out[2];
+    ASSERT_SYS_OK(pipe2(in, O_NONBLOCK));
+    ASSERT_SYS_OK(pipe2(out, O_NONBLOCK));
+    ASSERT_SYS_OK(write(in[1], "abc", 3));
+    close(out[0]);
+
+    Executor* executor = executor_create(0);
+    SpliceFuture forward = splice_future_create(in[0], out[1], -1);
+    executor_spawn(executor, &forward.base);
+    executor_run(executor);
+    executor_destroy(executor);
+    assert(forward.base.errcode == SPLICE_FUTURE_ERR_IO);
+    assert(forward.error == EPIPE);
+    assert(forward.pipe[0] == -1 && forward.pipe[1] == -1);
+
+    close(in[0]);
+    close(in[1]);
+    close(out[1]);
+}
+
+int main()
+{
+    signal(SIGPIPE, SIG_IGN);
+    for (size_t i = 0; i < DATA_SIZE; i++) {
+        data[i] = (uint8_t)(i * 31 + i / 4099);
+    }
+
+    Executor* executors[] = { executor_create(0), executor_create_multi(4, 0) };
+    for (int i = 0; i < 2; i++) {
+        run_forward(executors[i], false, false, false);
+        run_forward(executors[i], false, true, false);
+        run_forward(executors[i], true, true, false);
+        run_forward(executors[i], true, false, true);
+        run_forward(executors[i], true, true, true);
+        executor_destroy(executors[i]);
+    }
+    test_broken_pipe();
+
+    printf("Splice test passed\n");
+    return 0;
+}
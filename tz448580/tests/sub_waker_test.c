@@ -0,0 +1,156 @@
+// Required for `unistd.h` include to contain `pipe2`.
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "future_combinators.h"
+#include "mio.h"
+
+#define N_LEAVES 64
+
+typedef struct LeafFuture {
+    Future base;
+    int fd;
+    int* polls; // Shared counter of leaf polls.
+} LeafFuture;
+
+/** Reads a single byte from its pipe, counting its polls. */
+static FutureState leaf_progress(Future* fut, Mio* mio, Waker waker)
+{
+    LeafFuture* self = (LeafFuture*)fut;
+    (*self->polls)++;
+    char byte;
+    if (read(self->fd, &byte, 1) == 1) {
+        mio_unregister(mio, self->fd);
+        return FUTURE_COMPLETED;
+    }
+    assert(errno == EAGAIN);
+    mio_register(mio, self->fd, EPOLLIN, waker);
+    return FUTURE_PENDING;
+}
+
+static int write_fds[N_LEAVES];
+
+/** Makes the leaves ready one by one. */
+static void* writer_thread(void* arg)
+{
+    for (int i = 0; i < N_LEAVES; i++) {
+        usleep(1000);
+        ASSERT_SYS_OK(write(write_fds[(i * 37) % N_LEAVES], "x", 1));
+    }
+    return NULL;
+}
+
+/** Keeps its waker and never completes; without a cancel function, it is abandoned as is. */
+typedef struct HoldingFuture {
+    Future base;
+    Waker waker;
+} HoldingFuture;
+
+static FutureState holding_progress(Future* fut, Mio* mio, Waker waker)
+{
+    ((HoldingFuture*)fut)->waker = waker;
+    return FUTURE_PENDING;
+}
+
+static FutureState immediate_progress(Future* fut, Mio* mio, Waker waker)
+{
+    return FUTURE_COMPLETED;
+}
+
+/** Runs a select on the heap, frees it, and then wakes the child that lost through its waker. */
+typedef struct OuterFuture {
+    Future base;
+    int polls;
+    HoldingFuture loser;
+    Future winner;
+} OuterFuture;
+
+static FutureState outer_progress(Future* fut, Mio* mio, Waker waker)
+{
+    OuterFuture* self = (OuterFuture*)fut;
+    if (self->polls++ > 0) {
+        return FUTURE_COMPLETED;
+    }
+    SelectFuture* select = malloc(sizeof(SelectFuture));
+    assert(select);
+    *select = future_select(&self->loser.base, &self->winner);
+    FutureState state = select->base.progress(&select->base, mio, waker);
+    assert(state == FUTURE_COMPLETED);
+    free(select);
+    // The stale waker must not touch the select's memory, but it still wakes this task.
+    waker_wake(&self->loser.waker);
+    return FUTURE_PENDING;
+}
+
+static void test_stale_waker(void)
+{
+    OuterFuture outer = {
+        .base = future_create(outer_progress),
+        .polls = 0,
+        .loser = { .base = future_create(holding_progress) },
+        .winner = future_create(immediate_progress),
+    };
+    Executor* executor = executor_create(0);
+    executor_spawn(executor, &outer.base);
+    executor_run(executor);
+    executor_destroy(executor);
+    assert(outer.polls == 2);
+}
+
+int main()
+{
+    // A binary tree of joins over pipe reads: each wake only re-polls the woken leaf
+    // (instead of every pending one), so every leaf is polled twice in total.
+    int polls = 0;
+    LeafFuture leaves[N_LEAVES];
+    for (int i = 0; i < N_LEAVES; i++) {
+        int fds[2];
+        ASSERT_SYS_OK(pipe2(fds, O_NONBLOCK));
+        leaves[i] = (LeafFuture) { .base = future_create(leaf_progress), .fd = fds[0],
+            .polls = &polls };
+        write_fds[i] = fds[1];
+    }
+    // Node k has children 2k + 1 and 2k + 2; nodes N_LEAVES - 1 and up are leaves.
+    JoinFuture joins[N_LEAVES - 1];
+    for (int k = N_LEAVES - 2; k >= 0; k--) {
+        Future* children[2];
+        for (int c = 0; c < 2; c++) {
+            int const child = 2 * k + 1 + c;
+            children[c] = child >= N_LEAVES - 1 ? &leaves[child - (N_LEAVES - 1)].base
+                                                : &joins[child].base;
+        }
+        joins[k] = future_join(children[0], children[1]);
+    }
+
+    Executor* executor = executor_create(0);
+    executor_spawn(executor, &joins[0].base);
+    pthread_t writer;
+    ASSERT_ZERO(pthread_create(&writer, NULL, writer_thread, NULL));
+    executor_run(executor);
+    ASSERT_ZERO(pthread_join(writer, NULL));
+    executor_destroy(executor);
+
+    printf("%d leaf polls for %d leaves\n", polls, N_LEAVES);
+    assert(joins[0].base.errcode == FUTURE_SUCCESS);
+    assert(polls <= 2 * N_LEAVES);
+
+    for (int i = 0; i < N_LEAVES; i++) {
+        close(leaves[i].fd);
+        close(write_fds[i]);
+    }
+
+    test_stale_waker();
+    printf("Sub-waker test passed\n");
+    return 0;
+}
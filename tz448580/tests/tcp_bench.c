@@ -0,0 +1,314 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdio.h> // For printf
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h> // For clock_gettime
+#include <unistd.h> // For fork
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "future_examples.h"
+#include "waker.h"
+
+#define MESSAGE_SIZE 32
+#define TOTAL_REQUESTS 200000
+#define MAX_CONNECTING 256 // Bound on the connects in flight, so that the accept queue keeps up.
+#define ACCEPT_BATCH 256
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static Executor* executor;
+
+// ============================== Server ===============================
+
+/** Echoes whatever arrives on a connection until the peer closes it, then closes it. */
+typedef struct EchoFuture {
+    Future base;
+    int fd;
+    bool writing;
+    uint8_t buffer[MESSAGE_SIZE];
+    TcpReadFuture read;
+    TcpWriteFuture write;
+} EchoFuture;
+
+static FutureState echo_progress(Future* fut, Mio* mio, Waker waker)
+{
+    EchoFuture* self = (EchoFuture*)fut;
+    if (!self->read.base.progress) {
+        self->read = tcp_read_future_create(self->fd, self->buffer, MESSAGE_SIZE, 1);
+    }
+    for (;;) {
+        if (!self->writing) {
+            FutureState state = self->read.base.progress(&self->read.base, mio, waker);
+            if (state == FUTURE_PENDING) {
+                return FUTURE_PENDING;
+            }
+            if (state == FUTURE_FAILURE) {
+                close(self->fd);
+                return FUTURE_COMPLETED;
+            }
+            self->write = tcp_write_future_create(self->fd, self->buffer, self->read.n_read);
+            self->writing = true;
+        }
+        FutureState state = self->write.base.progress(&self->write.base, mio, waker);
+        if (state == FUTURE_PENDING) {
+            return FUTURE_PENDING;
+        }
+        if (state == FUTURE_FAILURE) {
+            close(self->fd);
+            return FUTURE_COMPLETED;
+        }
+        self->read = tcp_read_future_create(self->fd, self->buffer, MESSAGE_SIZE, 1);
+        self->writing = false;
+    }
+}
+
+/** Accepts `n_left` connections (in batches), spawning an EchoFuture for each. */
+typedef struct ServerFuture {
+    Future base;
+    int listen_fd;
+    size_t n_left;
+    size_t n_accepts; // Completed TcpAcceptFutures (wakeups of the listener).
+    int fds[ACCEPT_BATCH];
+    TcpAcceptFuture accept;
+} ServerFuture;
+
+static FutureState server_progress(Future* fut, Mio* mio, Waker waker)
+{
+    ServerFuture* self = (ServerFuture*)fut;
+    while (self->n_left > 0) {
+        FutureState state = self->accept.base.progress(&self->accept.base, mio, waker);
+        if (state == FUTURE_PENDING) {
+            return FUTURE_PENDING;
+        }
+        if (state == FUTURE_FAILURE) {
+            fatal("accept: %s", strerror(self->accept.error));
+        }
+        for (size_t i = 0; i < self->accept.n_accepted; i++) {
+            EchoFuture echo = {
+                .base = future_create(echo_progress),
+                .fd = self->fds[i],
+                .writing = false,
+            };
+            if (!executor_spawn_owned(executor, &echo.base, sizeof(echo), NULL)) {
+                fatal("executor_spawn_owned");
+            }
+        }
+        self->n_left -= self->accept.n_accepted;
+        self->n_accepts++;
+        self->accept = tcp_accept_future_create(
+            self->listen_fd, self->fds, ACCEPT_BATCH, TCP_OPTION_NODELAY);
+    }
+    return FUTURE_COMPLETED;
+}
+
+// ============================== Client ===============================
+
+static size_t n_clients;
+static size_t n_connecting;
+static size_t n_connected;
+static double connected_at; // When the last connection was established.
+static Waker* queued; // Wakers of the clients waiting to start connecting.
+static size_t n_queued;
+static Waker* connected; // Wakers of the clients waiting for the others to connect.
+static size_t n_barrier;
+
+/**
+ * Connects (once fewer than MAX_CONNECTING are connecting), waits for all the others to connect,
+ * then sends `n_requests` messages one by one, waiting for each echo.
+ */
+typedef struct ClientFuture {
+    Future base;
+    enum { CLIENT_QUEUED, CLIENT_CONNECTING, CLIENT_BARRIER, CLIENT_RUNNING } state;
+    size_t n_requests;
+    bool reading;
+    uint8_t message[MESSAGE_SIZE];
+    uint8_t reply[MESSAGE_SIZE];
+    TcpConnectFuture connect;
+    TcpWriteFuture write;
+    TcpReadFuture read;
+} ClientFuture;
+
+static FutureState client_progress(Future* fut, Mio* mio, Waker waker)
+{
+    ClientFuture* self = (ClientFuture*)fut;
+    if (self->state == CLIENT_QUEUED) {
+        if (n_connecting == MAX_CONNECTING) {
+            queued[n_queued++] = waker;
+            return FUTURE_PENDING;
+        }
+        n_connecting++;
+        self->state = CLIENT_CONNECTING;
+    }
+    if (self->state == CLIENT_CONNECTING) {
+        FutureState state = self->connect.base.progress(&self->connect.base, mio, waker);
+        if (state == FUTURE_PENDING) {
+            return FUTURE_PENDING;
+        }
+        if (state == FUTURE_FAILURE) {
+            fatal("connect: %s", strerror(self->connect.error));
+        }
+        n_connecting--;
+        if (n_queued > 0) {
+            waker_wake(&queued[--n_queued]);
+        }
+        self->state = CLIENT_BARRIER;
+        if (++n_connected == n_clients) {
+            // Everybody is connected: start the requests.
+            connected_at = now();
+            for (size_t i = 0; i < n_barrier; i++) {
+                waker_wake(&connected[i]);
+            }
+        } else {
+            connected[n_barrier++] = waker;
+            return FUTURE_PENDING;
+        }
+    }
+    if (self->state == CLIENT_BARRIER) {
+        if (n_connected < n_clients) {
+            return FUTURE_PENDING;
+        }
+        self->state = CLIENT_RUNNING;
+    }
+    int const fd = self->connect.fd;
+    while (self->n_requests > 0) {
+        if (!self->reading) {
+            self->write = tcp_write_future_create(fd, self->message, MESSAGE_SIZE);
+            self->read = tcp_read_future_create(fd, self->reply, MESSAGE_SIZE, MESSAGE_SIZE);
+            self->reading = true;
+        }
+        if (self->write.n_written < MESSAGE_SIZE) {
+            FutureState state = self->write.base.progress(&self->write.base, mio, waker);
+            if (state == FUTURE_PENDING) {
+                return FUTURE_PENDING;
+            }
+            if (state == FUTURE_FAILURE) {
+                fatal("write: %s", strerror(self->write.error));
+            }
+        }
+        FutureState state = self->read.base.progress(&self->read.base, mio, waker);
+        if (state == FUTURE_PENDING) {
+            return FUTURE_PENDING;
+        }
+        if (state == FUTURE_FAILURE) {
+            fatal("read: %d", self->read.base.errcode);
+        }
+        self->n_requests--;
+        self->reading = false;
+    }
+    close(fd);
+    return FUTURE_COMPLETED;
+}
+
+static void run_clients(struct sockaddr_in const* addr, size_t n)
+{
+    executor = executor_create(0);
+    ClientFuture* clients = calloc(n, sizeof(ClientFuture));
+    queued = calloc(n, sizeof(Waker));
+    connected = calloc(n, sizeof(Waker));
+    if (!clients || !queued || !connected) {
+        fatal("calloc");
+    }
+    n_clients = n;
+    n_connecting = 0;
+    n_connected = 0;
+    n_queued = 0;
+    n_barrier = 0;
+    for (size_t i = 0; i < n; i++) {
+        clients[i] = (ClientFuture) {
+            .base = future_create(client_progress),
+            .state = CLIENT_QUEUED,
+            .n_requests = TOTAL_REQUESTS / n,
+            .reading = false,
+            .connect = tcp_connect_future_create(
+                (struct sockaddr const*)addr, sizeof(*addr), TCP_OPTION_NODELAY),
+        };
+        memset(clients[i].message, 'x', MESSAGE_SIZE);
+        executor_spawn(executor, &clients[i].base);
+    }
+    double const start = now();
+    executor_run(executor);
+    double const end = now();
+
+    printf("%8zu %14.0f %14.0f\n", n, n / (connected_at - start),
+        (double)(TOTAL_REQUESTS / n) * n / (end - connected_at));
+    fflush(stdout);
+    free(clients);
+    free(queued);
+    free(connected);
+    executor_destroy(executor);
+}
+
+// ============================== Bench ===============================
+
+/** Serves `n` connections in this process, with the clients in a child process. */
+static void bench_echo(size_t n)
+{
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t addr_len = sizeof(addr);
+    int listen_fd = tcp_listen((struct sockaddr*)&addr, addr_len, SOMAXCONN);
+    ASSERT_SYS_OK(listen_fd);
+    ASSERT_SYS_OK(getsockname(listen_fd, (struct sockaddr*)&addr, &addr_len));
+
+    fflush(stdout);
+    pid_t pid = fork();
+    ASSERT_SYS_OK(pid);
+    if (pid == 0) {
+        // Each process has its own fd limit: the client ends do not count against the server's.
+        close(listen_fd);
+        run_clients(&addr, n);
+        exit(0);
+    }
+
+    executor = executor_create(0);
+    ServerFuture server = {
+        .base = future_create(server_progress),
+        .listen_fd = listen_fd,
+        .n_left = n,
+        .n_accepts = 0,
+    };
+    server.accept = tcp_accept_future_create(listen_fd, server.fds, ACCEPT_BATCH, TCP_OPTION_NODELAY);
+    executor_spawn(executor, &server.base);
+    executor_run(executor);
+    executor_destroy(executor);
+    close(listen_fd);
+
+    int status;
+    ASSERT_SYS_OK(waitpid(pid, &status, 0));
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fatal("client process failed");
+    }
+    printf("%8s %14s %14s (%.1f connections per accept wakeup)\n", "", "", "",
+        (double)n / server.n_accepts);
+}
+
+int main()
+{
+    // Let both processes have 10k connections (plus some).
+    struct rlimit limit;
+    ASSERT_SYS_OK(getrlimit(RLIMIT_NOFILE, &limit));
+    limit.rlim_cur = limit.rlim_max;
+    ASSERT_SYS_OK(setrlimit(RLIMIT_NOFILE, &limit));
+
+    // Loopback echo of MESSAGE_SIZE-byte requests (one in flight per connection), with the
+    // connections opened all at once (at most MAX_CONNECTING connecting) before the requests.
+    printf("%8s %14s %14s\n", "conns", "connections/s", "requests/s");
+    size_t const sizes[] = { 1000, 10000 };
+    for (int round = 0; round < 2; round++) {
+        for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+            bench_echo(sizes[i]);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,288 @@
+#include <arpa/inet.h>
+#include <assert.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "future_examples.h"
+
+#define N_CLIENTS 8
+#define N_REQUESTS 100
+#define MESSAGE_SIZE 32
+
+static Executor* executor;
+
+/** Echoes whatever arrives on a connection until the peer closes it, then closes it. */
+typedef struct EchoFuture {
+    Future base;
+    int fd;
+    bool writing;
+    uint8_t buffer[MESSAGE_SIZE];
+    TcpReadFuture read;
+    TcpWriteFuture write;
+} EchoFuture;
+
+static FutureState echo_progress(Future* fut, Mio* mio, Waker waker)
+{
+    EchoFuture* self = (EchoFuture*)fut;
+    if (!self->read.base.progress) {
+        // Not before, as the executor moves the future when spawning it.
+        self->read = tcp_read_future_create(self->fd, self->buffer, MESSAGE_SIZE, 1);
+    }
+    for (;;) {
+        if (!self->writing) {
+            FutureState state = self->read.base.progress(&self->read.base, mio, waker);
+            if (state == FUTURE_PENDING) {
+                return FUTURE_PENDING;
+            }
+            if (state == FUTURE_FAILURE) {
+                assert(self->read.base.errcode == TCP_FUTURE_ERR_EOF);
+                close(self->fd);
+                return FUTURE_COMPLETED;
+            }
+            self->write = tcp_write_future_create(self->fd, self->buffer, self->read.n_read);
+            self->writing = true;
+        }
+        FutureState state = self->write.base.progress(&self->write.base, mio, waker);
+        if (state == FUTURE_PENDING) {
+            return FUTURE_PENDING;
+        }
+        assert(state == FUTURE_COMPLETED);
+        self->read = tcp_read_future_create(self->fd, self->buffer, MESSAGE_SIZE, 1);
+        self->writing = false;
+    }
+}
+
+/** Accepts `n_left` connections, spawning an EchoFuture for each. */
+typedef struct ServerFuture {
+    Future base;
+    int listen_fd;
+    size_t n_left;
+    int fds[N_CLIENTS];
+    TcpAcceptFuture accept;
+} ServerFuture;
+
+static FutureState server_progress(Future* fut, Mio* mio, Waker waker)
+{
+    ServerFuture* self = (ServerFuture*)fut;
+    while (self->n_left > 0) {
+        FutureState state = self->accept.base.progress(&self->accept.base, mio, waker);
+        if (state == FUTURE_PENDING) {
+            return FUTURE_PENDING;
+        }
+        assert(state == FUTURE_COMPLETED);
+        for (size_t i = 0; i < self->accept.n_accepted; i++) {
+            EchoFuture echo = {
+                .base = future_create(echo_progress),
+                .fd = self->fds[i],
+                .writing = false,
+            };
+            Future* owned = executor_spawn_owned(executor, &echo.base, sizeof(echo), NULL);
+            assert(owned);
+        }
+        self->n_left -= self->accept.n_accepted;
+        self->accept = tcp_accept_future_create(
+            self->listen_fd, self->fds, N_CLIENTS, TCP_OPTION_NODELAY);
+    }
+    return FUTURE_COMPLETED;
+}
+
+/** Connects, sends N_REQUESTS messages and checks their echoes, then closes the connection. */
+typedef struct ClientFuture {
+    Future base;
+    int id;
+    int requests_done;
+    bool reading;
+    uint8_t message[MESSAGE_SIZE];
+    uint8_t reply[MESSAGE_SIZE];
+    TcpConnectFuture connect;
+    TcpWriteFuture write;
+    TcpReadFuture read;
+} ClientFuture;
+
+static FutureState client_progress(Future* fut, Mio* mio, Waker waker)
+{
+    ClientFuture* self = (ClientFuture*)fut;
+    if (self->connect.base.progress) {
+        FutureState state = self->connect.base.progress(&self->connect.base, mio, waker);
+        if (state == FUTURE_PENDING) {
+            return FUTURE_PENDING;
+        }
+        assert(state == FUTURE_COMPLETED);
+        self->connect.base.progress = NULL;
+    }
+    int const fd = self->connect.fd;
+    while (self->requests_done < N_REQUESTS) {
+        if (!self->reading) {
+            memset(self->message, 'a' + (self->id + self->requests_done) % 26, MESSAGE_SIZE);
+            self->write = tcp_write_future_create(fd, self->message, MESSAGE_SIZE);
+            self->read = tcp_read_future_create(fd, self->reply, MESSAGE_SIZE, MESSAGE_SIZE);
+            self->reading = true;
+        }
+        if (self->write.n_written < MESSAGE_SIZE) {
+            FutureState state = self->write.base.progress(&self->write.base, mio, waker);
+            if (state == FUTURE_PENDING) {
+                return FUTURE_PENDING;
+            }
+            assert(state == FUTURE_COMPLETED);
+        }
+        FutureState state = self->read.base.progress(&self->read.base, mio, waker);
+        if (state == FUTURE_PENDING) {
+            return FUTURE_PENDING;
+        }
+        assert(state == FUTURE_COMPLETED);
+        assert(memcmp(self->message, self->reply, MESSAGE_SIZE) == 0);
+        self->requests_done++;
+        self->reading = false;
+    }
+    close(fd);
+    return FUTURE_COMPLETED;
+}
+
+/** Echoes N_REQUESTS messages over each of N_CLIENTS connections to a server on `addr`. */
+static void run_echo(struct sockaddr* addr, socklen_t addr_len)
+{
+    int listen_fd = tcp_listen(addr, addr_len, N_CLIENTS);
+    if (listen_fd == -1 && addr->sa_family == AF_INET6) {
+        printf("IPv6 not available, skipping\n");
+        return;
+    }
+    ASSERT_SYS_OK(listen_fd);
+    ASSERT_SYS_OK(getsockname(listen_fd, addr, &addr_len));
+
+    ServerFuture server = {
+        .base = future_create(server_progress),
+        .listen_fd = listen_fd,
+        .n_left = N_CLIENTS,
+    };
+    server.accept = tcp_accept_future_create(listen_fd, server.fds, N_CLIENTS, TCP_OPTION_NODELAY);
+    executor_spawn(executor, &server.base);
+    static ClientFuture clients[N_CLIENTS];
+    for (int i = 0; i < N_CLIENTS; i++) {
+        clients[i] = (ClientFuture) {
+            .base = future_create(client_progress),
+            .id = i,
+            .requests_done = 0,
+            .reading = false,
+            .connect = tcp_connect_future_create(addr, addr_len, TCP_OPTION_NODELAY),
+        };
+        executor_spawn(executor, &clients[i].base);
+    }
+    executor_run(executor);
+
+    assert(server.base.errcode == FUTURE_SUCCESS);
+    for (int i = 0; i < N_CLIENTS; i++) {
+        assert(clients[i].requests_done == N_REQUESTS);
+    }
+    close(listen_fd);
+}
+
+/** Connections pending in the backlog are all taken by a single accept. */
+static void test_accept_batch(void)
+{
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t addr_len = sizeof(addr);
+    int listen_fd = tcp_listen((struct sockaddr*)&addr, addr_len, N_CLIENTS);
+    ASSERT_SYS_OK(listen_fd);
+    ASSERT_SYS_OK(getsockname(listen_fd, (struct sockaddr*)&addr, &addr_len));
+
+    int client_fds[N_CLIENTS];
+    for (int i = 0; i < N_CLIENTS; i++) {
+        client_fds[i] = socket(AF_INET, SOCK_STREAM, 0);
+        ASSERT_SYS_OK(client_fds[i]);
+        ASSERT_SYS_OK(connect(client_fds[i], (struct sockaddr*)&addr, addr_len));
+    }
+
+    int fds[2 * N_CLIENTS];
+    TcpAcceptFuture accept = tcp_accept_future_create(listen_fd, fds, 2 * N_CLIENTS, 0);
+    executor_spawn(executor, &accept.base);
+    executor_run(executor);
+    assert(accept.base.errcode == FUTURE_SUCCESS);
+    assert(accept.n_accepted == N_CLIENTS);
+
+    for (int i = 0; i < N_CLIENTS; i++) {
+        close(fds[i]);
+        close(client_fds[i]);
+    }
+    close(listen_fd);
+}
+
+/** Connecting to a port nobody listens on fails with ECONNREFUSED. */
+static void test_refused(void)
+{
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t addr_len = sizeof(addr);
+    // Grab a free port, and stop listening on it.
+    int listen_fd = tcp_listen((struct sockaddr*)&addr, addr_len, 1);
+    ASSERT_SYS_OK(listen_fd);
+    ASSERT_SYS_OK(getsockname(listen_fd, (struct sockaddr*)&addr, &addr_len));
+    close(listen_fd);
+
+    TcpConnectFuture connect = tcp_connect_future_create((struct sockaddr*)&addr, addr_len, 0);
+    executor_spawn(executor, &connect.base);
+    executor_run(executor);
+    assert(connect.base.errcode == TCP_FUTURE_ERR_IO);
+    assert(connect.error == ECONNREFUSED);
+    assert(connect.fd == -1);
+}
+
+/** An address longer than any socket address fails the connect instead of overflowing it. */
+static void test_address_too_long(void)
+{
+    static uint8_t addr[sizeof(struct sockaddr_storage) + 1];
+    TcpConnectFuture connect
+        = tcp_connect_future_create((struct sockaddr*)addr, sizeof(addr), TCP_OPTION_NODELAY);
+    executor_spawn(executor, &connect.base);
+    executor_run(executor);
+    assert(connect.base.errcode == TCP_FUTURE_ERR_IO);
+    assert(connect.error == EINVAL);
+    assert(connect.fd == -1);
+}
+
+/** A read into an empty buffer completes at once, even though the peer never sends anything. */
+static void test_empty_read(void)
+{
+    int fds[2];
+    ASSERT_SYS_OK(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds));
+    uint8_t byte;
+    TcpReadFuture read = tcp_read_future_create(fds[0], &byte, 0, 0);
+    executor_spawn(executor, &read.base);
+    executor_run(executor);
+    assert(read.base.errcode == FUTURE_SUCCESS);
+    assert(read.n_read == 0);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+static void run_all(void)
+{
+    struct sockaddr_in addr4 = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    run_echo((struct sockaddr*)&addr4, sizeof(addr4));
+    struct sockaddr_in6 addr6 = { .sin6_family = AF_INET6, .sin6_addr = IN6ADDR_LOOPBACK_INIT };
+    run_echo((struct sockaddr*)&addr6, sizeof(addr6));
+    test_accept_batch();
+    test_refused();
+    test_address_too_long();
+    test_empty_read();
+}
+
+int main()
+{
+    executor = executor_create(0);
+    run_all();
+    executor_destroy(executor);
+
+    executor = executor_create_multi(4, 0);
+    run_all();
+    executor_destroy(executor);
+
+    printf("TCP test passed\n");
+    return 0;
+}
@@ -0,0 +1,75 @@
+// Required for `unistd.h` include to contain `pipe2`.
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "executor.h"
+#include "future.h"
+#include "future_combinators.h"
+#include "future_examples.h"
+#include "timer_wheel.h"
+#include "utils.h"
+
+void* increment(void* arg)
+{
+    intptr_t number = (intptr_t)arg;
+    return (void*)(number + 1);
+}
+
+int main()
+{
+    // A pipe read that is too slow gets cut off by the deadline, and releases its fd.
+
+    const char* message = "AAABBBCCCD";
+    size_t const len = strlen(message) + 1;
+
+    // The pipe gets 3 bytes every second, so only "AAA" arrives before the deadline.
+    int read_fd = create_example_read_pipe_end(message, 3, 1, 0);
+    uint8_t buffer[len];
+
+    uint64_t const start = timer_now_ms();
+    PipeReadFuture read = pipe_read_future_create(read_fd, buffer, len);
+    TimeoutFuture timeout = future_timeout((Future*)&read, start + 1500);
+
+    Executor* executor = executor_create(0);
+    executor_spawn(executor, (Future*)&timeout);
+    executor_run(executor);
+
+    uint64_t elapsed = timer_now_ms() - start;
+    printf("Timed out after %lu ms\n", (unsigned long)elapsed);
+    assert(elapsed >= 1500 && elapsed < 2500);
+    assert(timeout.base.errcode == TIMEOUT_FUTURE_ERR_TIMED_OUT);
+    assert(read.read_so_far == 3);
+    assert(memcmp(buffer, "AAA", 3) == 0);
+
+    // The fd has been unregistered from Mio: otherwise a new future registering it would be
+    // ignored (and never woken) while the old registration keeps pointing at the dead one.
+    PipeReadFuture rest = pipe_read_future_create(read_fd, buffer + 3, len - 3);
+    TimeoutFuture rest_timeout = future_timeout((Future*)&rest, timer_now_ms() + 10000);
+    executor_spawn(executor, (Future*)&rest_timeout);
+    executor_run(executor);
+
+    assert(rest_timeout.base.errcode == FUTURE_SUCCESS);
+    assert(rest_timeout.base.ok == buffer + 3);
+    assert(memcmp(buffer, message, len) == 0);
+    assert(rest_timeout.timer.state == TIMER_IDLE); // The timer was cancelled.
+
+    // A future that completes at once passes its result through.
+    ApplyFuture apply = apply_future_create(increment);
+    apply.base.arg = (void*)41;
+    TimeoutFuture apply_timeout = future_timeout((Future*)&apply, timer_now_ms() + 1000);
+    executor_spawn(executor, (Future*)&apply_timeout);
+    executor_run(executor);
+    assert(apply_timeout.base.errcode == FUTURE_SUCCESS);
+    assert((intptr_t)apply_timeout.base.ok == 42);
+
+    executor_destroy(executor);
+    close(read_fd);
+
+    printf("Timeout test passed\n");
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include <stdio.h> // For printf
+#include <stdlib.h> // For malloc
+#include <time.h> // For clock_gettime
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "future_examples.h"
+#include "mio.h"
+#include "timer_wheel.h"
+
+#define N_TIMERS 1000000
+#define MAX_DELAY_MS (3600 * 1000) // Timers are spread over an hour.
+#define N_SLEEPS 100000
+#define MAX_SLEEP_MS 200
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main()
+{
+    // Arming and cancelling a million timers (they never fire, so no executor is needed).
+    Mio* mio = mio_create(NULL, MIO_BACKEND_EPOLL);
+    if (!mio) {
+        fatal("mio_create");
+    }
+    TimerEntry* timers = malloc(N_TIMERS * sizeof(TimerEntry));
+    if (!timers) {
+        fatal("malloc");
+    }
+    Future dummy = future_create(NULL);
+    Waker waker = { .executor = NULL, .future = &dummy };
+    uint64_t const base = timer_now_ms();
+    srandom(42);
+
+    for (size_t i = 0; i < N_TIMERS; i++) {
+        timers[i] = timer_entry_create();
+    }
+    double start = now();
+    for (size_t i = 0; i < N_TIMERS; i++) {
+        mio_timer_arm(mio, &timers[i], base + 1000 + random() % MAX_DELAY_MS, waker);
+    }
+    double armed = now();
+    for (size_t i = 0; i < N_TIMERS; i++) {
+        mio_timer_cancel(mio, &timers[i]);
+    }
+    double cancelled = now();
+    printf("arm:    %d timers in %.3f s (%.1f ns/timer)\n", N_TIMERS, armed - start,
+        (armed - start) * 1e9 / N_TIMERS);
+    printf("cancel: %d timers in %.3f s (%.1f ns/timer)\n", N_TIMERS, cancelled - armed,
+        (cancelled - armed) * 1e9 / N_TIMERS);
+    free(timers);
+    mio_destroy(mio);
+
+    // Sleeps that actually fire, spread over MAX_SLEEP_MS.
+    Executor* executor = executor_create(0);
+    SleepFuture* sleeps = malloc(N_SLEEPS * sizeof(SleepFuture));
+    if (!sleeps) {
+        fatal("malloc");
+    }
+    start = now();
+    for (size_t i = 0; i < N_SLEEPS; i++) {
+        sleeps[i] = sleep_for_future_create(random() % MAX_SLEEP_MS);
+        executor_spawn(executor, (Future*)&sleeps[i]);
+    }
+    executor_run(executor);
+    double elapsed = now() - start;
+    printf("fire:   %d sleeps over %d ms completed in %.3f s\n", N_SLEEPS, MAX_SLEEP_MS, elapsed);
+    free(sleeps);
+    executor_destroy(executor);
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "executor.h"
+#include "future.h"
+#include "future_combinators.h"
+#include "future_examples.h"
+#include "timer_wheel.h"
+
+#define N_TIMERS 12
+
+static int finished[3];
+static atomic_int n_finished;
+
+/** Records the order in which sleeps finished (the sleep's index is passed as its `ok`). */
+static void* record(void* arg)
+{
+    finished[atomic_fetch_add(&n_finished, 1)] = (int)(intptr_t)arg;
+    return arg;
+}
+
+/** Drives a wheel with a fake clock and checks that each timer fires exactly at its deadline. */
+static void test_wheel(void)
+{
+    // The wheel only hands out the wakers of fired timers, so they are never called here.
+    Future dummy = future_create(NULL);
+    Waker waker = { .executor = NULL, .future = &dummy };
+
+    uint64_t const start = 1000;
+    uint64_t const deadlines[N_TIMERS] = { start - 5, start, start + 1, start + 63, start + 64,
+        start + 65, start + 4095, start + 4096, start + 300000, start + 123456789,
+        start + (UINT64_C(1) << 30), start + 7 };
+
+    TimerWheel wheel;
+    timer_wheel_init(&wheel, start);
+    TimerEntry timers[N_TIMERS];
+    for (int i = 0; i < N_TIMERS; i++) {
+        timers[i] = timer_entry_create();
+        timers[i].deadline = deadlines[i];
+        timers[i].waker = waker;
+        timers[i].state = TIMER_ARMED;
+        timer_wheel_insert(&wheel, &timers[i]);
+    }
+    // A cancelled timer never fires.
+    timer_wheel_remove(&wheel, &timers[N_TIMERS - 1]);
+    timers[N_TIMERS - 1].state = TIMER_IDLE;
+
+    size_t steps = 0;
+    size_t n_fired = 0;
+    while (wheel.n_timers > 0) {
+        uint64_t now = timer_wheel_next_deadline(&wheel);
+        assert(now != UINT64_MAX);
+        // With a small buffer, the due timers that do not fit wait for the next advance.
+        Waker fired[2];
+        size_t n;
+        do {
+            n = timer_wheel_advance(&wheel, now, fired, 2);
+            for (size_t i = 0; i < n; i++) {
+                assert(fired[i].future == &dummy);
+            }
+            n_fired += n;
+        } while (n == 2);
+        for (int i = 0; i < N_TIMERS - 1; i++) {
+            assert((timers[i].state == TIMER_FIRED) == (deadlines[i] <= now));
+        }
+        steps++;
+    }
+    assert(n_fired == N_TIMERS - 1);
+    // Jumping from one non-empty slot to the next takes few steps, however far the deadlines.
+    assert(steps < 10 * N_TIMERS);
+    assert(timers[N_TIMERS - 1].state == TIMER_IDLE);
+    assert(timer_wheel_next_deadline(&wheel) == UINT64_MAX);
+}
+
+/** Runs three sleeps (and a no-op sleep) and checks they finish in deadline order. */
+static void test_sleep(Executor* executor)
+{
+    uint64_t const start = timer_now_ms();
+    atomic_store(&n_finished, 0);
+
+    SleepFuture sleeps[3] = { sleep_for_future_create(300), sleep_for_future_create(100),
+        sleep_for_future_create(200) };
+    ApplyFuture records[3];
+    ThenFuture thens[3];
+    for (int i = 0; i < 3; i++) {
+        sleeps[i].base.ok = (void*)(intptr_t)i; // SleepFuture leaves `ok` untouched.
+        records[i] = apply_future_create(record);
+        thens[i] = future_then((Future*)&sleeps[i], (Future*)&records[i]);
+    }
+    // A deadline in the past completes at once.
+    SleepFuture past = sleep_until_future_create(start - 1);
+
+    executor_spawn(executor, (Future*)&past);
+    for (int i = 0; i < 3; i++) {
+        executor_spawn(executor, (Future*)&thens[i]);
+    }
+    executor_run(executor);
+
+    uint64_t const elapsed = timer_now_ms() - start;
+    printf("Elapsed time: %lu ms\n", (unsigned long)elapsed);
+    assert(elapsed >= 300);
+    assert(elapsed < 1000);
+    assert(atomic_load(&n_finished) == 3);
+    assert(finished[0] == 1 && finished[1] == 2 && finished[2] == 0);
+}
+
+int main()
+{
+    test_wheel();
+
+    Executor* executor = executor_create(0);
+    test_sleep(executor);
+    executor_destroy(executor);
+
+    executor = executor_create_multi(2, 0);
+    test_sleep(executor);
+    executor_destroy(executor);
+
+    printf("Timer test passed\n");
+    return 0;
+}
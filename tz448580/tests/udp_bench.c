@@ -0,0 +1,172 @@
+// Required for `sys/socket.h` include to contain `struct mmsghdr`.
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdio.h> // For printf
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h> // For clock_gettime
+#include <unistd.h>
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "future_examples.h"
+#include "waker.h"
+
+#define N_DATAGRAMS 1000000
+#define DATAGRAM_SIZE 64
+#define WINDOW 128 // Datagrams in flight: few enough for the receive buffer, so none are dropped.
+#define MAX_BATCH 64
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static size_t batch; // Datagrams per recvmmsg() and sendmmsg().
+static size_t n_received;
+static size_t n_recv_calls; // Completed UdpRecvFutures, i.e. recvmmsg() calls that got datagrams.
+static size_t n_send_calls; // UdpSendFutures, at least one sendmmsg() each.
+static Waker sender_waker;
+static bool sender_waiting;
+
+/** Receives N_DATAGRAMS datagrams, `batch` at most per call. */
+typedef struct ReceiverFuture {
+    Future base;
+    int fd;
+    struct mmsghdr* msgs;
+    UdpRecvFuture recv;
+} ReceiverFuture;
+
+static FutureState receiver_progress(Future* fut, Mio* mio, Waker waker)
+{
+    ReceiverFuture* self = (ReceiverFuture*)fut;
+    while (n_received < N_DATAGRAMS) {
+        if (!self->recv.base.progress) {
+            self->recv = udp_recv_future_create(self->fd, self->msgs, batch);
+        }
+        FutureState state = self->recv.base.progress(&self->recv.base, mio, waker);
+        if (state == FUTURE_PENDING) {
+            return FUTURE_PENDING;
+        }
+        if (state == FUTURE_FAILURE) {
+            fatal("recvmmsg");
+        }
+        n_received += self->recv.n_received;
+        n_recv_calls++;
+        self->recv.base.progress = NULL;
+        if (sender_waiting) {
+            sender_waiting = false;
+            waker_wake(&sender_waker);
+        }
+    }
+    return FUTURE_COMPLETED;
+}
+
+/** Sends N_DATAGRAMS datagrams, `batch` per call, keeping at most WINDOW of them unreceived. */
+typedef struct SenderFuture {
+    Future base;
+    int fd;
+    size_t n_sent;
+    struct mmsghdr* msgs;
+    UdpSendFuture send;
+} SenderFuture;
+
+static FutureState sender_progress(Future* fut, Mio* mio, Waker waker)
+{
+    SenderFuture* self = (SenderFuture*)fut;
+    while (self->n_sent < N_DATAGRAMS) {
+        if (!self->send.base.progress) {
+            if (self->n_sent + batch > n_received + WINDOW) {
+                sender_waker = waker;
+                sender_waiting = true;
+                return FUTURE_PENDING;
+            }
+            size_t const n = N_DATAGRAMS - self->n_sent < batch ? N_DATAGRAMS - self->n_sent : batch;
+            self->send = udp_send_future_create(self->fd, self->msgs, n);
+            n_send_calls++;
+        }
+        FutureState state = self->send.base.progress(&self->send.base, mio, waker);
+        if (state == FUTURE_PENDING) {
+            return FUTURE_PENDING;
+        }
+        if (state == FUTURE_FAILURE) {
+            fatal("sendmmsg");
+        }
+        self->n_sent += self->send.n_sent;
+        self->send.base.progress = NULL;
+    }
+    return FUTURE_COMPLETED;
+}
+
+static void bench_batch(size_t batch_size)
+{
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t addr_len = sizeof(addr);
+    int recv_fd = udp_bind((struct sockaddr*)&addr, addr_len);
+    ASSERT_SYS_OK(recv_fd);
+    ASSERT_SYS_OK(getsockname(recv_fd, (struct sockaddr*)&addr, &addr_len));
+    struct sockaddr_in any = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    int send_fd = udp_bind((struct sockaddr*)&any, sizeof(any));
+    ASSERT_SYS_OK(send_fd);
+    ASSERT_SYS_OK(connect(send_fd, (struct sockaddr*)&addr, addr_len));
+
+    static uint8_t buffers[2][MAX_BATCH][DATAGRAM_SIZE];
+    static struct iovec iovs[2][MAX_BATCH];
+    static struct mmsghdr msgs[2][MAX_BATCH];
+    for (size_t side = 0; side < 2; side++) {
+        for (size_t i = 0; i < MAX_BATCH; i++) {
+            iovs[side][i] = (struct iovec) { .iov_base = buffers[side][i], .iov_len = DATAGRAM_SIZE };
+            msgs[side][i].msg_hdr = (struct msghdr) { .msg_iov = &iovs[side][i], .msg_iovlen = 1 };
+        }
+    }
+
+    batch = batch_size;
+    n_received = 0;
+    n_recv_calls = 0;
+    n_send_calls = 0;
+    sender_waiting = false;
+    Executor* executor = executor_create(0);
+    ReceiverFuture receiver = {
+        .base = future_create(receiver_progress),
+        .fd = recv_fd,
+        .msgs = msgs[0],
+    };
+    SenderFuture sender = {
+        .base = future_create(sender_progress),
+        .fd = send_fd,
+        .n_sent = 0,
+        .msgs = msgs[1],
+    };
+    executor_spawn(executor, &receiver.base);
+    executor_spawn(executor, &sender.base);
+    double const start = now();
+    executor_run(executor);
+    double const elapsed = now() - start;
+    executor_destroy(executor);
+
+    printf("%8zu %14.0f %14.1f %14.1f\n", batch_size, N_DATAGRAMS / elapsed,
+        (double)N_DATAGRAMS / n_recv_calls, (double)N_DATAGRAMS / n_send_calls);
+    close(recv_fd);
+    close(send_fd);
+}
+
+int main()
+{
+    // Loopback datagrams from one socket to another on a single executor, moved `batch` per
+    // recvmmsg() and sendmmsg(): packets/s, and packets per syscall on each side.
+    printf("%8s %14s %14s %14s\n", "batch", "packets/s", "per_recv", "per_send");
+    size_t const batches[] = { 1, 8, 32, 64 };
+    for (int round = 0; round < 2; round++) {
+        for (size_t i = 0; i < sizeof(batches) / sizeof(batches[0]); i++) {
+            bench_batch(batches[i]);
+        }
+    }
+    return 0;
+}
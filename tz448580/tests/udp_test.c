@@ -0,0 +1,183 @@
+// Required for `sys/socket.h` include to contain `struct mmsghdr`.
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "future_examples.h"
+
+#define N_DATAGRAMS 200
+#define SEND_BATCH 16
+#define RECV_BATCH 8
+#define MAX_SIZE 64
+
+/** Size of the i-th datagram: they differ, so that a mixed-up msg_len shows. */
+static size_t datagram_size(size_t i)
+{
+    return 1 + i % MAX_SIZE;
+}
+
+/** Receives N_DATAGRAMS datagrams (RECV_BATCH at most at once), checking each. */
+typedef struct ReceiverFuture {
+    Future base;
+    int fd;
+    size_t n_received;
+    size_t n_batches;
+    uint8_t buffers[RECV_BATCH][MAX_SIZE];
+    struct iovec iovs[RECV_BATCH];
+    struct mmsghdr msgs[RECV_BATCH];
+    UdpRecvFuture recv;
+} ReceiverFuture;
+
+static FutureState receiver_progress(Future* fut, Mio* mio, Waker waker)
+{
+    ReceiverFuture* self = (ReceiverFuture*)fut;
+    while (self->n_received < N_DATAGRAMS) {
+        if (!self->recv.base.progress) {
+            self->recv = udp_recv_future_create(self->fd, self->msgs, RECV_BATCH);
+        }
+        FutureState state = self->recv.base.progress(&self->recv.base, mio, waker);
+        if (state == FUTURE_PENDING) {
+            return FUTURE_PENDING;
+        }
+        assert(state == FUTURE_COMPLETED);
+        assert(self->recv.n_received >= 1 && self->recv.n_received <= RECV_BATCH);
+        for (size_t i = 0; i < self->recv.n_received; i++, self->n_received++) {
+            // Loopback neither loses nor reorders datagrams (as long as the socket has room).
+            assert(self->msgs[i].msg_len == datagram_size(self->n_received));
+            for (size_t j = 0; j < self->msgs[i].msg_len; j++) {
+                assert(self->buffers[i][j] == (uint8_t)self->n_received);
+            }
+        }
+        self->n_batches++;
+        self->recv.base.progress = NULL;
+    }
+    return FUTURE_COMPLETED;
+}
+
+/** Sends N_DATAGRAMS datagrams to `addr`, SEND_BATCH per UdpSendFuture. */
+typedef struct SenderFuture {
+    Future base;
+    int fd;
+    size_t n_sent;
+    uint8_t buffers[N_DATAGRAMS][MAX_SIZE];
+    struct iovec iovs[N_DATAGRAMS];
+    struct mmsghdr msgs[N_DATAGRAMS];
+    UdpSendFuture send;
+} SenderFuture;
+
+static FutureState sender_progress(Future* fut, Mio* mio, Waker waker)
+{
+    SenderFuture* self = (SenderFuture*)fut;
+    while (self->n_sent < N_DATAGRAMS) {
+        if (!self->send.base.progress) {
+            size_t const n = N_DATAGRAMS - self->n_sent < SEND_BATCH ? N_DATAGRAMS - self->n_sent
+                                                                     : SEND_BATCH;
+            self->send = udp_send_future_create(self->fd, self->msgs + self->n_sent, n);
+        }
+        FutureState state = self->send.base.progress(&self->send.base, mio, waker);
+        if (state == FUTURE_PENDING) {
+            return FUTURE_PENDING;
+        }
+        assert(state == FUTURE_COMPLETED);
+        self->n_sent += self->send.n_sent;
+        self->send.base.progress = NULL;
+    }
+    return FUTURE_COMPLETED;
+}
+
+/** Sends datagrams between two loopback sockets, with the receiver waiting for them first. */
+static void run_udp(Executor* executor)
+{
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t addr_len = sizeof(addr);
+    int recv_fd = udp_bind((struct sockaddr*)&addr, addr_len);
+    ASSERT_SYS_OK(recv_fd);
+    ASSERT_SYS_OK(getsockname(recv_fd, (struct sockaddr*)&addr, &addr_len));
+    struct sockaddr_in any = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    int send_fd = udp_bind((struct sockaddr*)&any, sizeof(any));
+    ASSERT_SYS_OK(send_fd);
+    ASSERT_SYS_OK(connect(send_fd, (struct sockaddr*)&addr, addr_len));
+
+    static ReceiverFuture receiver;
+    receiver = (ReceiverFuture) { .base = future_create(receiver_progress), .fd = recv_fd };
+    for (size_t i = 0; i < RECV_BATCH; i++) {
+        receiver.iovs[i] = (struct iovec) { .iov_base = receiver.buffers[i], .iov_len = MAX_SIZE };
+        receiver.msgs[i].msg_hdr = (struct msghdr) { .msg_iov = &receiver.iovs[i], .msg_iovlen = 1 };
+    }
+    static SenderFuture sender;
+    sender = (SenderFuture) { .base = future_create(sender_progress), .fd = send_fd };
+    for (size_t i = 0; i < N_DATAGRAMS; i++) {
+        memset(sender.buffers[i], (uint8_t)i, MAX_SIZE);
+        sender.iovs[i] = (struct iovec) { .iov_base = sender.buffers[i], .iov_len = datagram_size(i) };
+        sender.msgs[i].msg_hdr = (struct msghdr) { .msg_iov = &sender.iovs[i], .msg_iovlen = 1 };
+    }
+
+    executor_spawn(executor, &receiver.base);
+    executor_spawn(executor, &sender.base);
+    executor_run(executor);
+
+    assert(receiver.base.errcode == FUTURE_SUCCESS);
+    assert(sender.base.errcode == FUTURE_SUCCESS);
+    assert(receiver.n_received == N_DATAGRAMS);
+    // Datagrams queued up while the receiver waited arrive in batches.
+    assert(receiver.n_batches < N_DATAGRAMS);
+
+    close(recv_fd);
+    close(send_fd);
+    executor_destroy(executor);
+}
+
+/** Datagrams already queued are received by a single recvmmsg(), up to the batch size. */
+static void test_recv_batch(void)
+{
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t addr_len = sizeof(addr);
+    int recv_fd = udp_bind((struct sockaddr*)&addr, addr_len);
+    ASSERT_SYS_OK(recv_fd);
+    ASSERT_SYS_OK(getsockname(recv_fd, (struct sockaddr*)&addr, &addr_len));
+    int send_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_SYS_OK(send_fd);
+    for (int i = 0; i < 2 * RECV_BATCH; i++) {
+        ASSERT_SYS_OK(sendto(send_fd, "x", 1, 0, (struct sockaddr*)&addr, addr_len));
+    }
+
+    uint8_t buffers[RECV_BATCH];
+    struct iovec iovs[RECV_BATCH];
+    struct mmsghdr msgs[RECV_BATCH];
+    for (size_t i = 0; i < RECV_BATCH; i++) {
+        iovs[i] = (struct iovec) { .iov_base = &buffers[i], .iov_len = 1 };
+        msgs[i].msg_hdr = (struct msghdr) { .msg_iov = &iovs[i], .msg_iovlen = 1 };
+    }
+    Executor* executor = executor_create(0);
+    UdpRecvFuture recv = udp_recv_future_create(recv_fd, msgs, RECV_BATCH);
+    executor_spawn(executor, &recv.base);
+    executor_run(executor);
+    executor_destroy(executor);
+    assert(recv.base.errcode == FUTURE_SUCCESS);
+    assert(recv.n_received == RECV_BATCH);
+    assert(recv.base.ok == msgs);
+
+    close(recv_fd);
+    close(send_fd);
+}
+
+int main()
+{
+    run_udp(executor_create(0));
+    run_udp(executor_create_multi(4, 0));
+    test_recv_batch();
+
+    printf("UDP test passed\n");
+    return 0;
+}
@@ -0,0 +1,125 @@
+// Required for `unistd.h` include to contain `pipe2`.
+#define _GNU_SOURCE
+
+#include <fcntl.h> // For O_NONBLOCK
+#include <stdint.h>
+#include <stdio.h> // For printf
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <time.h> // For clock_gettime
+#include <unistd.h> // For pipe2, syscall
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "future_examples.h"
+#include "mio.h"
+
+#define STREAMS 16
+#define BYTES_PER_STREAM (16 << 20)
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static size_t n_rw_calls; // read() and write() calls (of the pipe futures, and Mio's eventfd).
+
+// Count the pipe futures' system calls by interposing the libc wrappers.
+ssize_t read(int fd, void* buffer, size_t n)
+{
+    n_rw_calls++;
+    return syscall(SYS_read, fd, buffer, n);
+}
+
+ssize_t write(int fd, void const* buffer, size_t n)
+{
+    n_rw_calls++;
+    return syscall(SYS_write, fd, buffer, n);
+}
+
+/**
+ * Streams BYTES_PER_STREAM through each of STREAMS pipes or socket pairs (from a PipeWriteFuture
+ * to a PipeReadFuture), and prints the throughput and the system calls per MiB.
+ */
+static void bench_stream(MioBackend backend, bool sockets)
+{
+    Executor* executor = executor_create(0);
+    if (executor_set_mio_backend(executor, backend) != backend) {
+        printf("%-8s %-10s not supported\n", sockets ? "socket" : "pipe",
+            backend == MIO_BACKEND_IO_URING ? "io_uring" : "epoll");
+        executor_destroy(executor);
+        return;
+    }
+
+    static PipeWriteFuture writes[STREAMS];
+    static PipeReadFuture reads[STREAMS];
+    int fds[STREAMS][2];
+    char* out = malloc(BYTES_PER_STREAM);
+    uint8_t* in = malloc((size_t)STREAMS * BYTES_PER_STREAM);
+    if (!out || !in) {
+        fatal("malloc");
+    }
+    memset(out, 'x', BYTES_PER_STREAM);
+    for (size_t i = 0; i < STREAMS; i++) {
+        if (sockets) {
+            ASSERT_SYS_OK(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds[i]));
+        } else {
+            ASSERT_SYS_OK(pipe2(fds[i], O_NONBLOCK));
+        }
+        writes[i] = pipe_write_future_create(fds[i][1], BYTES_PER_STREAM, false);
+        writes[i].base.arg = out;
+        reads[i] = pipe_read_future_create(
+            fds[i][0], in + (size_t)i * BYTES_PER_STREAM, BYTES_PER_STREAM);
+        executor_spawn(executor, &writes[i].base);
+        executor_spawn(executor, &reads[i].base);
+    }
+
+    n_rw_calls = 0;
+    double start = now();
+    executor_run(executor);
+    double elapsed = now() - start;
+
+    for (size_t i = 0; i < STREAMS; i++) {
+        if (reads[i].base.errcode != FUTURE_SUCCESS || writes[i].base.errcode != FUTURE_SUCCESS) {
+            fatal("stream %zu failed", i);
+        }
+    }
+
+    MioStats stats;
+    mio_stats(executor_mio(executor), &stats);
+    double const mb = (double)STREAMS * BYTES_PER_STREAM / (1 << 20);
+    size_t const n_ops = n_rw_calls + stats.n_submitted;
+    size_t const n_syscalls = n_rw_calls + stats.n_polls + stats.n_ctls;
+    printf("%-8s %-10s %8.0f %10.1f %10.1f %10.1f %10.1f %10.2f\n", sockets ? "socket" : "pipe",
+        backend == MIO_BACKEND_IO_URING ? "io_uring" : "epoll", mb / elapsed, (double)n_ops / mb,
+        (double)n_rw_calls / mb, (double)(stats.n_polls + stats.n_ctls) / mb,
+        (double)n_syscalls / mb, (double)n_syscalls / n_ops);
+
+    for (size_t i = 0; i < STREAMS; i++) {
+        close(fds[i][0]);
+        close(fds[i][1]);
+    }
+    free(out);
+    free(in);
+    executor_destroy(executor);
+}
+
+int main()
+{
+    // Reads and writes (ops, whether system calls or io_uring submissions) and system calls
+    // per MiB streamed, with readiness (epoll) or completions (io_uring).
+    printf("%-8s %-10s %8s %10s %10s %10s %10s %10s\n", "fd", "backend", "MiB/s", "ops/MiB",
+        "rw/MiB", "mio/MiB", "total/MiB", "total/op");
+    for (int round = 0; round < 2; round++) {
+        for (int sockets = 0; sockets < 2; sockets++) {
+            bench_stream(MIO_BACKEND_EPOLL, sockets);
+            bench_stream(MIO_BACKEND_IO_URING, sockets);
+        }
+    }
+    return 0;
+}
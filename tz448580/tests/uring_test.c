@@ -0,0 +1,144 @@
+// Required for `unistd.h` include to contain `pipe2`.
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "future_combinators.h"
+#include "future_examples.h"
+
+#define N_BYTES (1 << 20) // Much more than fits in the pipe and socket buffers.
+#define SLEEP_MS 20
+
+/**
+ * Sends N_BYTES each way between two fd pairs (two pipes, or the two ends of a socket pair),
+ * with the reads and writes in separate tasks.
+ */
+static void run_transfer(Executor* executor, int const read_fds[2], int const write_fds[2])
+{
+    char* out[2];
+    uint8_t* in[2];
+    PipeWriteFuture writes[2];
+    PipeReadFuture reads[2];
+    for (int i = 0; i < 2; i++) {
+        out[i] = malloc(N_BYTES);
+        in[i] = malloc(N_BYTES);
+        assert(out[i] && in[i]);
+        for (size_t j = 0; j < N_BYTES; j++) {
+            out[i][j] = (char)(j * 7 + i);
+        }
+        writes[i] = pipe_write_future_create(write_fds[i], N_BYTES, false);
+        writes[i].base.arg = out[i];
+        reads[i] = pipe_read_future_create(read_fds[i], in[i], N_BYTES);
+    }
+    for (int i = 0; i < 2; i++) {
+        executor_spawn(executor, &writes[i].base);
+        executor_spawn(executor, &reads[i].base);
+    }
+    executor_run(executor);
+
+    for (int i = 0; i < 2; i++) {
+        assert(writes[i].base.errcode == FUTURE_SUCCESS);
+        assert(reads[i].base.errcode == FUTURE_SUCCESS);
+        assert(reads[i].read_so_far == N_BYTES);
+        assert(memcmp(in[i], out[i], N_BYTES) == 0);
+    }
+    for (int i = 0; i < 2; i++) {
+        free(out[i]);
+        free(in[i]);
+    }
+}
+
+static void test_pipes(Executor* executor)
+{
+    int pipe_fds[2][2];
+    for (int i = 0; i < 2; i++) {
+        ASSERT_SYS_OK(pipe2(pipe_fds[i], O_NONBLOCK));
+    }
+    int const read_fds[2] = { pipe_fds[0][0], pipe_fds[1][0] };
+    int const write_fds[2] = { pipe_fds[0][1], pipe_fds[1][1] };
+    run_transfer(executor, read_fds, write_fds);
+    for (int i = 0; i < 2; i++) {
+        close(pipe_fds[i][0]);
+        close(pipe_fds[i][1]);
+    }
+}
+
+static void test_socketpair(Executor* executor)
+{
+    int fds[2];
+    ASSERT_SYS_OK(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds));
+    // Each socket receives what the other one sent, while a future sends on it.
+    int const read_fds[2] = { fds[1], fds[0] };
+    run_transfer(executor, read_fds, fds);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+/**
+ * Selects between a read of an empty pipe and a sleep: the sleep wins, and the read (in flight
+ * in the io_uring) is cancelled. Its buffer must then stay untouched, and the pipe's next bytes
+ * must go to whoever reads them next.
+ */
+static void test_cancel(Executor* executor)
+{
+    int fds[2];
+    ASSERT_SYS_OK(pipe2(fds, O_NONBLOCK));
+
+    uint8_t buffer[4] = { 0 };
+    PipeReadFuture pipe_read = pipe_read_future_create(fds[0], buffer, sizeof(buffer));
+    SleepFuture sleep = sleep_for_future_create(SLEEP_MS);
+    SelectFuture select = future_select(&pipe_read.base, &sleep.base);
+    executor_spawn(executor, &select.base);
+    executor_run(executor);
+
+    assert(select.which_completed == SELECT_COMPLETED_FUT2);
+    assert(pipe_read.op == -1);
+
+    ASSERT_SYS_OK(write(fds[1], "abcd", 4));
+    char received[4];
+    ssize_t const n_received = read(fds[0], received, 4);
+    assert(n_received == 4);
+    assert(memcmp(received, "abcd", 4) == 0);
+    assert(buffer[0] == 0);
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+static void run_all(Executor* executor)
+{
+    bool const uring
+        = executor_set_mio_backend(executor, MIO_BACKEND_IO_URING) == MIO_BACKEND_IO_URING;
+    if (!uring) {
+        // An old kernel (or a seccomp filter): the epoll fallback must still work.
+        printf("io_uring not supported, testing the epoll fallback\n");
+    }
+    test_pipes(executor);
+    test_socketpair(executor);
+    test_cancel(executor);
+
+    MioStats stats;
+    mio_stats(executor_mio(executor), &stats);
+    assert(uring == (stats.n_submitted > 0));
+    executor_destroy(executor);
+}
+
+int main()
+{
+    run_all(executor_create(0));
+    run_all(executor_create_multi(4, 0));
+
+    printf("Uring test passed\n");
+    return 0;
+}
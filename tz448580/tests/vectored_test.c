@@ -0,0 +1,130 @@
+// Required for `unistd.h` include to contain `pipe2`.
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "future_examples.h"
+
+#define HEADER_SIZE 16
+#define PAYLOAD_SIZE (256 * 1024) // Well over a pipe's capacity: partial writes and reads.
+#define TRAILER_SIZE 7
+#define TOTAL_SIZE (HEADER_SIZE + PAYLOAD_SIZE + TRAILER_SIZE)
+
+static uint8_t header[HEADER_SIZE];
+static uint8_t payload[PAYLOAD_SIZE];
+static uint8_t trailer[TRAILER_SIZE];
+static uint8_t received[TOTAL_SIZE];
+
+/** The concatenation of the segments, byte `i`. */
+static uint8_t expected_byte(size_t i)
+{
+    if (i < HEADER_SIZE) {
+        return header[i];
+    }
+    i -= HEADER_SIZE;
+    return i < PAYLOAD_SIZE ? payload[i] : trailer[i - PAYLOAD_SIZE];
+}
+
+/**
+ * Writes a header, a payload and a trailer (with an empty segment in between) with one
+ * PipeWritevFuture, and reads them into differently split segments with one PipeReadvFuture.
+ */
+static void run_vectored(Executor* executor)
+{
+    int fds[2];
+    ASSERT_SYS_OK(pipe2(fds, O_NONBLOCK));
+
+    struct iovec out[] = {
+        { .iov_base = header, .iov_len = HEADER_SIZE },
+        { .iov_base = NULL, .iov_len = 0 },
+        { .iov_base = payload, .iov_len = PAYLOAD_SIZE },
+        { .iov_base = trailer, .iov_len = TRAILER_SIZE },
+    };
+    struct iovec in[] = {
+        { .iov_base = received, .iov_len = 10 },
+        { .iov_base = received + 10, .iov_len = 0 },
+        { .iov_base = received + 10, .iov_len = 1000 },
+        { .iov_base = received + 1010, .iov_len = TOTAL_SIZE - 1010 },
+    };
+    struct iovec out_copy[4], in_copy[4];
+    memcpy(out_copy, out, sizeof(out));
+    memcpy(in_copy, in, sizeof(in));
+    memset(received, 0, TOTAL_SIZE);
+
+    PipeWritevFuture pipe_writev = pipe_writev_future_create(fds[1], out, 4);
+    PipeReadvFuture pipe_readv = pipe_readv_future_create(fds[0], in, 4);
+    executor_spawn(executor, &pipe_readv.base);
+    executor_spawn(executor, &pipe_writev.base);
+    executor_run(executor);
+
+    assert(pipe_writev.base.errcode == FUTURE_SUCCESS);
+    assert(pipe_readv.base.errcode == FUTURE_SUCCESS);
+    assert(pipe_writev.base.ok == out && pipe_readv.base.ok == in);
+    assert(pipe_writev.written_so_far == TOTAL_SIZE);
+    assert(pipe_readv.read_so_far == TOTAL_SIZE);
+    for (size_t i = 0; i < TOTAL_SIZE; i++) {
+        assert(received[i] == expected_byte(i));
+    }
+    // The partial transfers left the segments as they were.
+    assert(memcmp(out, out_copy, sizeof(out)) == 0);
+    assert(memcmp(in, in_copy, sizeof(in)) == 0);
+
+    close(fds[0]);
+    close(fds[1]);
+    executor_destroy(executor);
+}
+
+/** A PipeReadvFuture fails with EOF once the pipe closes before its segments are full. */
+static void test_eof(void)
+{
+    int fds[2];
+    ASSERT_SYS_OK(pipe2(fds, O_NONBLOCK));
+    ASSERT_SYS_OK(write(fds[1], "abcde", 5));
+    close(fds[1]);
+
+    uint8_t first[3], second[8];
+    struct iovec in[] = {
+        { .iov_base = first, .iov_len = sizeof(first) },
+        { .iov_base = second, .iov_len = sizeof(second) },
+    };
+    Executor* executor = executor_create(0);
+    PipeReadvFuture pipe_readv = pipe_readv_future_create(fds[0], in, 2);
+    executor_spawn(executor, &pipe_readv.base);
+    executor_run(executor);
+    executor_destroy(executor);
+
+    assert(pipe_readv.base.errcode == PIPE_FUTURE_ERR_EOF);
+    assert(pipe_readv.read_so_far == 5);
+    assert(pipe_readv.iov_index == 1 && pipe_readv.iov_offset == 2);
+    assert(memcmp(first, "abc", 3) == 0 && memcmp(second, "de", 2) == 0);
+    close(fds[0]);
+}
+
+int main()
+{
+    for (size_t i = 0; i < HEADER_SIZE; i++) {
+        header[i] = 'H';
+    }
+    for (size_t i = 0; i < PAYLOAD_SIZE; i++) {
+        payload[i] = (uint8_t)(i * 7 + i / 251);
+    }
+    for (size_t i = 0; i < TRAILER_SIZE; i++) {
+        trailer[i] = 'T';
+    }
+
+    run_vectored(executor_create(0));
+    run_vectored(executor_create_multi(4, 0));
+    test_eof();
+
+    printf("Vectored test passed\n");
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include <stdio.h> // For printf
+#include <stdlib.h> // For calloc
+#include <time.h> // For clock_gettime
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "waker.h"
+
+#define WAKE_ROUNDS 10
+
+typedef struct WakeBench {
+    Future* tasks; // Tasks that sit in the queue while the driver wakes them.
+    size_t n_tasks;
+    double elapsed; // Time spent in waker_wake(), in seconds.
+    size_t wakes; // Number of waker_wake() calls made.
+} WakeBench;
+
+/** A future that completes as soon as it is polled. */
+static FutureState noop_future_progress(Future* fut, Mio* mio, Waker waker)
+{
+    return FUTURE_COMPLETED;
+}
+
+/** A future that wakes every (already queued) task a few times and measures how long it takes. */
+static FutureState driver_future_progress(Future* fut, Mio* mio, Waker waker)
+{
+    WakeBench* bench = fut->arg;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t round = 0; round < WAKE_ROUNDS; round++) {
+        for (size_t i = 0; i < bench->n_tasks; i++) {
+            Waker task_waker = { .executor = waker.executor, .future = &bench->tasks[i] };
+            waker_wake(&task_waker);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    bench->elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    bench->wakes = WAKE_ROUNDS * bench->n_tasks;
+    return FUTURE_COMPLETED;
+}
+
+int main()
+{
+    // Duplicate wakes of tasks that are already queued should cost the same,
+    // no matter how many other tasks are waiting in the queue.
+
+    size_t const sizes[] = { 10, 100, 1000, 10000, 100000 };
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t const n = sizes[s];
+        WakeBench bench = { .n_tasks = n };
+        bench.tasks = calloc(n, sizeof(Future));
+        if (!bench.tasks) {
+            fatal("calloc");
+        }
+
+        Executor* executor = executor_create(n + 1);
+
+        Future driver = future_create(driver_future_progress);
+        driver.arg = &bench;
+        executor_spawn(executor, &driver);
+        for (size_t i = 0; i < n; i++) {
+            bench.tasks[i] = future_create(noop_future_progress);
+            executor_spawn(executor, &bench.tasks[i]);
+        }
+
+        executor_run(executor);
+        executor_destroy(executor);
+
+        printf("queued tasks: %6zu, wakes: %7zu, ns/wake: %8.2f\n", n, bench.wakes,
+            bench.elapsed * 1e9 / bench.wakes);
+        free(bench.tasks);
+    }
+
+    return 0;
+}
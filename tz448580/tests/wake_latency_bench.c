@@ -0,0 +1,109 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h> // For printf
+#include <stdlib.h> // For qsort
+#include <time.h> // For clock_gettime
+#include <unistd.h> // For usleep
+
+#include "err.h"
+#include "executor.h"
+#include "future.h"
+#include "waker.h"
+
+#define N_SAMPLES 20000
+#define PARK_DELAY_US 50 // Time for the executor to park in mio_poll() before each wake.
+
+typedef struct LatencyFuture {
+    Future base;
+    _Atomic(Waker*) waker; // Published on the first progress() for the waking thread.
+    Waker saved_waker;
+    atomic_long wake_time_ns; // When the waking thread called waker_wake() (0 once consumed).
+    atomic_int samples_taken;
+    long latencies_ns[N_SAMPLES];
+} LatencyFuture;
+
+static long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+/** A future that records how long it took from waker_wake() (on another thread) to progress(). */
+static FutureState latency_future_progress(Future* fut, Mio* mio, Waker waker)
+{
+    LatencyFuture* self = (LatencyFuture*)fut;
+    long now = now_ns();
+    if (atomic_load(&self->waker) == NULL) {
+        self->saved_waker = waker;
+        atomic_store(&self->waker, &self->saved_waker);
+        return FUTURE_PENDING;
+    }
+
+    long wake_time = atomic_exchange(&self->wake_time_ns, 0);
+    if (wake_time != 0) {
+        int i = atomic_load(&self->samples_taken);
+        self->latencies_ns[i] = now - wake_time;
+        atomic_store(&self->samples_taken, i + 1);
+    }
+    return atomic_load(&self->samples_taken) == N_SAMPLES ? FUTURE_COMPLETED : FUTURE_PENDING;
+}
+
+static void* waking_thread(void* arg)
+{
+    LatencyFuture* fut = arg;
+    Waker* waker;
+    while ((waker = atomic_load(&fut->waker)) == NULL) {
+        usleep(1000);
+    }
+    for (int i = 0; i < N_SAMPLES; i++) {
+        while (atomic_load(&fut->samples_taken) < i) {
+            // Wait until the previous wake has been handled.
+        }
+        usleep(PARK_DELAY_US);
+        atomic_store(&fut->wake_time_ns, now_ns());
+        waker_wake(waker);
+    }
+    return NULL;
+}
+
+static int compare_longs(const void* a, const void* b)
+{
+    long x = *(const long*)a, y = *(const long*)b;
+    return (x > y) - (x < y);
+}
+
+static void bench(const char* name, Executor* executor)
+{
+    LatencyFuture* fut = calloc(1, sizeof(LatencyFuture));
+    if (!fut) {
+        fatal("calloc");
+    }
+    fut->base = future_create(latency_future_progress);
+
+    pthread_t thread;
+    ASSERT_ZERO(pthread_create(&thread, NULL, waking_thread, fut));
+    executor_spawn(executor, (Future*)fut);
+    executor_run(executor);
+    ASSERT_ZERO(pthread_join(thread, NULL));
+
+    qsort(fut->latencies_ns, N_SAMPLES, sizeof(long), compare_longs);
+    printf("%-22s p50: %7.2f us, p99: %7.2f us, max: %8.2f us\n", name,
+        fut->latencies_ns[N_SAMPLES / 2] / 1e3, fut->latencies_ns[N_SAMPLES * 99 / 100] / 1e3,
+        fut->latencies_ns[N_SAMPLES - 1] / 1e3);
+    free(fut);
+}
+
+int main()
+{
+    // Latency of waking a future parked in mio_poll() from another thread.
+    Executor* executor = executor_create(0);
+    bench("single-threaded", executor);
+    executor_destroy(executor);
+
+    executor = executor_create_multi(2, 0);
+    bench("multi-threaded (2)", executor);
+    executor_destroy(executor);
+
+    return 0;
+}